@@ -0,0 +1,85 @@
+#version 430 core
+
+// Чувствительность весов к расхождению поверхностей (относительная разница расстояний и степень косинуса между нормалями)
+#define DEPTH_SIGMA 0.05
+#define NORMAL_POWER 32.0
+
+/*Вход*/
+
+in VS_OUT {
+    vec2 uv;
+} fs_in;
+
+/*Выход*/
+
+layout (location = 0) out vec4 color;
+
+/*Текстуры*/
+
+// Цвет первичных пересечений и их поверхность (нормаль, расстояние; отрицательное расстояние - промах) в полном разрешении
+layout(binding = 5) uniform sampler2D _primaryColor;
+layout(binding = 6) uniform sampler2D _primarySurface;
+
+// Цвет вторичных лучей и поверхность первичных пересечений, из которых они выпущены, в пониженном разрешении
+layout(binding = 7) uniform sampler2D _secondaryColor;
+layout(binding = 8) uniform sampler2D _secondarySurface;
+
+/*Функции*/
+
+// Сходство поверхности отсчета пониженного разрешения с поверхностью пикселя
+float surfaceWeight(vec4 surface, vec4 sampleSurface)
+{
+    // Промах засчитывается только промахом
+    if(surface.w < 0.0f || sampleSurface.w < 0.0f) return surface.w < 0.0f && sampleSurface.w < 0.0f ? 1.0f : 0.0f;
+
+    float depthDifference = abs(sampleSurface.w - surface.w) / (surface.w * DEPTH_SIGMA);
+    float depthWeight = exp(-depthDifference * depthDifference);
+    float normalWeight = pow(max(dot(surface.xyz, sampleSurface.xyz), 0.0f), NORMAL_POWER);
+
+    return depthWeight * normalWeight;
+}
+
+// Основная функция фрагментного шейдера
+// Цвет вторичных лучей повышается до полного разрешения совместным билатеральным фильтром (четыре ближайших отсчета
+// взвешиваются билинейно и по сходству поверхностей, чтобы цвет не переходил через границы объектов) и складывается
+// с цветом первичных пересечений
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 surface = texelFetch(_primarySurface, pixel, 0);
+    vec3 primary = texelFetch(_primaryColor, pixel, 0).rgb;
+
+    // Положение пикселя в сетке пониженного разрешения (отсчеты расположены в центрах своих пикселей)
+    ivec2 lowSize = textureSize(_secondaryColor, 0);
+    vec2 lowPosition = fs_in.uv * vec2(lowSize) - 0.5f;
+    ivec2 base = ivec2(floor(lowPosition));
+    vec2 f = lowPosition - vec2(base);
+
+    vec3 secondary = vec3(0.0f);
+    float totalWeight = 0.0f;
+
+    // Лучший по сходству поверхности отсчет (если все веса пренебрежимо малы)
+    vec3 bestColor = vec3(0.0f);
+    float bestWeight = -1.0f;
+
+    for(int i = 0; i < 4; i++)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 samplePixel = clamp(base + offset, ivec2(0), lowSize - 1);
+
+        float bilinear = (offset.x == 1 ? f.x : 1.0f - f.x) * (offset.y == 1 ? f.y : 1.0f - f.y);
+        float similarity = surfaceWeight(surface, texelFetch(_secondarySurface, samplePixel, 0));
+        vec3 sampleColor = texelFetch(_secondaryColor, samplePixel, 0).rgb;
+
+        secondary += sampleColor * bilinear * similarity;
+        totalWeight += bilinear * similarity;
+
+        if(similarity > bestWeight){
+            bestWeight = similarity;
+            bestColor = sampleColor;
+        }
+    }
+
+    secondary = totalWeight > 1e-4 ? secondary / totalWeight : bestColor;
+    color = vec4(primary + secondary, 1.0f);
+}
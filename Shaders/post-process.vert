@@ -0,0 +1,22 @@
+#version 330 core
+
+/*Схема входа-выхода*/
+
+layout(location = 0) in vec3 position;   // Положение
+layout(location = 2) in vec2 uv;         // Текстурные координаты
+
+/*Выход*/
+
+out VS_OUT {
+    vec2 uv;
+} vs_out;
+
+/*Функции*/
+
+// Основная функция вершинного шейдера
+// Экранный квадрат без трансформаций
+void main()
+{
+    gl_Position = vec4(position.x, position.y, 0.0, 1.0);
+    vs_out.uv = uv;
+}
@@ -0,0 +1,2064 @@
+// Общая часть программ трассировки (ray-tracing.frag, ray-tracing.comp) - типы, буферы, обход структур ускорения,
+// пересечения с примитивами, освещение и вторичные лучи
+// Вставляется в оба шейдера сразу после директивы #version и блока специализации (см. ShaderProgram)
+
+// Голосование и рассылка значений внутри подгруппы (при наличии - совместный обход структуры ускорения)
+#extension GL_KHR_shader_subgroup_ballot : enable
+#extension GL_KHR_shader_subgroup_vote : enable
+
+// Параметры специализации программы (задаются блоком #define при сборке, см. ShaderPermutations)
+// Глубина трассировки (кол-во последовательных кастов луча)
+#ifndef RAY_DEPTH
+#define RAY_DEPTH 5
+#endif
+// Маска используемых на сцене типов источников света (бит на значение LightSourceType)
+#ifndef LIGHT_TYPES
+#define LIGHT_TYPES 7
+#endif
+// Есть ли на сцене преломляющие материалы
+#ifndef REFRACTION
+#define REFRACTION 1
+#endif
+// Проверяется ли видимость источников света теневыми лучами
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+
+// Размер стека обхода BVH
+#define BVH_STACK_SIZE 64
+// Длина отрезка отраженного луча, проходимого в экранном пространстве
+#define SCREEN_SPACE_REFLECTION_DISTANCE 100.0
+// Ближняя плоскость буфера видимости (должна совпадать с VISIBILITY_NEAR_PLANE)
+#define VISIBILITY_NEAR_PLANE 0.01
+// Предельное кол-во зондов отражений (должно совпадать с MAX_REFLECTION_PROBES)
+#define MAX_REFLECTION_PROBES 8
+// Карты теней - кол-во отсчетов вокруг направления на точку (кроме центрального), предельный угловой радиус области
+// отсчетов, относительное смещение сравнения расстояний и кол-во теневых лучей к диску источника в полутени
+#define SHADOW_MAP_TAPS 16
+#define SHADOW_MAP_MAX_KERNEL 0.25
+#define SHADOW_MAP_BIAS 0.01
+#define PENUMBRA_SHADOW_RAYS 4
+
+// Типы структуры ускорения (значения должны совпадать с AccelerationStructureType)
+#define AS_SCENE_LBVH 0
+#define AS_TWO_LEVEL 1
+
+// Типы аналитических примитивов (значения должны совпадать с PrimitiveType)
+#define PRIMITIVE_SPHERE 0u
+#define PRIMITIVE_PLANE 1u
+#define PRIMITIVE_DISC 2u
+#define PRIMITIVE_BOX 3u
+#define PRIMITIVE_CYLINDER 4u
+#define PRIMITIVE_HEIGHTFIELD 5u
+#define PRIMITIVE_VOXELS 6u
+
+// Предельное кол-во шагов обхода пирамиды карты высот (защита от зацикливания на вырожденных лучах)
+#define HEIGHTFIELD_MAX_STEPS 4096
+// Предельное кол-во шагов обхода октодерева вокселей
+#define VOXEL_MAX_STEPS 4096
+
+// Значение поля instance ближайшего пересечения для аналитического примитива (triangle - индекс примитива)
+#define PRIMITIVE_HIT -2
+
+// Ядра проверки пересечений (значения должны совпадать с IntersectionKernel)
+#define IK_REFERENCE 0
+#define IK_PRECOMPUTED 1
+
+// Назначения псевдослучайных чисел пути (русская рулетка, выбор между отраженным и преломленным лучом, поворот точек
+// диска источника света)
+#define RANDOM_ROULETTE 0u
+#define RANDOM_CHOICE 1u
+#define RANDOM_SHADOW 2u
+
+// Совместный обход структуры ускорения подгруппой доступен только при поддержке расширений (иначе - обход каждым потоком)
+#if defined(GL_KHR_shader_subgroup_ballot) && defined(GL_KHR_shader_subgroup_vote)
+#define SUBGROUP_TRAVERSAL
+#endif
+
+/*Вспомогательные типы*/
+
+struct Vertex
+{
+    vec3 position;
+    vec3 color;
+    vec2 uv;
+    vec3 normal;
+};
+
+// Положение треугольника - первая вершина и два ребра (w первой вершины - индекс меша)
+// Только эти данные читаются при обходе структуры ускорения
+struct TrianglePositions
+{
+    vec4 vertex0;
+    vec4 edge1;
+    vec4 edge2;
+};
+
+// Атрибуты вершин треугольника (нормаль и u, цвет и v) - читаются только для ближайшего пересечения
+struct TriangleAttributes
+{
+    vec4 normalU[3];
+    vec4 colorV[3];
+};
+
+// Материал меша
+struct Material
+{
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float primaryCoff;
+    float reflectToRefract;
+    float refractionCoff;
+};
+
+struct Ray
+{
+    vec3 origin;
+    vec3 direction;
+    float weight;
+};
+
+// Луч с заранее вычисленными величинами для проверок пересечения при обходе
+struct PrecomputedRay
+{
+    vec3 origin;
+    vec3 direction;
+    vec3 invDirection;
+    vec3 scaledOrigin;
+};
+
+// Ближайшее пересечение найденное при обходе (атрибуты и материал читаются после обхода)
+struct ClosestHit
+{
+    uint triangle;
+    int instance;
+    vec2 barycentric;
+};
+
+struct NearestIntersectionInfo
+{
+    vec3 position;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float primaryToSecondaryRatio;
+    float reflectToRefractRatio;
+    float refractionCoff;
+    Vertex interpolated;
+};
+
+struct LightSource
+{
+    vec3 position;
+    float radius;
+    vec3 color;
+    vec3 orientation;
+    float attenuationQuadratic;
+    float attenuationLinear;
+    float cutOffAngleCos;
+    float cutOffOuterAngleCos;
+    uint type;
+};
+
+// Узел BVH (для листа left - индекс первого примитива, right - кол-во примитивов со знаком минус)
+struct BvhNode
+{
+    vec3 min;
+    int left;
+    vec3 max;
+    int right;
+};
+
+struct Instance
+{
+    mat4 worldToObject;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float primaryCoff;
+    float reflectToRefract;
+    float refractionCoff;
+    uint nodeOffset;
+    uint triangleOffset;
+    uint proxyNodeOffset;
+    uint proxyTriangleOffset;
+};
+
+// Аналитический примитив (каноническая форма в пространстве объекта, размеры задаются матрицей)
+struct Primitive
+{
+    mat4 worldToObject;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float primaryCoff;
+    float reflectToRefract;
+    float refractionCoff;
+    uint type;
+    uint dataOffset;
+    uint dataWidth;
+    uint dataDepth;
+};
+
+/*Uniform*/
+
+uniform float _aspectRatio;
+uniform float _fov;
+uniform mat4 _camModelMat;
+uniform uint _intersectionKernel;  // Ядро проверки пересечений при обходе структуры ускорения
+uniform float _rayWeightThreshold; // Вес луча, ниже которого путь продолжается лишь по результату русской рулетки
+uniform bool _subgroupTraversal; // Совместный обход структуры ускорения подгруппой (при поддержке расширений)
+uniform bool _primaryVisibility; // Начинаются ли первичные лучи с растеризованного буфера видимости
+uniform bool _screenSpaceReflections; // Ищутся ли отражения первичных лучей сначала в экранном пространстве
+uniform mat4 _viewProjection; // Матрица проекции и вида буфера видимости текущего кадра
+uniform mat4 _reflectionHistoryViewProjection; // Матрица проекции и вида изображения предыдущего кадра
+uniform uint _reflectionMaxSteps; // Предельное кол-во шагов по экрану
+uniform float _reflectionThickness; // Толщина поверхностей буфера видимости
+uniform uint _reflectionProbeCount; // Кол-во зондов отражений
+uniform vec4 _reflectionProbes[MAX_REFLECTION_PROBES]; // Положение (xyz) и радиус влияния (w) каждого зонда
+uniform uint _reflectionProbeLayers[MAX_REFLECTION_PROBES]; // Индекс кубической карты каждого зонда в массиве
+uniform float _reflectionProbeRoughness; // Шероховатость, начиная с которой отражение берется из зонда
+uniform uint _reflectionProbeBounceDepth; // Отскок, начиная с которого из зонда берется отражение любой поверхности
+uniform uint _shadowMapCount; // Кол-во карт теней (карты есть у первых источников кадра, остальные затеняются лучами)
+uniform float _shadowMapTexelAngle; // Угловой размер текселя карты теней
+/*SSBO-буферы*/
+
+layout(std430, binding = 0) buffer trianglePositionBuffer {
+    TrianglePositions _trianglePositions[];
+};
+
+layout(std430, binding = 18) buffer triangleAttributeBuffer {
+    TriangleAttributes _triangleAttributes[];
+};
+
+layout(std430, binding = 19) buffer meshMaterialBuffer {
+    Material _meshMaterials[];
+};
+
+layout(binding = 4, offset = 0) uniform atomic_uint _triangleCounterGlobal;
+// Кол-во лучей, завершенных русской рулеткой (обнуляется каждый кадр)
+layout(binding = 4, offset = 4) uniform atomic_uint _terminatedRays;
+// Кол-во отраженных лучей, искавшихся в экранном пространстве, и кол-во найденных там отражений (обнуляются каждый кадр)
+layout(binding = 4, offset = 8) uniform atomic_uint _reflectionRays;
+layout(binding = 4, offset = 12) uniform atomic_uint _screenSpaceReflectionHits;
+// Кол-во теневых лучей, обошедших структуру ускорения мешей (обнуляется каждый кадр)
+layout(binding = 4, offset = 16) uniform atomic_uint _shadowRays;
+
+// Узлы BVH сцены (LBVH над треугольниками или TLAS над экземплярами)
+layout(std430, binding = 7) buffer bvhNodeBuffer {
+    BvhNode _bvhNodes[];
+};
+
+layout(std430, binding = 12) buffer blasNodeBuffer {
+    BvhNode _blasNodes[];
+};
+
+layout(std430, binding = 13) buffer blasPositionBuffer {
+    TrianglePositions _blasPositions[];
+};
+
+layout(std430, binding = 20) buffer blasAttributeBuffer {
+    TriangleAttributes _blasAttributes[];
+};
+
+layout(std430, binding = 14) buffer instanceBuffer {
+    Instance _instances[];
+};
+
+// Узлы BVH аналитических примитивов (строится на CPU при любой структуре ускорения мешей)
+layout(std430, binding = 28) buffer primitiveNodeBuffer {
+    BvhNode _primitiveNodes[];
+};
+
+layout(std430, binding = 29) buffer primitiveBuffer {
+    Primitive _primitives[];
+};
+
+// Данные примитивов - отсчеты карт высот с пирамидами и узлы октодеревьев (буфер текстуры - не занимает блока хранения)
+layout(binding = 1) uniform usamplerBuffer _primitiveData;
+
+// Буфер видимости первичных лучей (экземпляр со сдвигом на единицу, треугольник BLAS, барицентрические координаты, расстояние)
+layout(binding = 2) uniform usampler2D _visibilityBuffer;
+
+// Итоговое изображение предыдущего кадра (цвет отражений, найденных в экранном пространстве)
+layout(binding = 3) uniform sampler2D _reflectionHistory;
+
+// Кубические карты зондов отражений (уровни детализации - карта, размытая по шероховатости)
+layout(binding = 4) uniform samplerCubeArray _reflectionProbeMaps;
+
+// Кубические карты теней источников кадра (расстояние от источника до ближайшей поверхности мешей)
+layout(binding = 9) uniform samplerCubeArray _shadowMaps;
+
+// Источники света (размер буфера увеличивается по мере необходимости)
+layout(std140, binding = 2) buffer lightSourceBuffer {
+    LightSource _lightSources[];
+};
+
+/*Uniform-буферы*/
+
+layout (std140, binding = 3) uniform commonSettings
+{
+    uint _totalLights;
+    uint _totalMeshes;
+    uint _accelerationStructure;
+    uint _triangleCapacity;
+    uint _totalPrimitives;
+};
+
+/*Глобальные переменные*/
+
+// Обходят ли лучи упрощенную геометрию экземпляров (вторичные лучи, одинаково для всех потоков подгруппы)
+bool _proxyTraversal = false;
+
+/*Функции*/
+
+// Учитывается ли событие луча в статистике кадра (определяется каждой программой трассировки)
+// primary - событие первичного луча или его пересечения, иначе - вторичного луча
+bool countsRayStatistics(bool primary);
+
+// Функция пересечения треугольника и луча
+// Таинственный алгоритм Моллера - Трумбора, работаете быстрее обычного, но что тут происходит - лучше меня не спрашивайте
+// Ребра треугольника хранятся в буфере, поэтому читаются только 3 вектора (точка пересечения вычисляется после обхода)
+bool intersectsTriangleMT(TrianglePositions triangle, Ray ray, out float distance, out vec2 barycentric)
+{
+    // Два ребра треугольника
+    vec3 e1 = triangle.edge1.xyz;
+    vec3 e2 = triangle.edge2.xyz;
+
+    vec3 pvec = cross(ray.direction, e2);
+    float det = dot(e1, pvec);
+
+    if (det < 1e-8 && det > -1e-8) {
+        return false;
+    }
+
+    float inv_det = 1 / det;
+    vec3 tvec = ray.origin - triangle.vertex0.xyz;
+    float u = dot(tvec, pvec) * inv_det;
+    if (u < 0 || u > 1) {
+        return false;
+    }
+
+    vec3 qvec = cross(tvec, e1);
+    float v = dot(ray.direction, qvec) * inv_det;
+    if (v < 0 || u + v > 1) {
+        return false;
+    }
+
+    distance = dot(e2, qvec) * inv_det;
+    if(distance < 0){
+        return false;
+    }
+
+    barycentric.x = v;
+    barycentric.y = u;
+
+    return true;
+}
+
+// Пересечение луча с axis-aligned bounding box (метод плит)
+// В tNear записывается расстояние до точки входа (0 если начало луча внутри коробки)
+bool intersectsAABBoxDist(Ray ray, vec3 boxMin, vec3 boxMax, float tMax, out float tNear)
+{
+    vec3 invDir = 1.0f / ray.direction;
+    vec3 t0 = (boxMin - ray.origin) * invDir;
+    vec3 t1 = (boxMax - ray.origin) * invDir;
+    vec3 tSmall = min(t0, t1);
+    vec3 tBig = max(t0, t1);
+
+    tNear = max(max(tSmall.x, tSmall.y), max(tSmall.z, 0.0f));
+    float tFar = min(min(tBig.x, tBig.y), min(tBig.z, tMax));
+
+    return tNear <= tFar;
+}
+
+// Луч с величинами, вычисляемыми один раз перед обходом (обратное направление и начало в масштабе обратного направления)
+// Нулевые компоненты направления заменяются малыми, чтобы в проверке плит не возникало произведений 0 * inf
+PrecomputedRay precomputeRay(Ray ray)
+{
+    vec3 safeDirection = mix(ray.direction, mix(vec3(-1e-20f), vec3(1e-20f), greaterThanEqual(ray.direction, vec3(0.0f))), lessThan(abs(ray.direction), vec3(1e-20f)));
+    vec3 invDirection = 1.0f / safeDirection;
+    return PrecomputedRay(ray.origin, ray.direction, invDirection, ray.origin * invDirection);
+}
+
+// Пересечение луча с axis-aligned bounding box (метод плит без делений - одно умножение со сложением на плоскость)
+// В tNear записывается расстояние до точки входа (0 если начало луча внутри коробки)
+bool intersectsAABBoxSlab(PrecomputedRay ray, vec3 boxMin, vec3 boxMax, float tMax, out float tNear)
+{
+    vec3 t0 = fma(boxMin, ray.invDirection, -ray.scaledOrigin);
+    vec3 t1 = fma(boxMax, ray.invDirection, -ray.scaledOrigin);
+    vec3 tSmall = min(t0, t1);
+    vec3 tBig = max(t0, t1);
+
+    tNear = max(max(tSmall.x, tSmall.y), max(tSmall.z, 0.0f));
+    float tFar = min(min(tBig.x, tBig.y), min(tBig.z, tMax));
+
+    return tNear <= tFar;
+}
+
+// Пересечение луча с треугольником (Моллер - Трумбор, пересечения дальше tMax отбрасываются внутри функции)
+// Барицентрические координаты проверяются в масштабе определителя, деление выполняется только для засчитанного пересечения
+bool intersectsTrianglePrecomputed(TrianglePositions triangle, PrecomputedRay ray, float tMax, out float distance, out vec2 barycentric)
+{
+    vec3 e1 = triangle.edge1.xyz;
+    vec3 e2 = triangle.edge2.xyz;
+
+    vec3 pvec = cross(ray.direction, e2);
+    float det = dot(e1, pvec);
+    if(abs(det) < 1e-8) return false;
+
+    // Знак определителя переносится на числители, чтобы сравнения не зависели от ориентации треугольника
+    float detSign = det < 0.0f ? -1.0f : 1.0f;
+    float absDet = abs(det);
+
+    vec3 tvec = ray.origin - triangle.vertex0.xyz;
+    float u = dot(tvec, pvec);
+    if(u * detSign < 0.0f || u * detSign > absDet) return false;
+
+    vec3 qvec = cross(tvec, e1);
+    float v = dot(ray.direction, qvec);
+    if(v * detSign < 0.0f || (u + v) * detSign > absDet) return false;
+
+    float t = dot(e2, qvec);
+    if(t * detSign < 0.0f) return false;
+
+    float invDet = 1.0f / det;
+    distance = t * invDet;
+    if(distance >= tMax) return false;
+
+    barycentric = vec2(v * invDet, u * invDet);
+    return true;
+}
+
+// Проверка пересечения с границами узла выбранным ядром пересечений
+bool testBox(PrecomputedRay ray, vec3 boxMin, vec3 boxMax, float tMax, out float tNear)
+{
+    if(_intersectionKernel == IK_PRECOMPUTED) return intersectsAABBoxSlab(ray, boxMin, boxMax, tMax, tNear);
+    return intersectsAABBoxDist(Ray(ray.origin, ray.direction, 0.0f), boxMin, boxMax, tMax, tNear);
+}
+
+// Проверка пересечения с треугольником выбранным ядром пересечений (засчитываются лишь пересечения ближе tMax)
+bool testTriangle(TrianglePositions triangle, PrecomputedRay ray, float tMax, out float distance, out vec2 barycentric)
+{
+    if(_intersectionKernel == IK_PRECOMPUTED) return intersectsTrianglePrecomputed(triangle, ray, tMax, distance, barycentric);
+    return intersectsTriangleMT(triangle, Ray(ray.origin, ray.direction, 0.0f), distance, barycentric) && distance < tMax;
+}
+
+// Получить вектор направления исходящий из конкретного фрагмента с учетом угла обзора и пропорций экрана
+vec3 rayDirection(float fov, float aspectRatio, vec2 fragCoord)
+{
+    // Преобразовать текстурные координаты (0;1) в клип-координаты экрана (-1;1)
+    vec2 fragClipCoords = (fragCoord * 2.0) - vec2(1.0);
+
+    // Вектор направления с учетом угла обзора (fov) и пропорций экрана (aspectRatio)
+    vec3 direction = vec3(
+        fragClipCoords.x * tan(radians(fov) / 2.0) * aspectRatio,
+        fragClipCoords.y * tan(radians(fov) / 2.0),
+        -1.0);
+
+    // Вектор в пространстве мира
+    vec3 directionWorld = (_camModelMat * vec4(direction,0.0f)).xyz;
+
+    // Вернуть нормализованный вектор
+    return normalize(directionWorld);
+}
+
+// Получить интерполированные значения вершины
+Vertex interpolatedVertex(TrianglePositions positions, TriangleAttributes attributes, vec2 barycentric)
+{
+    // Результирующий объект с интерполированными значениями
+    Vertex result;
+
+    // Интерполяция с использованием барицентрических координат (нормаль и цвет интерполируются вместе с uv)
+    vec4 normalU = attributes.normalU[0] + ((attributes.normalU[1] - attributes.normalU[0]) * barycentric.y) + ((attributes.normalU[2] - attributes.normalU[0]) * barycentric.x);
+    vec4 colorV = attributes.colorV[0] + ((attributes.colorV[1] - attributes.colorV[0]) * barycentric.y) + ((attributes.colorV[2] - attributes.colorV[0]) * barycentric.x);
+
+    result.position = positions.vertex0.xyz + (positions.edge1.xyz * barycentric.y) + (positions.edge2.xyz * barycentric.x);
+    result.color = colorV.xyz;
+    result.uv = vec2(normalU.w, colorV.w);
+    result.normal = normalU.xyz;
+
+    return result;
+}
+
+// Обход LBVH построенного над подготовленными треугольниками сцены
+bool traceSceneBvh(Ray ray, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение треугольником
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    // Кол-во треугольников в BVH (при отсутствии мешей буфер не актуален)
+    int triangleCount = _totalMeshes > 0 ? int(min(atomicCounter(_triangleCounterGlobal), _triangleCapacity)) : 0;
+
+    // Стек обхода BVH (корень - всегда нулевой узел)
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(triangleCount > 0) stack[stackSize++] = 0;
+
+    // Обход BVH
+    while(stackSize > 0)
+    {
+        BvhNode node = _bvhNodes[stack[--stackSize]];
+
+        // Лист - проверка пересечения с треугольником
+        if(node.right < 0)
+        {
+            // Дистанция до точки пересечения
+            float distance;
+            // Барицентрические координаты треугольника (для интреполяции)
+            vec2 barycentric;
+
+            uint i = uint(node.left);
+
+            // Если пересечение засчитано и расстояние до треугольника меньше расстояния до прежнего пересечния
+            if(testTriangle(_trianglePositions[i], precomputedRay, minIntersectionDist, distance, barycentric))
+            {
+                // Запоминается лишь треугольник (атрибуты читаются после обхода)
+                closestHit = ClosestHit(i, -1, barycentric);
+
+                // Считать засчитанным
+                intersceted = true;
+
+                minIntersectionDist = distance;
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - проверка пересечения с границами потомков
+        float tLeft, tRight;
+        bool hitLeft = testBox(precomputedRay, _bvhNodes[node.left].min, _bvhNodes[node.left].max, minIntersectionDist, tLeft);
+        bool hitRight = testBox(precomputedRay, _bvhNodes[node.right].min, _bvhNodes[node.right].max, minIntersectionDist, tRight);
+
+        // Ближний потомок кладется в стек последним (обрабатывается первым)
+        if(hitLeft && hitRight){
+            bool leftFirst = tLeft <= tRight;
+            stack[stackSize++] = leftFirst ? node.right : node.left;
+            stack[stackSize++] = leftFirst ? node.left : node.right;
+        }
+        else if(hitLeft) stack[stackSize++] = node.left;
+        else if(hitRight) stack[stackSize++] = node.right;
+    }
+
+    return intersceted;
+}
+
+// Обход BLAS экземпляра (луч в пространстве объекта, параметр t совпадает с мировым)
+bool traceBlas(uint instanceIndex, Ray objectRay, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение треугольником
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(objectRay);
+
+    // Вторичные лучи обходят упрощенную геометрию экземпляра (если она задана)
+    uint nodeOffset = _proxyTraversal ? _instances[instanceIndex].proxyNodeOffset : _instances[instanceIndex].nodeOffset;
+    uint triangleOffset = _proxyTraversal ? _instances[instanceIndex].proxyTriangleOffset : _instances[instanceIndex].triangleOffset;
+
+    // Стек обхода BLAS (индексы узлов относительно корня BLAS)
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _blasNodes[nodeOffset + uint(stack[--stackSize])];
+
+        // Лист - проверка пересечения с треугольниками
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                // Дистанция до точки пересечения
+                float distance;
+                // Барицентрические координаты треугольника (для интреполяции)
+                vec2 barycentric;
+
+                uint i = triangleOffset + uint(k);
+
+                if(testTriangle(_blasPositions[i], precomputedRay, minIntersectionDist, distance, barycentric))
+                {
+                    // Запоминается лишь треугольник и экземпляр (атрибуты читаются после обхода)
+                    closestHit = ClosestHit(i, int(instanceIndex), barycentric);
+
+                    // Считать засчитанным
+                    intersceted = true;
+
+                    minIntersectionDist = distance;
+                }
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - проверка пересечения с границами потомков
+        BvhNode leftNode = _blasNodes[nodeOffset + uint(node.left)];
+        BvhNode rightNode = _blasNodes[nodeOffset + uint(node.right)];
+        float tLeft, tRight;
+        bool hitLeft = testBox(precomputedRay, leftNode.min, leftNode.max, minIntersectionDist, tLeft);
+        bool hitRight = testBox(precomputedRay, rightNode.min, rightNode.max, minIntersectionDist, tRight);
+
+        // Ближний потомок кладется в стек последним (обрабатывается первым)
+        if(hitLeft && hitRight){
+            bool leftFirst = tLeft <= tRight;
+            stack[stackSize++] = leftFirst ? node.right : node.left;
+            stack[stackSize++] = leftFirst ? node.left : node.right;
+        }
+        else if(hitLeft) stack[stackSize++] = node.left;
+        else if(hitRight) stack[stackSize++] = node.right;
+    }
+
+    return intersceted;
+}
+
+// Обход двухуровневой структуры (TLAS над экземплярами, BLAS для каждой геометрии)
+bool traceTwoLevel(Ray ray, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение треугольником
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    // Стек обхода TLAS (корень - всегда нулевой узел)
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(_totalMeshes > 0) stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _bvhNodes[stack[--stackSize]];
+
+        // Лист - обход BLAS экземпляров
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                // Луч в пространстве объекта (направление не нормализуется, чтобы параметр t совпадал с мировым)
+                mat4 worldToObject = _instances[k].worldToObject;
+                Ray objectRay = Ray((worldToObject * vec4(ray.origin, 1.0f)).xyz, mat3(worldToObject) * ray.direction, ray.weight);
+
+                if(traceBlas(uint(k), objectRay, minIntersectionDist, closestHit)){
+                    intersceted = true;
+                }
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - проверка пересечения с границами потомков
+        float tLeft, tRight;
+        bool hitLeft = testBox(precomputedRay, _bvhNodes[node.left].min, _bvhNodes[node.left].max, minIntersectionDist, tLeft);
+        bool hitRight = testBox(precomputedRay, _bvhNodes[node.right].min, _bvhNodes[node.right].max, minIntersectionDist, tRight);
+
+        // Ближний потомок кладется в стек последним (обрабатывается первым)
+        if(hitLeft && hitRight){
+            bool leftFirst = tLeft <= tRight;
+            stack[stackSize++] = leftFirst ? node.right : node.left;
+            stack[stackSize++] = leftFirst ? node.left : node.right;
+        }
+        else if(hitLeft) stack[stackSize++] = node.left;
+        else if(hitRight) stack[stackSize++] = node.right;
+    }
+
+    return intersceted;
+}
+
+// Отсчет карты высот (значения всех карт и их пирамид лежат в общем буфере текстуры)
+float heightSample(uint index)
+{
+    return uintBitsToFloat(texelFetch(_primitiveData, int(index)).r);
+}
+
+// Кол-во узлов уровня пирамиды карты высот по осям X и Z (уровень L покрывает узлом 2^L * 2^L ячеек)
+uvec2 heightfieldLevelSize(uvec2 cells, uint level)
+{
+    return (cells + (1u << level) - 1u) >> level;
+}
+
+// Диапазон высот узла пирамиды (для ячейки - по 4 угловым отсчетам, для остальных уровней - пара минимум/максимум)
+vec2 heightfieldRange(uint offset, uint width, uint levelOffset, uint levelWidth, uint level, ivec2 node)
+{
+    if(level == 0u)
+    {
+        uint i = offset + uint(node.y) * width + uint(node.x);
+        vec4 h = vec4(heightSample(i), heightSample(i + 1u), heightSample(i + width), heightSample(i + width + 1u));
+        return vec2(min(min(h.x, h.y), min(h.z, h.w)), max(max(h.x, h.y), max(h.z, h.w)));
+    }
+
+    uint i = levelOffset + (uint(node.y) * levelWidth + uint(node.x)) * 2u;
+    return vec2(heightSample(i), heightSample(i + 1u));
+}
+
+// Пересечение луча с поверхностью ячейки карты высот (два треугольника, луч в пространстве сетки)
+bool intersectsHeightfieldCell(uint offset, uint width, ivec2 cell, Ray gridRay, out float distance)
+{
+    uint i = offset + uint(cell.y) * width + uint(cell.x);
+    vec3 p00 = vec3(cell.x, heightSample(i), cell.y);
+    vec3 p10 = vec3(cell.x + 1, heightSample(i + 1u), cell.y);
+    vec3 p01 = vec3(cell.x, heightSample(i + width), cell.y + 1);
+    vec3 p11 = vec3(cell.x + 1, heightSample(i + width + 1u), cell.y + 1);
+
+    float t0, t1;
+    vec2 barycentric;
+    bool hit0 = intersectsTriangleMT(TrianglePositions(vec4(p00, 0.0f), vec4(p10 - p00, 0.0f), vec4(p11 - p00, 0.0f)), gridRay, t0, barycentric) && t0 > 0.0f;
+    bool hit1 = intersectsTriangleMT(TrianglePositions(vec4(p00, 0.0f), vec4(p11 - p00, 0.0f), vec4(p01 - p00, 0.0f)), gridRay, t1, barycentric) && t1 > 0.0f;
+
+    distance = min(hit0 ? t0 : 3.402823466e+38, hit1 ? t1 : 3.402823466e+38);
+    return hit0 || hit1;
+}
+
+// Пересечение луча с картой высот (луч в пространстве объекта, направление не нормализовано)
+// Иерархический 2D DDA по пирамиде минимумов/максимумов: узел, диапазон высот которого луч не пересекает
+// на своем отрезке, пропускается целиком, иначе луч спускается к потомку. Поверхность проверяется только в ячейке
+bool intersectsHeightfield(uint index, Ray ray, float tMax, out float distance)
+{
+    distance = tMax;
+
+    uint offset = _primitives[index].dataOffset;
+    uint width = _primitives[index].dataWidth;
+    uvec2 cells = uvec2(width, _primitives[index].dataDepth) - 1u;
+
+    // Луч в пространстве сетки (ячейка - единичный квадрат, высота без изменений), параметр t сохраняется
+    vec2 gridScale = vec2(cells) * 0.5f;
+    Ray gridRay = Ray(
+            vec3((ray.origin.x + 1.0f) * gridScale.x, ray.origin.y, (ray.origin.z + 1.0f) * gridScale.y),
+            vec3(ray.direction.x * gridScale.x, ray.direction.y, ray.direction.z * gridScale.y),
+            ray.weight);
+
+    // Вершина пирамиды - единственный узел над всей сеткой (уровни хранятся после отсчетов, начиная с первого)
+    uint top = 0u;
+    while((1u << top) < max(cells.x, cells.y)) top++;
+    uint levelOffset = offset + width * (cells.y + 1u);
+    for(uint level = 1u; level < top; level++){
+        uvec2 size = heightfieldLevelSize(cells, level);
+        levelOffset += size.x * size.y * 2u;
+    }
+
+    // Отрезок луча внутри границ карты
+    vec2 range = heightfieldRange(offset, width, levelOffset, 1u, top, ivec2(0));
+    vec3 invDirection = 1.0f / gridRay.direction;
+    vec3 t0 = (vec3(0.0f, range.x, 0.0f) - gridRay.origin) * invDirection;
+    vec3 t1 = (vec3(cells.x, range.y, cells.y) - gridRay.origin) * invDirection;
+    vec3 tNearAxis = min(t0, t1);
+    vec3 tFarAxis = max(t0, t1);
+    float t = max(max(max(tNearAxis.x, tNearAxis.y), tNearAxis.z), 0.0f);
+    float tEnd = min(min(min(tFarAxis.x, tFarAxis.y), tFarAxis.z), tMax);
+    if(t > tEnd) return false;
+
+    uint level = top;
+    ivec2 node = ivec2(0);
+    ivec2 stepDirection = ivec2(gridRay.direction.x >= 0.0f ? 1 : -1, gridRay.direction.z >= 0.0f ? 1 : -1);
+
+    for(int i = 0; i < HEIGHTFIELD_MAX_STEPS; i++)
+    {
+        uvec2 levelSize = heightfieldLevelSize(cells, level);
+        float nodeSize = float(1u << level);
+
+        // Выход луча из узла по XZ (границы узла на краю сетки ограничены ею)
+        vec2 nodeMin = vec2(node) * nodeSize;
+        vec2 nodeMax = min(nodeMin + nodeSize, vec2(cells));
+        vec2 exitPlane = vec2(stepDirection.x > 0 ? nodeMax.x : nodeMin.x, stepDirection.y > 0 ? nodeMax.y : nodeMin.y);
+        vec2 tExitAxis = vec2(
+                gridRay.direction.x != 0.0f ? (exitPlane.x - gridRay.origin.x) / gridRay.direction.x : 3.402823466e+38,
+                gridRay.direction.z != 0.0f ? (exitPlane.y - gridRay.origin.z) / gridRay.direction.z : 3.402823466e+38);
+        float tExit = max(min(min(tExitAxis.x, tExitAxis.y), tEnd), t);
+
+        // Пересекает ли луч на своем отрезке внутри узла диапазон высот узла
+        float y0 = gridRay.origin.y + gridRay.direction.y * t;
+        float y1 = gridRay.origin.y + gridRay.direction.y * tExit;
+        range = heightfieldRange(offset, width, levelOffset, levelSize.x, level, node);
+
+        if(max(y0, y1) >= range.x && min(y0, y1) <= range.y)
+        {
+            // Ячейка - проверка поверхности (ячейки обходятся по ходу луча, первое пересечение - ближайшее)
+            if(level == 0u)
+            {
+                float cellDistance;
+                if(intersectsHeightfieldCell(offset, width, node, gridRay, cellDistance) && cellDistance < tMax){
+                    distance = cellDistance;
+                    return true;
+                }
+            }
+            // Спуск к потомку, содержащему текущую точку луча
+            else
+            {
+                level--;
+                if(level > 0u){
+                    uvec2 size = heightfieldLevelSize(cells, level);
+                    levelOffset -= size.x * size.y * 2u;
+                }
+
+                vec2 point = gridRay.origin.xz + gridRay.direction.xz * t;
+                ivec2 child = ivec2(floor(point / (nodeSize * 0.5f)));
+                node = clamp(child, node * 2, min(node * 2 + 1, ivec2(heightfieldLevelSize(cells, level)) - 1));
+                continue;
+            }
+        }
+
+        // Переход к соседнему узлу через границу, которую луч пересекает раньше
+        if(tExit >= tEnd) return false;
+        t = tExit;
+
+        ivec2 previous = node;
+        if(tExitAxis.x <= tExitAxis.y) node.x += stepDirection.x;
+        else node.y += stepDirection.y;
+        if(any(lessThan(node, ivec2(0))) || any(greaterThanEqual(node, ivec2(levelSize)))) return false;
+
+        // Подъем, пока соседний узел принадлежит другому родителю (пустые области пропускаются узлами крупнее)
+        while(level < top && (node >> 1) != (previous >> 1))
+        {
+            if(level > 0u) levelOffset += levelSize.x * levelSize.y * 2u;
+            level++;
+            node >>= 1;
+            previous >>= 1;
+            levelSize = heightfieldLevelSize(cells, level);
+        }
+    }
+
+    return false;
+}
+
+// Нормаль карты высот в точке поверхности (нормаль треугольника ячейки, в пространстве объекта)
+vec3 heightfieldNormal(uint index, vec3 p)
+{
+    uint offset = _primitives[index].dataOffset;
+    uint width = _primitives[index].dataWidth;
+    uvec2 cells = uvec2(width, _primitives[index].dataDepth) - 1u;
+    vec2 gridScale = vec2(cells) * 0.5f;
+
+    // Ячейка и положение точки внутри нее
+    vec2 grid = (p.xz + 1.0f) * gridScale;
+    ivec2 cell = clamp(ivec2(floor(grid)), ivec2(0), ivec2(cells) - 1);
+    vec2 f = grid - vec2(cell);
+
+    uint i = offset + uint(cell.y) * width + uint(cell.x);
+    float h00 = heightSample(i);
+    float h10 = heightSample(i + 1u);
+    float h01 = heightSample(i + width);
+    float h11 = heightSample(i + width + 1u);
+
+    // Нормаль в пространстве сетки (треугольник 00-10-11 при f.x >= f.y, иначе 00-11-01), затем в пространстве объекта
+    vec3 normal = f.x >= f.y ? vec3(h00 - h10, 1.0f, h10 - h11) : vec3(h01 - h11, 1.0f, h00 - h01);
+    return vec3(normal.x * gridScale.x, normal.y, normal.z * gridScale.y);
+}
+
+// Узел октодерева вокселей (младшие 8 бит - маска потомков, старшие 24 - индекс первого потомка)
+uint voxelNode(uint offset, uint index)
+{
+    return texelFetch(_primitiveData, int(offset + index)).r;
+}
+
+// Размер (в вокселях) наибольшего пустого узла октодерева, содержащего воксель, либо 0 для заполненного вокселя
+// Спуск от корня - положение вокселя однозначно задает октант на каждом уровне, стек не нужен
+uint voxelEmptySize(uint offset, uint resolution, ivec3 voxel)
+{
+    uint node = voxelNode(offset, 0u);
+    for(uint size = resolution >> 1; size > 0u; size >>= 1)
+    {
+        uvec3 bit = (uvec3(voxel) / size) & 1u;
+        uint octant = bit.x | (bit.y << 1) | (bit.z << 2);
+        uint mask = node & 0xFFu;
+        if((mask & (1u << octant)) == 0u) return size;
+        if(size == 1u) return 0u;
+        node = voxelNode(offset, (node >> 8) + uint(bitCount(mask & ((1u << octant) - 1u))));
+    }
+    return 0u;
+}
+
+// Пересечение луча с октодеревом вокселей (луч в пространстве объекта, направление не нормализовано)
+// DDA без стека: для текущего вокселя ищется наибольший пустой узел, содержащий его, и луч переходит сразу
+// к выходу из этого узла. Луч, начавшийся внутри заполненной области, ищет выход из нее
+bool intersectsVoxels(uint index, Ray ray, float tMax, out float distance)
+{
+    distance = tMax;
+
+    uint offset = _primitives[index].dataOffset;
+    uint resolution = _primitives[index].dataWidth;
+
+    // Луч в пространстве сетки (воксель - единичный куб), параметр t сохраняется
+    float gridScale = float(resolution) * 0.5f;
+    Ray gridRay = Ray((ray.origin + 1.0f) * gridScale, ray.direction * gridScale, ray.weight);
+
+    // Отрезок луча внутри сетки
+    vec3 invDirection = 1.0f / gridRay.direction;
+    vec3 t0 = -gridRay.origin * invDirection;
+    vec3 t1 = (vec3(resolution) - gridRay.origin) * invDirection;
+    vec3 tNearAxis = min(t0, t1);
+    vec3 tFarAxis = max(t0, t1);
+    float t = max(max(max(tNearAxis.x, tNearAxis.y), tNearAxis.z), 0.0f);
+    float tEnd = min(min(min(tFarAxis.x, tFarAxis.y), tFarAxis.z), tMax);
+    if(t > tEnd) return false;
+
+    ivec3 stepDirection = ivec3(greaterThanEqual(gridRay.direction, vec3(0.0f))) * 2 - 1;
+    ivec3 voxel = clamp(ivec3(floor(gridRay.origin + gridRay.direction * t)), ivec3(0), ivec3(resolution - 1u));
+    bool inside = false;
+
+    for(int i = 0; i < VOXEL_MAX_STEPS; i++)
+    {
+        uint emptySize = voxelEmptySize(offset, resolution, voxel);
+        bool solid = emptySize == 0u;
+        if(i == 0) inside = solid && t <= 0.0f;
+
+        // Граница заполненной области (вход снаружи или выход изнутри)
+        if(solid != inside){
+            if(t <= 0.0f || t >= tMax) return false;
+            distance = t;
+            return true;
+        }
+
+        // Выход из узла, который луч проходит целиком (пустого узла или заполненного вокселя при движении изнутри)
+        int size = solid ? 1 : int(emptySize);
+        ivec3 nodeMin = voxel & ivec3(~(size - 1));
+        vec3 exitPlane = vec3(nodeMin + max(stepDirection, ivec3(0)) * size);
+        vec3 tExitAxis = vec3(
+                gridRay.direction.x != 0.0f ? (exitPlane.x - gridRay.origin.x) * invDirection.x : 3.402823466e+38,
+                gridRay.direction.y != 0.0f ? (exitPlane.y - gridRay.origin.y) * invDirection.y : 3.402823466e+38,
+                gridRay.direction.z != 0.0f ? (exitPlane.z - gridRay.origin.z) * invDirection.z : 3.402823466e+38);
+        float tExit = max(min(min(tExitAxis.x, tExitAxis.y), tExitAxis.z), t);
+
+        // Следующий воксель - за границей узла по оси выхода, по остальным осям в пределах узла
+        ivec3 next = clamp(ivec3(floor(gridRay.origin + gridRay.direction * tExit)), nodeMin, nodeMin + size - 1);
+        if(tExitAxis.x <= tExitAxis.y && tExitAxis.x <= tExitAxis.z) next.x = stepDirection.x > 0 ? nodeMin.x + size : nodeMin.x - 1;
+        else if(tExitAxis.y <= tExitAxis.z) next.y = stepDirection.y > 0 ? nodeMin.y + size : nodeMin.y - 1;
+        else next.z = stepDirection.z > 0 ? nodeMin.z + size : nodeMin.z - 1;
+
+        // Выход за сетку (изнутри заполненной области граница сетки является поверхностью)
+        if(tExit >= tEnd || any(lessThan(next, ivec3(0))) || any(greaterThanEqual(next, ivec3(resolution))))
+        {
+            float tOut = min(tExit, tEnd);
+            if(!inside || tOut <= 0.0f || tOut >= tMax) return false;
+            distance = tOut;
+            return true;
+        }
+
+        t = tExit;
+        voxel = next;
+    }
+
+    return false;
+}
+
+// Нормаль октодерева вокселей в точке поверхности (в пространстве объекта) - ось грани вокселя,
+// ближайшей к точке, направление - из заполненного вокселя в пустой
+vec3 voxelNormal(uint index, vec3 p)
+{
+    uint offset = _primitives[index].dataOffset;
+    uint resolution = _primitives[index].dataWidth;
+
+    vec3 grid = (p + 1.0f) * float(resolution) * 0.5f;
+    vec3 faceDistance = abs(grid - round(grid));
+    int axis = faceDistance.x <= faceDistance.y && faceDistance.x <= faceDistance.z ? 0 : (faceDistance.y <= faceDistance.z ? 1 : 2);
+
+    // Воксель с положительной стороны грани (за пределами сетки воксели пусты)
+    ivec3 voxel = ivec3(floor(grid));
+    voxel[axis] = int(round(grid[axis]));
+    bool solid = all(greaterThanEqual(voxel, ivec3(0))) && all(lessThan(voxel, ivec3(resolution))) && voxelEmptySize(offset, resolution, voxel) == 0u;
+
+    vec3 normal = vec3(0.0f);
+    normal[axis] = solid ? -1.0f : 1.0f;
+    return normal;
+}
+
+// Пересечение луча с канонической формой примитива (луч в пространстве объекта, направление не нормализовано)
+// Учитывается ближайшее пересечение на отрезке (0, tMax) - луч может начинаться внутри примитива
+bool intersectsPrimitive(uint index, Ray ray, float tMax, out float distance)
+{
+    uint type = _primitives[index].type;
+    if(type == PRIMITIVE_HEIGHTFIELD) return intersectsHeightfield(index, ray, tMax, distance);
+    if(type == PRIMITIVE_VOXELS) return intersectsVoxels(index, ray, tMax, distance);
+
+    distance = tMax;
+
+    // Сфера радиуса 1
+    if(type == PRIMITIVE_SPHERE)
+    {
+        float a = dot(ray.direction, ray.direction);
+        float b = dot(ray.origin, ray.direction);
+        float c = dot(ray.origin, ray.origin) - 1.0f;
+        float discriminant = b * b - a * c;
+        if(discriminant < 0.0f) return false;
+
+        float root = sqrt(discriminant);
+        float t = (-b - root) / a;
+        if(t <= 0.0f) t = (-b + root) / a;
+        if(t <= 0.0f || t >= tMax) return false;
+
+        distance = t;
+        return true;
+    }
+
+    // Квадрат [-1, 1] или диск радиуса 1 в плоскости XY
+    if(type == PRIMITIVE_PLANE || type == PRIMITIVE_DISC)
+    {
+        if(abs(ray.direction.z) < 1e-8) return false;
+
+        float t = -ray.origin.z / ray.direction.z;
+        if(t <= 0.0f || t >= tMax) return false;
+
+        vec2 p = ray.origin.xy + ray.direction.xy * t;
+        bool inside = type == PRIMITIVE_PLANE ? max(abs(p.x), abs(p.y)) <= 1.0f : dot(p, p) <= 1.0f;
+        if(!inside) return false;
+
+        distance = t;
+        return true;
+    }
+
+    // Куб [-1, 1] (слэб-тест, при начале внутри берется дальняя граница)
+    if(type == PRIMITIVE_BOX)
+    {
+        vec3 invDirection = 1.0f / ray.direction;
+        vec3 t0 = (vec3(-1.0f) - ray.origin) * invDirection;
+        vec3 t1 = (vec3(1.0f) - ray.origin) * invDirection;
+        vec3 tMin = min(t0, t1);
+        vec3 tMaxAxis = max(t0, t1);
+        float tNear = max(max(tMin.x, tMin.y), tMin.z);
+        float tFar = min(min(tMaxAxis.x, tMaxAxis.y), tMaxAxis.z);
+        if(tNear > tFar) return false;
+
+        float t = tNear > 0.0f ? tNear : tFar;
+        if(t <= 0.0f || t >= tMax) return false;
+
+        distance = t;
+        return true;
+    }
+
+    // Цилиндр радиуса 1 вдоль оси Y (y в [-1, 1]) с основаниями
+    if(type == PRIMITIVE_CYLINDER)
+    {
+        bool hit = false;
+
+        // Боковая поверхность
+        float a = dot(ray.direction.xz, ray.direction.xz);
+        if(a > 1e-12)
+        {
+            float b = dot(ray.origin.xz, ray.direction.xz);
+            float c = dot(ray.origin.xz, ray.origin.xz) - 1.0f;
+            float discriminant = b * b - a * c;
+            if(discriminant >= 0.0f)
+            {
+                float root = sqrt(discriminant);
+                for(int i = 0; i < 2; i++)
+                {
+                    float t = (-b + (i == 0 ? -root : root)) / a;
+                    if(t <= 0.0f || t >= distance) continue;
+                    if(abs(ray.origin.y + ray.direction.y * t) > 1.0f) continue;
+                    distance = t;
+                    hit = true;
+                }
+            }
+        }
+
+        // Основания
+        if(abs(ray.direction.y) > 1e-8)
+        {
+            for(int i = 0; i < 2; i++)
+            {
+                float t = ((i == 0 ? -1.0f : 1.0f) - ray.origin.y) / ray.direction.y;
+                if(t <= 0.0f || t >= distance) continue;
+                vec2 p = ray.origin.xz + ray.direction.xz * t;
+                if(dot(p, p) > 1.0f) continue;
+                distance = t;
+                hit = true;
+            }
+        }
+
+        return hit;
+    }
+
+    return false;
+}
+
+// Нормаль канонической формы примитива в точке поверхности (в пространстве объекта, не нормализована)
+vec3 primitiveNormal(uint index, vec3 p)
+{
+    uint type = _primitives[index].type;
+    if(type == PRIMITIVE_HEIGHTFIELD) return heightfieldNormal(index, p);
+    if(type == PRIMITIVE_VOXELS) return voxelNormal(index, p);
+    if(type == PRIMITIVE_SPHERE) return p;
+    if(type == PRIMITIVE_PLANE || type == PRIMITIVE_DISC) return vec3(0.0f, 0.0f, 1.0f);
+
+    // Куб - ось наибольшей по модулю координаты
+    if(type == PRIMITIVE_BOX)
+    {
+        vec3 a = abs(p);
+        if(a.x >= a.y && a.x >= a.z) return vec3(sign(p.x), 0.0f, 0.0f);
+        if(a.y >= a.z) return vec3(0.0f, sign(p.y), 0.0f);
+        return vec3(0.0f, 0.0f, sign(p.z));
+    }
+
+    // Цилиндр - основание или боковая поверхность
+    if(abs(p.y) > 1.0f - 1e-4 && dot(p.xz, p.xz) < 1.0f - 1e-3) return vec3(0.0f, sign(p.y), 0.0f);
+    return vec3(p.x, 0.0f, p.z);
+}
+
+// Обход BVH аналитических примитивов (пересечение с каждым примитивом ищется в его пространстве объекта)
+// Вызывается после обхода структуры ускорения мешей - найденное расстояние отсекает дальние узлы
+bool tracePrimitives(Ray ray, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение примитивом
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(_totalPrimitives > 0) stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _primitiveNodes[stack[--stackSize]];
+
+        // Лист - проверка пересечения с примитивами
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                // Луч в пространстве объекта (направление не нормализуется, чтобы параметр t совпадал с мировым)
+                mat4 worldToObject = _primitives[k].worldToObject;
+                Ray objectRay = Ray((worldToObject * vec4(ray.origin, 1.0f)).xyz, mat3(worldToObject) * ray.direction, ray.weight);
+
+                float distance;
+                if(intersectsPrimitive(uint(k), objectRay, minIntersectionDist, distance))
+                {
+                    closestHit = ClosestHit(uint(k), PRIMITIVE_HIT, vec2(0.0f));
+                    intersceted = true;
+                    minIntersectionDist = distance;
+                }
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - проверка пересечения с границами потомков
+        float tLeft, tRight;
+        bool hitLeft = testBox(precomputedRay, _primitiveNodes[node.left].min, _primitiveNodes[node.left].max, minIntersectionDist, tLeft);
+        bool hitRight = testBox(precomputedRay, _primitiveNodes[node.right].min, _primitiveNodes[node.right].max, minIntersectionDist, tRight);
+
+        // Ближний потомок кладется в стек последним (обрабатывается первым)
+        if(hitLeft && hitRight){
+            bool leftFirst = tLeft <= tRight;
+            stack[stackSize++] = leftFirst ? node.right : node.left;
+            stack[stackSize++] = leftFirst ? node.left : node.right;
+        }
+        else if(hitLeft) stack[stackSize++] = node.left;
+        else if(hitRight) stack[stackSize++] = node.right;
+    }
+
+    return intersceted;
+}
+
+#ifdef SUBGROUP_TRAVERSAL
+// Узел BVH сцены или TLAS, общий для всей подгруппы (читается одним потоком и рассылается остальным)
+BvhNode subgroupSceneNode(int index)
+{
+    BvhNode node = BvhNode(vec3(0.0f), 0, vec3(0.0f), 0);
+    if(subgroupElect()) node = _bvhNodes[index];
+
+    node.min = subgroupBroadcastFirst(node.min);
+    node.left = subgroupBroadcastFirst(node.left);
+    node.max = subgroupBroadcastFirst(node.max);
+    node.right = subgroupBroadcastFirst(node.right);
+    return node;
+}
+
+// Узел BLAS, общий для всей подгруппы (читается одним потоком и рассылается остальным)
+BvhNode subgroupBlasNode(uint index)
+{
+    BvhNode node = BvhNode(vec3(0.0f), 0, vec3(0.0f), 0);
+    if(subgroupElect()) node = _blasNodes[index];
+
+    node.min = subgroupBroadcastFirst(node.min);
+    node.left = subgroupBroadcastFirst(node.left);
+    node.max = subgroupBroadcastFirst(node.max);
+    node.right = subgroupBroadcastFirst(node.right);
+    return node;
+}
+
+// Общий для подгруппы порядок потомков - ближний левый потомок, если так считает большинство лучей, попавших в оба
+bool subgroupLeftFirst(bool hitLeft, bool hitRight, float tLeft, float tRight)
+{
+    bool both = hitLeft && hitRight;
+    uint leftVotes = subgroupBallotBitCount(subgroupBallot(both && tLeft <= tRight));
+    uint bothVotes = subgroupBallotBitCount(subgroupBallot(both));
+    return leftVotes * 2u >= bothVotes;
+}
+
+// Обход LBVH сцены всей подгруппой (стек общий, узел посещается если нужен хотя бы одному лучу подгруппы)
+bool traceSceneBvhSubgroup(Ray ray, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение треугольником
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    // Кол-во треугольников в BVH (при отсутствии мешей буфер не актуален)
+    int triangleCount = _totalMeshes > 0 ? int(min(atomicCounter(_triangleCounterGlobal), _triangleCapacity)) : 0;
+
+    // Общий стек обхода и признак того, нужен ли узел лучу текущего потока
+    int stack[BVH_STACK_SIZE];
+    bool laneWanted[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(subgroupAny(triangleCount > 0)){
+        stack[stackSize] = 0;
+        laneWanted[stackSize++] = triangleCount > 0;
+    }
+
+    while(stackSize > 0)
+    {
+        stackSize--;
+        BvhNode node = subgroupSceneNode(stack[stackSize]);
+        bool laneActive = laneWanted[stackSize];
+
+        // Лист - треугольник проверяют только лучи, попавшие в его границы
+        if(node.right < 0)
+        {
+            // Дистанция до точки пересечения
+            float distance;
+            // Барицентрические координаты треугольника (для интреполяции)
+            vec2 barycentric;
+
+            uint i = uint(node.left);
+
+            if(laneActive && testTriangle(_trianglePositions[i], precomputedRay, minIntersectionDist, distance, barycentric))
+            {
+                closestHit = ClosestHit(i, -1, barycentric);
+                intersceted = true;
+                minIntersectionDist = distance;
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - границы потомков читаются один раз на подгруппу, проверяются каждым активным лучом
+        BvhNode leftNode = subgroupSceneNode(node.left);
+        BvhNode rightNode = subgroupSceneNode(node.right);
+        float tLeft, tRight;
+        bool hitLeft = laneActive && testBox(precomputedRay, leftNode.min, leftNode.max, minIntersectionDist, tLeft);
+        bool hitRight = laneActive && testBox(precomputedRay, rightNode.min, rightNode.max, minIntersectionDist, tRight);
+
+        // Потомок посещается, если он нужен хотя бы одному лучу (ближний по мнению большинства кладется последним)
+        bool anyLeft = subgroupAny(hitLeft);
+        bool anyRight = subgroupAny(hitRight);
+        if(anyLeft && anyRight){
+            bool leftFirst = subgroupLeftFirst(hitLeft, hitRight, tLeft, tRight);
+            stack[stackSize] = leftFirst ? node.right : node.left;
+            laneWanted[stackSize++] = leftFirst ? hitRight : hitLeft;
+            stack[stackSize] = leftFirst ? node.left : node.right;
+            laneWanted[stackSize++] = leftFirst ? hitLeft : hitRight;
+        }
+        else if(anyLeft){
+            stack[stackSize] = node.left;
+            laneWanted[stackSize++] = hitLeft;
+        }
+        else if(anyRight){
+            stack[stackSize] = node.right;
+            laneWanted[stackSize++] = hitRight;
+        }
+    }
+
+    return intersceted;
+}
+
+// Обход BLAS экземпляра всей подгруппой (экземпляр общий, laneActive - нужен ли экземпляр лучу текущего потока)
+bool traceBlasSubgroup(uint instanceIndex, Ray objectRay, bool laneActive, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение треугольником
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(objectRay);
+
+    // Вторичные лучи обходят упрощенную геометрию экземпляра (если она задана)
+    uint nodeOffset = _proxyTraversal ? _instances[instanceIndex].proxyNodeOffset : _instances[instanceIndex].nodeOffset;
+    uint triangleOffset = _proxyTraversal ? _instances[instanceIndex].proxyTriangleOffset : _instances[instanceIndex].triangleOffset;
+
+    // Общий стек обхода (индексы узлов относительно корня BLAS) и признак того, нужен ли узел лучу текущего потока
+    int stack[BVH_STACK_SIZE];
+    bool laneWanted[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize] = 0;
+    laneWanted[stackSize++] = laneActive;
+
+    while(stackSize > 0)
+    {
+        stackSize--;
+        BvhNode node = subgroupBlasNode(nodeOffset + uint(stack[stackSize]));
+        laneActive = laneWanted[stackSize];
+
+        // Лист - треугольники проверяют только лучи, попавшие в его границы
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                // Дистанция до точки пересечения
+                float distance;
+                // Барицентрические координаты треугольника (для интреполяции)
+                vec2 barycentric;
+
+                uint i = triangleOffset + uint(k);
+
+                if(laneActive && testTriangle(_blasPositions[i], precomputedRay, minIntersectionDist, distance, barycentric))
+                {
+                    closestHit = ClosestHit(i, int(instanceIndex), barycentric);
+                    intersceted = true;
+                    minIntersectionDist = distance;
+                }
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - границы потомков читаются один раз на подгруппу, проверяются каждым активным лучом
+        BvhNode leftNode = subgroupBlasNode(nodeOffset + uint(node.left));
+        BvhNode rightNode = subgroupBlasNode(nodeOffset + uint(node.right));
+        float tLeft, tRight;
+        bool hitLeft = laneActive && testBox(precomputedRay, leftNode.min, leftNode.max, minIntersectionDist, tLeft);
+        bool hitRight = laneActive && testBox(precomputedRay, rightNode.min, rightNode.max, minIntersectionDist, tRight);
+
+        // Потомок посещается, если он нужен хотя бы одному лучу (ближний по мнению большинства кладется последним)
+        bool anyLeft = subgroupAny(hitLeft);
+        bool anyRight = subgroupAny(hitRight);
+        if(anyLeft && anyRight){
+            bool leftFirst = subgroupLeftFirst(hitLeft, hitRight, tLeft, tRight);
+            stack[stackSize] = leftFirst ? node.right : node.left;
+            laneWanted[stackSize++] = leftFirst ? hitRight : hitLeft;
+            stack[stackSize] = leftFirst ? node.left : node.right;
+            laneWanted[stackSize++] = leftFirst ? hitLeft : hitRight;
+        }
+        else if(anyLeft){
+            stack[stackSize] = node.left;
+            laneWanted[stackSize++] = hitLeft;
+        }
+        else if(anyRight){
+            stack[stackSize] = node.right;
+            laneWanted[stackSize++] = hitRight;
+        }
+    }
+
+    return intersceted;
+}
+
+// Обход двухуровневой структуры всей подгруппой (экземпляр посещается, если он нужен хотя бы одному лучу)
+bool traceTwoLevelSubgroup(Ray ray, inout float minIntersectionDist, inout ClosestHit closestHit)
+{
+    // Засчитано ли пересечение треугольником
+    bool intersceted = false;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    // Общий стек обхода TLAS и признак того, нужен ли узел лучу текущего потока
+    int stack[BVH_STACK_SIZE];
+    bool laneWanted[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(_totalMeshes > 0){
+        stack[stackSize] = 0;
+        laneWanted[stackSize++] = true;
+    }
+
+    while(stackSize > 0)
+    {
+        stackSize--;
+        BvhNode node = subgroupSceneNode(stack[stackSize]);
+        bool laneActive = laneWanted[stackSize];
+
+        // Лист - BLAS экземпляров обходится всей подгруппой, треугольники проверяют только активные лучи
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                // Луч в пространстве объекта (направление не нормализуется, чтобы параметр t совпадал с мировым)
+                mat4 worldToObject = _instances[k].worldToObject;
+                Ray objectRay = Ray((worldToObject * vec4(ray.origin, 1.0f)).xyz, mat3(worldToObject) * ray.direction, ray.weight);
+
+                if(traceBlasSubgroup(uint(k), objectRay, laneActive, minIntersectionDist, closestHit)){
+                    intersceted = true;
+                }
+            }
+
+            continue;
+        }
+
+        // Внутренний узел - границы потомков читаются один раз на подгруппу, проверяются каждым активным лучом
+        BvhNode leftNode = subgroupSceneNode(node.left);
+        BvhNode rightNode = subgroupSceneNode(node.right);
+        float tLeft, tRight;
+        bool hitLeft = laneActive && testBox(precomputedRay, leftNode.min, leftNode.max, minIntersectionDist, tLeft);
+        bool hitRight = laneActive && testBox(precomputedRay, rightNode.min, rightNode.max, minIntersectionDist, tRight);
+
+        // Потомок посещается, если он нужен хотя бы одному лучу (ближний по мнению большинства кладется последним)
+        bool anyLeft = subgroupAny(hitLeft);
+        bool anyRight = subgroupAny(hitRight);
+        if(anyLeft && anyRight){
+            bool leftFirst = subgroupLeftFirst(hitLeft, hitRight, tLeft, tRight);
+            stack[stackSize] = leftFirst ? node.right : node.left;
+            laneWanted[stackSize++] = leftFirst ? hitRight : hitLeft;
+            stack[stackSize] = leftFirst ? node.left : node.right;
+            laneWanted[stackSize++] = leftFirst ? hitLeft : hitRight;
+        }
+        else if(anyLeft){
+            stack[stackSize] = node.left;
+            laneWanted[stackSize++] = hitLeft;
+        }
+        else if(anyRight){
+            stack[stackSize] = node.right;
+            laneWanted[stackSize++] = hitRight;
+        }
+    }
+
+    return intersceted;
+}
+#endif
+
+#if SHADOWS
+// Перекрыт ли отрезок луча [0, tMax] треугольником LBVH сцены (обход завершается на первом найденном пересечении)
+// Порядок потомков не важен, атрибуты и материал не читаются
+bool occludedSceneBvh(Ray ray, float tMax)
+{
+    // Кол-во треугольников в BVH (при отсутствии мешей буфер не актуален)
+    int triangleCount = _totalMeshes > 0 ? int(min(atomicCounter(_triangleCounterGlobal), _triangleCapacity)) : 0;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(triangleCount > 0) stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _bvhNodes[stack[--stackSize]];
+
+        // Лист - любое пересечение ближе tMax завершает обход
+        if(node.right < 0)
+        {
+            float distance;
+            vec2 barycentric;
+            if(testTriangle(_trianglePositions[uint(node.left)], precomputedRay, tMax, distance, barycentric)) return true;
+            continue;
+        }
+
+        float tLeft, tRight;
+        if(testBox(precomputedRay, _bvhNodes[node.left].min, _bvhNodes[node.left].max, tMax, tLeft)) stack[stackSize++] = node.left;
+        if(testBox(precomputedRay, _bvhNodes[node.right].min, _bvhNodes[node.right].max, tMax, tRight)) stack[stackSize++] = node.right;
+    }
+
+    return false;
+}
+
+// Перекрыт ли отрезок луча [0, tMax] треугольником BLAS экземпляра (луч в пространстве объекта)
+bool occludedBlas(uint instanceIndex, Ray objectRay, float tMax)
+{
+    // Теневые лучи всегда обходят упрощенную геометрию экземпляра (если она задана)
+    uint nodeOffset = _instances[instanceIndex].proxyNodeOffset;
+    uint triangleOffset = _instances[instanceIndex].proxyTriangleOffset;
+
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(objectRay);
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _blasNodes[nodeOffset + uint(stack[--stackSize])];
+
+        // Лист - любое пересечение ближе tMax завершает обход
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                float distance;
+                vec2 barycentric;
+                if(testTriangle(_blasPositions[triangleOffset + uint(k)], precomputedRay, tMax, distance, barycentric)) return true;
+            }
+            continue;
+        }
+
+        BvhNode leftNode = _blasNodes[nodeOffset + uint(node.left)];
+        BvhNode rightNode = _blasNodes[nodeOffset + uint(node.right)];
+        float tLeft, tRight;
+        if(testBox(precomputedRay, leftNode.min, leftNode.max, tMax, tLeft)) stack[stackSize++] = node.left;
+        if(testBox(precomputedRay, rightNode.min, rightNode.max, tMax, tRight)) stack[stackSize++] = node.right;
+    }
+
+    return false;
+}
+
+// Перекрыт ли отрезок луча [0, tMax] треугольником двухуровневой структуры
+bool occludedTwoLevel(Ray ray, float tMax)
+{
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(_totalMeshes > 0) stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _bvhNodes[stack[--stackSize]];
+
+        // Лист - обход BLAS экземпляров до первого пересечения
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                // Луч в пространстве объекта (направление не нормализуется, чтобы параметр t совпадал с мировым)
+                mat4 worldToObject = _instances[k].worldToObject;
+                Ray objectRay = Ray((worldToObject * vec4(ray.origin, 1.0f)).xyz, mat3(worldToObject) * ray.direction, ray.weight);
+
+                if(occludedBlas(uint(k), objectRay, tMax)) return true;
+            }
+            continue;
+        }
+
+        float tLeft, tRight;
+        if(testBox(precomputedRay, _bvhNodes[node.left].min, _bvhNodes[node.left].max, tMax, tLeft)) stack[stackSize++] = node.left;
+        if(testBox(precomputedRay, _bvhNodes[node.right].min, _bvhNodes[node.right].max, tMax, tRight)) stack[stackSize++] = node.right;
+    }
+
+    return false;
+}
+
+// Перекрыт ли отрезок луча [0, tMax] аналитическим примитивом
+bool occludedPrimitives(Ray ray, float tMax)
+{
+    // Величины луча, общие для всех проверок пересечения при обходе
+    PrecomputedRay precomputedRay = precomputeRay(ray);
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    if(_totalPrimitives > 0) stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        BvhNode node = _primitiveNodes[stack[--stackSize]];
+
+        // Лист - любое пересечение ближе tMax завершает обход
+        if(node.right < 0)
+        {
+            for(int k = node.left; k < node.left - node.right; k++)
+            {
+                mat4 worldToObject = _primitives[k].worldToObject;
+                Ray objectRay = Ray((worldToObject * vec4(ray.origin, 1.0f)).xyz, mat3(worldToObject) * ray.direction, ray.weight);
+
+                float distance;
+                if(intersectsPrimitive(uint(k), objectRay, tMax, distance)) return true;
+            }
+            continue;
+        }
+
+        float tLeft, tRight;
+        if(testBox(precomputedRay, _primitiveNodes[node.left].min, _primitiveNodes[node.left].max, tMax, tLeft)) stack[stackSize++] = node.left;
+        if(testBox(precomputedRay, _primitiveNodes[node.right].min, _primitiveNodes[node.right].max, tMax, tRight)) stack[stackSize++] = node.right;
+    }
+
+    return false;
+}
+
+// Теневой луч от точки поверхности к точке источника света (до поверхности сферы источника)
+// Пересечения внутри сферы источника точку не затеняют - луч заканчивается на входе в сферу (tMax <= 0 - точка внутри)
+Ray lightRay(vec3 position, vec3 normal, uint lightIndex, vec3 target, out float tMax)
+{
+    vec3 toLight = _lightSources[lightIndex].position - position;
+    vec3 direction = normalize(target - position);
+    float radius = _lightSources[lightIndex].radius;
+
+    float along = dot(toLight, direction);
+    tMax = along - sqrt(max(radius * radius - (dot(toLight, toLight) - along * along), 0.0f));
+
+    // Начало луча чуть сдвигается по нормали в сторону источника (чтобы луч не пересекся с самой поверхностью)
+    return Ray(position + normal * (dot(normal, direction) >= 0.0f ? 1e-3 : -1e-3), direction, 1.0f);
+}
+
+// Виден ли из точки поверхности заданный участок источника света
+bool lightVisible(vec3 position, vec3 normal, uint lightIndex, vec3 target)
+{
+    float tMax;
+    Ray shadowRay = lightRay(position, normal, lightIndex, target, tMax);
+    if(tMax <= 0.0f) return true;
+
+    if(occludedPrimitives(shadowRay, tMax)) return false;
+
+    // Луч обходит структуру ускорения мешей (учитывается в статистике)
+    if(countsRayStatistics(!_proxyTraversal)) atomicCounterIncrement(_shadowRays);
+    return _accelerationStructure == AS_TWO_LEVEL ? !occludedTwoLevel(shadowRay, tMax) : !occludedSceneBvh(shadowRay, tMax);
+}
+
+// Видимая из точки поверхности доля диска источника света (диск радиуса radius перпендикулярен направлению на точку)
+// Для источников с картой теней точка сначала классифицируется: отсчеты карты вокруг направления от источника на точку
+// ищут поверхности мешей перед точкой, способные закрыть от нее часть диска. Без таких поверхностей точка освещена,
+// если поверхности закрывают всю область, в которой поверхность центрального отсчета закрывает диск - находится в тени,
+// иначе в полутени - только тогда к диску выпускаются теневые лучи
+// Аналитических примитивов в картах нет - для них всегда выпускается луч к центру источника
+float lightVisibility(vec3 position, vec3 normal, uint lightIndex, float rotation)
+{
+    vec3 lightPosition = _lightSources[lightIndex].position;
+    if(lightIndex >= _shadowMapCount) return lightVisible(position, normal, lightIndex, lightPosition) ? 1.0f : 0.0f;
+
+    float radius = _lightSources[lightIndex].radius;
+    vec3 fromLight = position - lightPosition;
+    float lightDistance = length(fromLight);
+    if(lightDistance <= radius) return 1.0f;
+
+    // Базис плоскости, перпендикулярной направлению от источника на точку
+    vec3 axis = fromLight / lightDistance;
+    vec3 tangent = normalize(cross(abs(axis.y) < 0.99f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f), axis));
+    vec3 bitangent = cross(axis, tangent);
+
+    // Угловой радиус области отсчетов - охватывает поверхности, закрывающие часть диска, от пятой части расстояния
+    // до точки (не меньше нескольких текселей - края жестких теней также уточняются лучами)
+    float texel = _shadowMapTexelAngle;
+    float kernel = clamp(4.0f * radius / lightDistance, 3.0f * texel, SHADOW_MAP_MAX_KERNEL);
+
+    // Расстояние от источника до плоскости поверхности вдоль нормали (плоскость - сама точка, а не заслоняющая ее поверхность)
+    float planeDistance = dot(normal, fromLight);
+
+    // Есть ли поверхности, закрывающие часть диска, и закрыта ли область, в которой поверхность центрального отсчета
+    // закрывает диск (по ней точка считается находящейся в тени)
+    bool blocker = false;
+    bool umbra = true;
+    float umbraAngle = 0.0f;
+    for(int i = 0; i <= SHADOW_MAP_TAPS; i++)
+    {
+        // Центральный отсчет и отсчеты диска по спирали Фогеля (угол отклонения от направления на точку)
+        float angle = kernel * sqrt(max(float(i) - 0.5f, 0.0f) / float(SHADOW_MAP_TAPS));
+        float phi = float(i) * 2.39996323f;
+        vec3 tapDirection = normalize(axis + (tangent * cos(phi) + bitangent * sin(phi)) * angle);
+        float surfaceDistance = texture(_shadowMaps, vec4(tapDirection, float(lightIndex))).r;
+
+        // Поверхность засчитывается, если она ближе плоскости точки и самой точки (смещение - погрешность текселя
+        // на наклонной плоскости)
+        float cosine = dot(normal, tapDirection);
+        float receiverDistance = cosine * planeDistance > 0.0f ? min(planeDistance / cosine, lightDistance) : lightDistance;
+        float slope = min(sqrt(max(1.0f - cosine * cosine, 0.0f)) / max(abs(cosine), 1e-4), 10.0f);
+        bool blocked = surfaceDistance < receiverDistance * (1.0f - SHADOW_MAP_BIAS - 1.5f * texel * slope);
+        if(!blocked)
+        {
+            if(i == 0 || angle <= umbraAngle) umbra = false;
+            continue;
+        }
+
+        // Угол, в пределах которого поверхность на этом расстоянии закрывает часть диска от точки
+        float reach = radius * (lightDistance - surfaceDistance) / (lightDistance * surfaceDistance);
+        if(angle <= reach + 2.0f * texel) blocker = true;
+
+        // Область центрального отсчета, выходящая за область отсчетов, не проверена - точка не считается затененной
+        if(i == 0)
+        {
+            umbraAngle = reach + 2.0f * texel;
+            if(umbraAngle > kernel) umbra = false;
+        }
+    }
+
+    // Освещенная точка - перекрыть ее могут только аналитические примитивы
+    if(!blocker)
+    {
+        float tMax;
+        Ray shadowRay = lightRay(position, normal, lightIndex, lightPosition, tMax);
+        return tMax <= 0.0f || !occludedPrimitives(shadowRay, tMax) ? 1.0f : 0.0f;
+    }
+
+    // Точка в тени
+    if(umbra) return 0.0f;
+
+    // Полутень - лучи к точкам диска (по спирали Фогеля, поворот спирали различается между пикселями)
+    if(radius <= 0.0f) return lightVisible(position, normal, lightIndex, lightPosition) ? 1.0f : 0.0f;
+
+    float visible = 0.0f;
+    for(int i = 0; i < PENUMBRA_SHADOW_RAYS; i++)
+    {
+        float offset = radius * sqrt((float(i) + 0.5f) / float(PENUMBRA_SHADOW_RAYS));
+        float phi = float(i) * 2.39996323f + rotation * 6.28318531f;
+        vec3 target = lightPosition + (tangent * cos(phi) + bitangent * sin(phi)) * offset;
+        if(lightVisible(position, normal, lightIndex, target)) visible += 1.0f;
+    }
+
+    return visible / float(PENUMBRA_SHADOW_RAYS);
+}
+#endif
+
+// Информация о ближайшем пересечении (атрибуты и материал читаются один раз - для найденного треугольника)
+NearestIntersectionInfo resolveClosestHit(Ray ray, ClosestHit closestHit, float distance)
+{
+    NearestIntersectionInfo info;
+    Material material;
+
+    // Аналитический примитив (нормаль канонической формы переводится в мировое пространство, материал - из записи примитива)
+    if(closestHit.instance == PRIMITIVE_HIT)
+    {
+        Primitive primitive = _primitives[closestHit.triangle];
+        material = Material(primitive.albedo, primitive.metallic, primitive.roughness, primitive.primaryCoff, primitive.reflectToRefract, primitive.refractionCoff);
+
+        info.position = ray.origin + ray.direction * distance;
+        vec3 objectPoint = (primitive.worldToObject * vec4(info.position, 1.0f)).xyz;
+        info.interpolated = Vertex(info.position, vec3(1.0f), vec2(0.0f), transpose(mat3(primitive.worldToObject)) * primitiveNormal(closestHit.triangle, objectPoint));
+    }
+    // Треугольник LBVH сцены (в мировом пространстве, материал - из таблицы материалов мешей)
+    else if(closestHit.instance < 0)
+    {
+        TrianglePositions positions = _trianglePositions[closestHit.triangle];
+        material = _meshMaterials[floatBitsToUint(positions.vertex0.w)];
+
+        info.position = ray.origin + (normalize(ray.direction) * distance);
+        info.interpolated = interpolatedVertex(positions, _triangleAttributes[closestHit.triangle], closestHit.barycentric);
+    }
+    // Треугольник BLAS (точка и нормаль переводятся в мировое пространство, материал - из экземпляра)
+    else
+    {
+        Instance instance = _instances[closestHit.instance];
+        material = Material(instance.albedo, instance.metallic, instance.roughness, instance.primaryCoff, instance.reflectToRefract, instance.refractionCoff);
+
+        info.position = ray.origin + ray.direction * distance;
+        info.interpolated = interpolatedVertex(_blasPositions[closestHit.triangle], _blasAttributes[closestHit.triangle], closestHit.barycentric);
+        info.interpolated.normal = transpose(mat3(instance.worldToObject)) * info.interpolated.normal;
+    }
+
+    info.albedo = material.albedo;
+    info.metallic = material.metallic;
+    info.roughness = material.roughness;
+    info.primaryToSecondaryRatio = material.primaryCoff;
+    info.reflectToRefractRatio = material.reflectToRefract;
+    info.refractionCoff = material.refractionCoff;
+
+    return info;
+}
+
+// Поиск ближайшего пересечения в структуре ускорения
+bool traceClosestHit(Ray ray, out float minIntersectionDist, out ClosestHit closestHit)
+{
+    // Минимальное расстояение до пересечения изначально "бесконечно" велико
+    minIntersectionDist = 3.402823466e+38;
+    closestHit = ClosestHit(0u, -1, vec2(0.0f));
+
+    bool intersceted;
+#ifdef SUBGROUP_TRAVERSAL
+    // Лучи подгруппы обходят структуру ускорения совместно (общие узлы и общий порядок потомков)
+    if(_subgroupTraversal)
+        intersceted = _accelerationStructure == AS_TWO_LEVEL ?
+                traceTwoLevelSubgroup(ray, minIntersectionDist, closestHit) :
+                traceSceneBvhSubgroup(ray, minIntersectionDist, closestHit);
+    else
+#endif
+    intersceted = _accelerationStructure == AS_TWO_LEVEL ?
+            traceTwoLevel(ray, minIntersectionDist, closestHit) :
+            traceSceneBvh(ray, minIntersectionDist, closestHit);
+
+    // Аналитические примитивы (собственная BVH, дальше найденного пересечения не обходится)
+    if(tracePrimitives(ray, minIntersectionDist, closestHit)) intersceted = true;
+
+    return intersceted;
+}
+
+// Ближайшее пересечение первичного луча по буферу видимости (треугольники мешей растеризованы заранее,
+// обходятся только аналитические примитивы - не дальше найденного треугольника)
+bool primaryClosestHit(ivec2 pixel, Ray ray, out float minIntersectionDist, out ClosestHit closestHit)
+{
+    minIntersectionDist = 3.402823466e+38;
+    closestHit = ClosestHit(0u, -1, vec2(0.0f));
+
+    bool intersceted = false;
+    uvec4 visibility = texelFetch(_visibilityBuffer, pixel, 0);
+
+    // Нулевой экземпляр - луч не попал ни в один треугольник
+    if(visibility.x > 0u)
+    {
+        int instanceIndex = int(visibility.x - 1u);
+        closestHit = ClosestHit(visibility.y, instanceIndex, unpackUnorm2x16(visibility.z));
+        minIntersectionDist = uintBitsToFloat(visibility.w);
+        intersceted = true;
+
+        // Растровые величины уточняются пересечением луча с тем же треугольником (как при обходе BLAS),
+        // растровые остаются лишь если луч проходит по самому ребру
+        mat4 worldToObject = _instances[instanceIndex].worldToObject;
+        Ray objectRay = Ray((worldToObject * vec4(ray.origin, 1.0f)).xyz, mat3(worldToObject) * ray.direction, ray.weight);
+        float distance;
+        vec2 barycentric;
+        if(testTriangle(_blasPositions[visibility.y], precomputeRay(objectRay), 3.402823466e+38, distance, barycentric)){
+            closestHit.barycentric = barycentric;
+            minIntersectionDist = distance;
+        }
+    }
+
+    // Аналитические примитивы не растеризуются
+    if(tracePrimitives(ray, minIntersectionDist, closestHit)) intersceted = true;
+
+    return intersceted;
+}
+
+// Отражение из ближайшего зонда, в радиус влияния которого попадает точка (уровень карты выбирается по шероховатости)
+bool reflectionProbeColor(vec3 position, vec3 direction, float roughness, out vec3 color)
+{
+    color = vec3(0.0f);
+
+    int nearest = -1;
+    float nearestDistance = 3.402823466e+38;
+    for(uint i = 0u; i < _reflectionProbeCount; i++)
+    {
+        float probeDistance = distance(position, _reflectionProbes[i].xyz);
+        if(probeDistance <= _reflectionProbes[i].w && probeDistance < nearestDistance){
+            nearest = int(i);
+            nearestDistance = probeDistance;
+        }
+    }
+    if(nearest < 0) return false;
+
+    float level = clamp(roughness, 0.0f, 1.0f) * float(textureQueryLevels(_reflectionProbeMaps) - 1);
+    color = textureLod(_reflectionProbeMaps, vec4(direction, float(_reflectionProbeLayers[nearest])), level).rgb;
+    return true;
+}
+
+// Расстояние от камеры до поверхности буфера видимости в пикселе ("бесконечность" - луч пикселя ни во что не попал)
+float visibilityDistance(vec2 screenPoint)
+{
+    uvec4 visibility = texelFetch(_visibilityBuffer, ivec2(screenPoint), 0);
+    return visibility.x > 0u ? uintBitsToFloat(visibility.w) : 3.402823466e+38;
+}
+
+// Отражение в экранном пространстве - отраженный луч проходится по буферу видимости (шаг не меньше пикселя),
+// цвет найденной поверхности берется из изображения предыдущего кадра
+// Луч, покинувший экран или не нашедший поверхности, трассируется как обычно
+bool screenSpaceReflection(Ray ray, out vec3 color)
+{
+    color = vec3(0.0f);
+    vec3 cameraPosition = _camModelMat[3].xyz;
+    vec2 screenSize = vec2(textureSize(_visibilityBuffer, 0));
+
+    // Отрезок луча не заходит за ближнюю плоскость (точки за ней не проецируются)
+    vec3 forward = -normalize(_camModelMat[2].xyz);
+    float originDepth = dot(ray.origin - cameraPosition, forward);
+    float directionDepth = dot(ray.direction, forward);
+    float rayLength = SCREEN_SPACE_REFLECTION_DISTANCE;
+    if(directionDepth < 0.0f) rayLength = min(rayLength, (originDepth - 2.0f * VISIBILITY_NEAR_PLANE) / -directionDepth);
+    if(rayLength <= 0.0f) return false;
+
+    // Концы отрезка на экране (в пикселях) и обратные глубины - точка мира интерполируется с учетом перспективы
+    vec3 endPoint = ray.origin + ray.direction * rayLength;
+    vec4 clipStart = _viewProjection * vec4(ray.origin, 1.0f);
+    vec4 clipEnd = _viewProjection * vec4(endPoint, 1.0f);
+    vec2 screenStart = (clipStart.xy / clipStart.w * 0.5f + 0.5f) * screenSize;
+    vec2 screenEnd = (clipEnd.xy / clipEnd.w * 0.5f + 0.5f) * screenSize;
+    vec2 screenDelta = screenEnd - screenStart;
+    vec2 invW = vec2(1.0f / clipStart.w, 1.0f / clipEnd.w);
+
+    // Часть отрезка в пределах экрана
+    float sMax = 1.0f;
+    for(int axis = 0; axis < 2; axis++){
+        if(screenDelta[axis] > 0.0f) sMax = min(sMax, (screenSize[axis] - 0.5f - screenStart[axis]) / screenDelta[axis]);
+        else if(screenDelta[axis] < 0.0f) sMax = min(sMax, (0.5f - screenStart[axis]) / screenDelta[axis]);
+    }
+
+    // Кол-во шагов (не больше пикселей отрезка и не больше предела)
+    float pixelLength = length(screenDelta) * sMax;
+    if(pixelLength < 1.0f) return false;
+    uint steps = min(_reflectionMaxSteps, uint(ceil(pixelLength)));
+    float stepSize = sMax / float(steps);
+
+    float previousS = 0.0f;
+    float previousDistance = distance(ray.origin, cameraPosition);
+    for(uint i = 1u; i <= steps; i++)
+    {
+        float s = stepSize * float(i);
+        float w = 1.0f / mix(invW.x, invW.y, s);
+        vec3 point = mix(ray.origin * invW.x, endPoint * invW.y, s) * w;
+        float rayDistance = distance(point, cameraPosition);
+        float sceneDistance = visibilityDistance(screenStart + screenDelta * s);
+
+        // Луч прошел за поверхность, но не глубже ее толщины
+        if(max(rayDistance, previousDistance) >= sceneDistance && min(rayDistance, previousDistance) <= sceneDistance + _reflectionThickness)
+        {
+            // Уточнение точки пересечения делением шага пополам
+            float sLow = previousS, sHigh = s;
+            for(int j = 0; j < 4; j++){
+                float sMid = (sLow + sHigh) * 0.5f;
+                float wMid = 1.0f / mix(invW.x, invW.y, sMid);
+                vec3 midPoint = mix(ray.origin * invW.x, endPoint * invW.y, sMid) * wMid;
+                if(distance(midPoint, cameraPosition) >= visibilityDistance(screenStart + screenDelta * sMid)) sHigh = sMid;
+                else sLow = sMid;
+            }
+            float wHit = 1.0f / mix(invW.x, invW.y, sHigh);
+            vec3 hitPoint = mix(ray.origin * invW.x, endPoint * invW.y, sHigh) * wHit;
+
+            // Аналитические примитивы не растеризуются - примитив на пути луча или перед найденной поверхностью
+            // (в изображении) означает, что отражение нужно трассировать
+            float hitDistance = distance(ray.origin, hitPoint);
+            float viewDistance = distance(cameraPosition, hitPoint);
+            ClosestHit closestHit = ClosestHit(0u, -1, vec2(0.0f));
+            if(tracePrimitives(ray, hitDistance, closestHit)) return false;
+            if(tracePrimitives(Ray(cameraPosition, (hitPoint - cameraPosition) / viewDistance, 1.0f), viewDistance, closestHit)) return false;
+
+            // Точка в изображении предыдущего кадра
+            vec4 historyClip = _reflectionHistoryViewProjection * vec4(hitPoint, 1.0f);
+            if(historyClip.w <= 0.0f) return false;
+            vec2 historyUv = historyClip.xy / historyClip.w * 0.5f + 0.5f;
+            if(any(lessThan(historyUv, vec2(0.0f))) || any(greaterThan(historyUv, vec2(1.0f)))) return false;
+
+            color = textureLod(_reflectionHistory, historyUv, 0.0f).rgb;
+            return true;
+        }
+
+        previousS = s;
+        previousDistance = rayDistance;
+    }
+
+    return false;
+}
+
+// Псевдослучайное число в [0, 1) для пикселя, номера луча и назначения (хеш PCG, без состояния между кадрами)
+float randomValue(uvec2 pixel, uint rayIndex, uint salt)
+{
+    uint state = pixel.x * 1973u + pixel.y * 9277u + rayIndex * 26699u + salt * 104729u;
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    word = (word >> 22u) ^ word;
+    return float(word >> 8u) / 16777216.0f;
+}
+
+// Отраженный и преломленный лучи точки пересечения (вес 0 - луча нет)
+// Доля отражения материала дополняется френелевским отражением преломляемой части (приближение Шлика),
+// коэффициент преломления материала - отношение показателей среды снаружи и внутри меша
+void secondaryRays(Ray ray, NearestIntersectionInfo hit, vec3 normal, float secondaryColorRatio, out Ray reflectedRay, out Ray refractedRay)
+{
+    // Нормаль со стороны падения луча (луч может выходить из меша)
+    bool entering = dot(ray.direction, normal) <= 0.0f;
+    vec3 facingNormal = entering ? normal : -normal;
+
+    float reflectionStrength = hit.reflectToRefractRatio;
+    vec3 refractedDir = vec3(0.0f);
+
+    // Без преломляющих материалов на сцене преломленный луч не выпускается (ветвь исключается при сборке)
+#if REFRACTION
+    if(reflectionStrength < 1.0f && hit.refractionCoff > 0.0f)
+    {
+        float eta = entering ? hit.refractionCoff : 1.0f / hit.refractionCoff;
+        refractedDir = refract(normalize(ray.direction), facingNormal, eta);
+
+        // При полном внутреннем отражении преломленного луча нет
+        if(refractedDir == vec3(0.0f)){
+            reflectionStrength = 1.0f;
+        }
+        else{
+            // Косинус берется в менее плотной среде
+            float cosine = eta <= 1.0f ? -dot(normalize(ray.direction), facingNormal) : -dot(refractedDir, facingNormal);
+            float f0 = (1.0f - eta) / (1.0f + eta);
+            f0 *= f0;
+            float fresnel = f0 + (1.0f - f0) * pow(1.0f - cosine, 5.0f);
+            reflectionStrength += (1.0f - reflectionStrength) * fresnel;
+        }
+    }
+    else{
+        reflectionStrength = max(reflectionStrength, 0.0f);
+    }
+#else
+    reflectionStrength = max(reflectionStrength, 0.0f);
+#endif
+
+    // Начало лучей чуть сдвигается по нормали (отраженного - наружу, преломленного - внутрь поверхности)
+    reflectedRay = Ray(hit.position + (facingNormal * 1e-3), reflect(ray.direction, facingNormal), reflectionStrength*secondaryColorRatio*ray.weight);
+    refractedRay = Ray(hit.position - (facingNormal * 1e-3), refractedDir, (refractedDir == vec3(0.0f) ? 0.0f : 1.0f - reflectionStrength)*secondaryColorRatio*ray.weight);
+}
+
+// Продолжается ли путь луча - луч с весом ниже порога участвует в русской рулетке
+// Выживший луч получает вес, равный порогу (вес делится на вероятность выживания - оценка остается несмещенной)
+bool continuePath(inout Ray ray, float random)
+{
+    if(ray.weight >= _rayWeightThreshold) return true;
+
+    float survival = ray.weight / _rayWeightThreshold;
+    if(random >= survival){
+        if(countsRayStatistics(false)) atomicCounterIncrement(_terminatedRays);
+        return false;
+    }
+
+    ray.weight = _rayWeightThreshold;
+    return true;
+}
+
+// Выбор одного из двух лучей случайно пропорционально весу (вес выбранного делится на вероятность выбора)
+Ray chooseSecondaryRay(Ray reflectedRay, Ray refractedRay, float random)
+{
+    if(refractedRay.weight <= 0.0f) return reflectedRay;
+    if(reflectedRay.weight <= 0.0f) return refractedRay;
+
+    float total = reflectedRay.weight + refractedRay.weight;
+    if(random * total < reflectedRay.weight){
+        reflectedRay.weight = total;
+        return reflectedRay;
+    }
+
+    refractedRay.weight = total;
+    return refractedRay;
+}
+
+// Собственный цвет точки пересечения - освещение источниками света (без учета веса луча)
+vec3 surfaceColor(Ray ray, NearestIntersectionInfo hit, vec3 normal, uvec2 pixel)
+{
+    // Сила базового цвета
+    float baseColorStrength = hit.primaryToSecondaryRatio;
+
+    // Итоговый цвет
+    vec3 finalyCalculatedColor = vec3(0.0f);
+
+    // Источники света (при их отсутствии на сцене цикл исключается при сборке)
+#if LIGHT_TYPES != 0
+    for(uint i = 0; i < _totalLights; i++)
+    {
+        // Направление от точки пересечения к источнику
+        vec3 toLight = normalize(_lightSources[i].position - hit.position);
+
+        // Отраженный вектор падения света на точку пересечения
+        vec3 reflected = reflect(-toLight, normal);
+
+        // Вычисление дифузной компоненты
+        vec3 diffuse = hit.albedo * max(dot(toLight,normal),0.0f);
+        // Вычисление бликовой компоненты
+        vec3 specular = vec3(1.0f,1.0f,1.0f) * pow(max(dot(-reflected, ray.direction),0.0f),32.0f);
+
+        // Итоговый цвет
+        finalyCalculatedColor = (diffuse + specular) * baseColorStrength;
+
+#if SHADOWS
+        // Теневые лучи выпускаются только если источник вносит вклад в цвет точки
+        if(any(greaterThan(finalyCalculatedColor, vec3(0.0f)))){
+            finalyCalculatedColor *= lightVisibility(hit.position, normal, i, randomValue(pixel, i, RANDOM_SHADOW));
+        }
+#endif
+    }
+#endif
+
+    return finalyCalculatedColor;
+}
+
+// Отражение, получаемое без трассировки отраженного луча (цвет без учета веса отраженного луча)
+// Отражение шероховатой поверхности или глубокого отскока берется из зонда, отражение первичного луча сначала
+// ищется в экранном пространстве
+bool untracedReflection(NearestIntersectionInfo hit, Ray reflectedRay, uint bounce, out vec3 color)
+{
+    if(reflectedRay.weight <= 0.0f) return false;
+
+    if((hit.roughness >= _reflectionProbeRoughness || bounce + 1u >= _reflectionProbeBounceDepth) &&
+            reflectionProbeColor(hit.position, reflectedRay.direction, hit.roughness, color)){
+        return true;
+    }
+
+    if(bounce == 0u && _screenSpaceReflections)
+    {
+        if(countsRayStatistics(true)) atomicCounterIncrement(_reflectionRays);
+        if(screenSpaceReflection(reflectedRay, color)){
+            if(countsRayStatistics(true)) atomicCounterIncrement(_screenSpaceReflectionHits);
+            return true;
+        }
+    }
+
+    return false;
+}
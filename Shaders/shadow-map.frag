@@ -0,0 +1,26 @@
+#version 330 core
+
+/*Схема входа-выхода*/
+
+// Расстояние от источника света до ближайшей поверхности
+layout (location = 0) out float lightDistance;
+
+/*Вход*/
+
+in VS_OUT
+{
+    vec3 position;
+} fs_in;
+
+/*Uniform*/
+
+uniform vec3 _lightPosition;               // Положение источника света
+
+/*Функции*/
+
+// Основная функция фрагментного (пиксельного) шейдера
+// Записывается расстояние вдоль луча от источника (а не глубина грани) - сравнивается с расстоянием до точки в любой грани
+void main()
+{
+    lightDistance = distance(fs_in.position, _lightPosition);
+}
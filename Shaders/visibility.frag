@@ -0,0 +1,41 @@
+#version 430 core
+
+/*Схема входа-выхода*/
+
+// Экземпляр (со сдвигом на единицу, 0 - пусто), треугольник BLAS, барицентрические координаты (unorm16x2)
+// и расстояние от камеры (битовое представление float)
+layout (location = 0) out uvec4 visibility;
+
+/*Вход*/
+
+in GS_OUT
+{
+    vec3 position;
+    vec2 barycentric;
+} fs_in;
+
+/*Uniform*/
+
+uniform vec3 _camPosition;                 // Положение камеры
+uniform uint _visibilityInstance;          // Индекс экземпляра меша в TLAS
+uniform uint _visibilityTriangleOffset;    // Сдвиг треугольников BLAS меша в общих буферах
+
+/*Буферы*/
+
+// Индекс треугольника BLAS (в порядке листьев) для каждого треугольника буфера индексов геометрии
+layout(std430, binding = 30) buffer blasLeafIndexBuffer {
+    uint _blasLeafIndices[];
+};
+
+/*Функции*/
+
+// Основная функция фрагментного (пиксельного) шейдера
+// Записывается то же, что нашел бы обход структуры ускорения первичным лучом этого пикселя
+void main()
+{
+    visibility = uvec4(
+            _visibilityInstance + 1u,
+            _blasLeafIndices[_visibilityTriangleOffset + uint(gl_PrimitiveID)],
+            packUnorm2x16(fs_in.barycentric),
+            floatBitsToUint(distance(fs_in.position, _camPosition)));
+}
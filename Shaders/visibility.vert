@@ -0,0 +1,31 @@
+#version 330 core
+
+/*Схема входа-выхода*/
+
+layout (location = 0) in vec3 position;
+
+/*Uniform*/
+
+uniform mat4 _model;                       // Матрица модели
+uniform mat4 _view;                        // Матрица вида
+uniform mat4 _projection;                  // Матрица проекции
+
+/*Выход*/
+
+out VS_OUT
+{
+    vec3 position;         // Положение вершины в мировых координатах
+} vs_out;
+
+/*Функции*/
+
+// Основная функция вершинного шейдера
+// В отличие от подготовки геометрии вершины проецируются - буфер видимости растеризуется с точки зрения камеры
+void main()
+{
+    // Положение вершины в мировых координатах
+    vs_out.position = (_model * vec4(position, 1.0)).xyz;
+
+    // Положение вершины в пространстве отсечения
+    gl_Position = _projection * _view * vec4(vs_out.position, 1.0);
+}
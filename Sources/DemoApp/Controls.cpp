@@ -1,6 +1,8 @@
 #include "Controls.h"
 #include "Camera.h"
 
+#include "../Renderer/Renderer.h"
+
 // Положение мыши
 static math::Vec2<int> _mousePositions;
 
@@ -8,6 +10,10 @@ static math::Vec2<int> _mousePositions;
 static math::Vec3<float> _camMovementRel = {0.0f, 0.0f, 0.0f};
 static math::Vec3<float> _camMovementAbs = {0.0f, 0.0f, 0.0f};
 
+// Тип структуры ускорения и способ подготовки геометрии (подготовка используется только с AS_SCENE_LBVH)
+static rtgl::AccelerationStructureType _accelerationStructure = rtgl::AS_TWO_LEVEL;
+static rtgl::GeometryPrepareMode _geometryPrepareMode = rtgl::GP_GEOMETRY_SHADER;
+
 // Камера (объявлено в Main.cpp)
 extern Camera* _camera;
 
@@ -77,6 +83,14 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT message, WPARAM wParam, LPARAM
                 case VK_ESCAPE:
                     PostQuitMessage(0);
                     break;
+                case 0x4C: // L (переключение структуры ускорения)
+                    _accelerationStructure = _accelerationStructure == rtgl::AS_TWO_LEVEL ? rtgl::AS_SCENE_LBVH : rtgl::AS_TWO_LEVEL;
+                    rtgl::SetAccelerationStructure(_accelerationStructure);
+                    break;
+                case 0x47: // G (переключение способа подготовки геометрии)
+                    _geometryPrepareMode = _geometryPrepareMode == rtgl::GP_GEOMETRY_SHADER ? rtgl::GP_COMPUTE_SHADER : rtgl::GP_GEOMETRY_SHADER;
+                    rtgl::SetGeometryPrepareMode(_geometryPrepareMode);
+                    break;
                 default:
                     break;
             }
@@ -84,12 +84,27 @@ int main(int argc, char* argv[])
         std::string gpv = tools::LoadStringFromFile(tools::ShaderDir().append("geometry-prepare.vert"));
         std::string gpg = tools::LoadStringFromFile(tools::ShaderDir().append("geometry-prepare.geom"));
         std::string gpf = tools::LoadStringFromFile(tools::ShaderDir().append("geometry-prepare.frag"));
+        std::string gpc = tools::LoadStringFromFile(tools::ShaderDir().append("geometry-prepare.comp"));
+
+        std::string bvh = tools::LoadStringFromFile(tools::ShaderDir().append("bvh-build.comp"));
 
         std::string rtv = tools::LoadStringFromFile(tools::ShaderDir().append("ray-tracing.vert"));
         std::string rtf = tools::LoadStringFromFile(tools::ShaderDir().append("ray-tracing.frag"));
+        std::string rtc = tools::LoadStringFromFile(tools::ShaderDir().append("ray-tracing.comp"));
+        std::string rtg = tools::LoadStringFromFile(tools::ShaderDir().append("ray-tracing-common.glsl"));
+
+        std::string vsv = tools::LoadStringFromFile(tools::ShaderDir().append("visibility.vert"));
+        std::string vsg = tools::LoadStringFromFile(tools::ShaderDir().append("visibility.geom"));
+        std::string vsf = tools::LoadStringFromFile(tools::ShaderDir().append("visibility.frag"));
+
+        std::string ppv = tools::LoadStringFromFile(tools::ShaderDir().append("post-process.vert"));
+        std::string ppf = tools::LoadStringFromFile(tools::ShaderDir().append("post-process.frag"));
+
+        std::string smv = tools::LoadStringFromFile(tools::ShaderDir().append("shadow-map.vert"));
+        std::string smf = tools::LoadStringFromFile(tools::ShaderDir().append("shadow-map.frag"));
 
         // Инициализация рендерера
-        if(!rtgl::Init(clientRect.right, clientRect.bottom, {gpv.c_str(), gpg.c_str(), gpf.c_str(),rtv.c_str(),rtf.c_str()})){
+        if(!rtgl::Init(clientRect.right, clientRect.bottom, {gpv.c_str(), gpg.c_str(), gpf.c_str(), gpc.c_str(), bvh.c_str(), rtv.c_str(), rtf.c_str(), rtc.c_str(), rtg.c_str(), vsv.c_str(), vsg.c_str(), vsf.c_str(), ppv.c_str(), ppf.c_str(), smv.c_str(), smf.c_str()})){
             throw std::runtime_error(rtgl::GetLastErrorMessage());
         }
 
@@ -111,6 +126,11 @@ int main(int argc, char* argv[])
         rtgl::SetMeshMaterialSettings(mesh2,{0.0f,0.0f,1.0f},0.0f,1.0f,0.2f);
         rtgl::SetMeshMaterialSettings(mesh3,{0.0f,0.0f,1.0f},0.0f,1.0f,0.5f);
 
+        // Меши добавляются на сохраняемую сцену один раз (каждый кадр готовятся заново лишь изменившиеся)
+        rtgl::AddMeshToScene(mesh1);
+        rtgl::AddMeshToScene(mesh2);
+        rtgl::AddMeshToScene(mesh3);
+
         // Источник света
         rtgl::HMesh lightSource1 = rtgl::CreateLightSource(
                 {0.0f,2.0f,0.0f},
@@ -147,7 +167,10 @@ int main(int argc, char* argv[])
 
             // Поскольку показ FPS на окне уменьшает FPS - делаем это только тогда когда счетчик готов (примерно 1 раз в секунду)
             if (_timer->isFpsCounterReady()){
-                std::string fps = std::string("Ray Tracing (").append(std::to_string(_timer->getFps())).append(" FPS)");
+                rtgl::FrameStatistics statistics;
+                rtgl::GetFrameStatistics(&statistics);
+                std::string fps = std::string("Ray Tracing (").append(std::to_string(_timer->getFps())).append(" FPS, geometry prepare ")
+                        .append(std::to_string(statistics.geometryPrepareTime)).append(" ms)");
                 SetWindowTextA(_hwnd, fps.c_str());
             }
 
@@ -165,10 +188,7 @@ int main(int argc, char* argv[])
 
             /// Отрисовка и показ кадра
 
-            // Заполнения буфера геометрии сцены
-            rtgl::SetMesh(mesh1);
-            rtgl::SetMesh(mesh2);
-            rtgl::SetMesh(mesh3);
+            // Источники света передаются каждый кадр (меши уже на сохраняемой сцене)
             rtgl::SetLightSource(lightSource1);
 
             // Трасировка сцены
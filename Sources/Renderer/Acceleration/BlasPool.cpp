@@ -0,0 +1,208 @@
+/**
+ * Хранилище BLAS (bottom level acceleration structure) всех геометрических буферов
+ * BLAS строится один раз при создании геометрии (в пространстве объекта) и размещается в общих SSBO
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "BlasPool.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param nodeBufferBinding Индекс привязки буфера узлов
+     * @param positionBufferBinding Индекс привязки буфера положений треугольников
+     * @param attributeBufferBinding Индекс привязки буфера атрибутов треугольников
+     * @param leafIndexBufferBinding Индекс привязки буфера соответствия треугольников буфера индексов треугольникам BLAS
+     */
+    BlasPool::BlasPool(GLuint nodeBufferBinding, GLuint positionBufferBinding, GLuint attributeBufferBinding, GLuint leafIndexBufferBinding):
+            nodeBufferId_(0),
+            positionBufferId_(0),
+            attributeBufferId_(0),
+            leafIndexBufferId_(0),
+            dirty_(false)
+    {
+        // Буферы изначально содержат по одному элементу (чтобы привязка была корректной до появления геометрии)
+        glGenBuffers(1, &nodeBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BvhBuilder::Node), nullptr, GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, nodeBufferBinding, nodeBufferId_);
+
+        glGenBuffers(1, &positionBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(TrianglePositions), nullptr, GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, positionBufferBinding, positionBufferId_);
+
+        glGenBuffers(1, &attributeBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, attributeBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(TriangleAttributes), nullptr, GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, attributeBufferBinding, attributeBufferId_);
+
+        glGenBuffers(1, &leafIndexBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, leafIndexBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, leafIndexBufferBinding, leafIndexBufferId_);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    BlasPool::~BlasPool()
+    {
+        if(this->nodeBufferId_) glDeleteBuffers(1, &nodeBufferId_);
+        if(this->positionBufferId_) glDeleteBuffers(1, &positionBufferId_);
+        if(this->attributeBufferId_) glDeleteBuffers(1, &attributeBufferId_);
+        if(this->leafIndexBufferId_) glDeleteBuffers(1, &leafIndexBufferId_);
+    }
+
+    /**
+     * Построение BLAS для геометрического буфера
+     * @param geometry Геометрический буфер (ключ записи)
+     * @param vertices Массив вершин
+     * @param indices Массив индексов
+     */
+    void BlasPool::add(const GeometryBuffer *geometry, const std::vector<rtgl::Vertex<GLfloat>> &vertices, const std::vector<GLuint> &indices)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if(triangleCount == 0) throw std::runtime_error("ERROR: Can't build BLAS without triangles");
+
+        // Границы треугольников (в пространстве объекта)
+        std::vector<BvhBuilder::Primitive> primitives(triangleCount);
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            primitives[t].min = glm::vec3(std::numeric_limits<GLfloat>::max());
+            primitives[t].max = glm::vec3(-std::numeric_limits<GLfloat>::max());
+
+            for(size_t v = 0; v < 3; v++){
+                if(indices[t * 3 + v] >= vertices.size()) throw std::runtime_error("ERROR: Vertex index is out of range");
+                const auto& p = vertices[indices[t * 3 + v]].position;
+                primitives[t].min = glm::min(primitives[t].min, glm::vec3(p.x, p.y, p.z));
+                primitives[t].max = glm::max(primitives[t].max, glm::vec3(p.x, p.y, p.z));
+            }
+        }
+
+        // Построение BVH
+        BvhBuilder::Result bvh = BvhBuilder::build(primitives);
+
+        // Треугольники в порядке листьев
+        Entry entry;
+        entry.nodes = std::move(bvh.nodes);
+        entry.positions.resize(triangleCount);
+        entry.attributes.resize(triangleCount);
+        entry.leafIndices.resize(triangleCount);
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            const GLuint source = bvh.order[t];
+            entry.leafIndices[source] = static_cast<GLuint>(t);
+
+            glm::vec3 p[3];
+            for(size_t v = 0; v < 3; v++){
+                const auto& vertex = vertices[indices[source * 3 + v]];
+                p[v] = {vertex.position.x, vertex.position.y, vertex.position.z};
+                entry.attributes[t].normalU[v] = {vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.uv.x};
+                entry.attributes[t].colorV[v] = {vertex.color.r, vertex.color.g, vertex.color.b, vertex.uv.y};
+            }
+
+            entry.positions[t] = {};
+            entry.positions[t].vertex0 = p[0];
+            entry.positions[t].edge1 = p[1] - p[0];
+            entry.positions[t].edge2 = p[2] - p[0];
+        }
+
+        // Границы корня - границы всей геометрии
+        entry.min = entry.nodes[0].min;
+        entry.max = entry.nodes[0].max;
+
+        entries_[geometry] = std::move(entry);
+        dirty_ = true;
+    }
+
+    /**
+     * Удаление BLAS геометрического буфера
+     * @param geometry Геометрический буфер
+     */
+    void BlasPool::remove(const GeometryBuffer *geometry)
+    {
+        if(entries_.erase(geometry) > 0) dirty_ = true;
+    }
+
+    /**
+     * Получить запись о BLAS геометрического буфера
+     * @param geometry Геометрический буфер
+     * @return Указатель на запись (nullptr если BLAS отсутствует)
+     */
+    const BlasPool::Entry *BlasPool::find(const GeometryBuffer *geometry) const
+    {
+        auto it = entries_.find(geometry);
+        return it != entries_.end() ? &it->second : nullptr;
+    }
+
+    /**
+     * Перевод границ BLAS в мировое пространство (по 8 углам коробки)
+     * @param entry Запись о BLAS
+     * @param model Матрица модели
+     * @param min Минимальная точка в мировом пространстве
+     * @param max Максимальная точка в мировом пространстве
+     */
+    void BlasPool::transformBounds(const Entry &entry, const glm::mat4 &model, glm::vec3 &min, glm::vec3 &max)
+    {
+        min = glm::vec3(std::numeric_limits<GLfloat>::max());
+        max = glm::vec3(-std::numeric_limits<GLfloat>::max());
+        for(GLuint c = 0; c < 8; c++){
+            const glm::vec3 corner((c & 1u) ? entry.max.x : entry.min.x, (c & 2u) ? entry.max.y : entry.min.y, (c & 4u) ? entry.max.z : entry.min.z);
+            const glm::vec3 world = glm::vec3(model * glm::vec4(corner, 1.0f));
+            min = glm::min(min, world);
+            max = glm::max(max, world);
+        }
+    }
+
+    /**
+     * Выгрузка всех BLAS в буферы (только если набор изменился)
+     */
+    void BlasPool::upload()
+    {
+        if(!dirty_) return;
+
+        // Сдвиги каждой записи в общих буферах
+        std::vector<BvhBuilder::Node> nodes;
+        std::vector<TrianglePositions> positions;
+        std::vector<TriangleAttributes> attributes;
+        std::vector<GLuint> leafIndices;
+        for(auto& item : entries_)
+        {
+            item.second.nodeOffset = static_cast<GLuint>(nodes.size());
+            item.second.triangleOffset = static_cast<GLuint>(positions.size());
+            nodes.insert(nodes.end(), item.second.nodes.begin(), item.second.nodes.end());
+            positions.insert(positions.end(), item.second.positions.begin(), item.second.positions.end());
+            attributes.insert(attributes.end(), item.second.attributes.begin(), item.second.attributes.end());
+
+            // Индексы треугольников в общем буфере (сдвиг записи уже учтен)
+            for(GLuint local : item.second.leafIndices) leafIndices.push_back(item.second.triangleOffset + local);
+        }
+
+        // Пустой набор - оставляем текущее содержимое (к нему никто не обращается)
+        if(!nodes.empty())
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBufferId_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(nodes.size() * sizeof(BvhBuilder::Node)), nodes.data(), GL_STATIC_DRAW);
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionBufferId_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(positions.size() * sizeof(TrianglePositions)), positions.data(), GL_STATIC_DRAW);
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, attributeBufferId_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(attributes.size() * sizeof(TriangleAttributes)), attributes.data(), GL_STATIC_DRAW);
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, leafIndexBufferId_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(leafIndices.size() * sizeof(GLuint)), leafIndices.data(), GL_STATIC_DRAW);
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+
+        dirty_ = false;
+    }
+}
@@ -0,0 +1,130 @@
+/**
+ * Хранилище BLAS (bottom level acceleration structure) всех геометрических буферов
+ * BLAS строится один раз при создании геометрии (в пространстве объекта) и размещается в общих SSBO
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "BvhBuilder.h"
+#include "../Resources/GeometryBuffer.h"
+
+#include <unordered_map>
+
+namespace rtgl
+{
+    class BlasPool final
+    {
+    public:
+        /// Положение треугольника BLAS - первая вершина и два ребра (соответствует TrianglePositions в шейдерах, std430)
+        struct TrianglePositions
+        {
+            glm::vec3 vertex0;
+            GLfloat padding0;
+            glm::vec3 edge1;
+            GLfloat padding1;
+            glm::vec3 edge2;
+            GLfloat padding2;
+        };
+
+        /// Атрибуты вершин треугольника BLAS - нормаль и u, цвет и v (соответствует TriangleAttributes в шейдерах, std430)
+        struct TriangleAttributes
+        {
+            glm::vec4 normalU[3];
+            glm::vec4 colorV[3];
+        };
+
+        /// Запись о BLAS конкретного геометрического буфера
+        struct Entry
+        {
+            // Сдвиг узлов и треугольников в общих буферах (актуален после upload)
+            GLuint nodeOffset = 0;
+            GLuint triangleOffset = 0;
+            // Границы геометрии в пространстве объекта
+            glm::vec3 min = glm::vec3(0.0f);
+            glm::vec3 max = glm::vec3(0.0f);
+            // Узлы и упорядоченные треугольники (положения для обхода и атрибуты для ближайшего пересечения отдельно)
+            std::vector<BvhBuilder::Node> nodes;
+            std::vector<TrianglePositions> positions;
+            std::vector<TriangleAttributes> attributes;
+            // Индекс треугольника в порядке листьев для каждого треугольника исходного буфера индексов
+            std::vector<GLuint> leafIndices;
+        };
+
+    private:
+        /// OpenGL дескриптор буфера узлов
+        GLuint nodeBufferId_;
+        /// OpenGL дескрипторы буферов положений и атрибутов треугольников
+        GLuint positionBufferId_;
+        GLuint attributeBufferId_;
+        /// OpenGL дескриптор буфера соответствия треугольников буфера индексов треугольникам BLAS (для буфера видимости)
+        GLuint leafIndexBufferId_;
+        /// Записи о BLAS каждого геометрического буфера
+        std::unordered_map<const GeometryBuffer*, Entry> entries_;
+        /// Требуется ли повторная выгрузка в буферы
+        bool dirty_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        BlasPool(const BlasPool& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        BlasPool& operator=(const BlasPool& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param nodeBufferBinding Индекс привязки буфера узлов
+         * @param positionBufferBinding Индекс привязки буфера положений треугольников
+         * @param attributeBufferBinding Индекс привязки буфера атрибутов треугольников
+         * @param leafIndexBufferBinding Индекс привязки буфера соответствия треугольников буфера индексов треугольникам BLAS
+         */
+        BlasPool(GLuint nodeBufferBinding, GLuint positionBufferBinding, GLuint attributeBufferBinding, GLuint leafIndexBufferBinding);
+
+        /**
+         * Очистка ресурса
+         */
+        ~BlasPool();
+
+        /**
+         * Построение BLAS для геометрического буфера
+         * @param geometry Геометрический буфер (ключ записи)
+         * @param vertices Массив вершин
+         * @param indices Массив индексов
+         */
+        void add(const GeometryBuffer* geometry, const std::vector<rtgl::Vertex<GLfloat>>& vertices, const std::vector<GLuint>& indices);
+
+        /**
+         * Удаление BLAS геометрического буфера
+         * @param geometry Геометрический буфер
+         */
+        void remove(const GeometryBuffer* geometry);
+
+        /**
+         * Получить запись о BLAS геометрического буфера
+         * @param geometry Геометрический буфер
+         * @return Указатель на запись (nullptr если BLAS отсутствует)
+         */
+        [[nodiscard]] const Entry* find(const GeometryBuffer* geometry) const;
+
+        /**
+         * Перевод границ BLAS в мировое пространство (по 8 углам коробки)
+         * @param entry Запись о BLAS
+         * @param model Матрица модели
+         * @param min Минимальная точка в мировом пространстве
+         * @param max Максимальная точка в мировом пространстве
+         */
+        static void transformBounds(const Entry& entry, const glm::mat4& model, glm::vec3& min, glm::vec3& max);
+
+        /**
+         * Выгрузка всех BLAS в буферы (только если набор изменился)
+         */
+        void upload();
+    };
+}
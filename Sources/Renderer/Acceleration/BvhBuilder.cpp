@@ -0,0 +1,211 @@
+/**
+ * Построитель BVH на стороне CPU (binned SAH)
+ * Используется для построения BLAS геометрии (треугольники) и TLAS сцены (экземпляры мешей)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "BvhBuilder.h"
+
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <thread>
+
+namespace rtgl
+{
+    // Кол-во корзин при оценке разбиений
+    const GLuint SAH_BINS = 12;
+    // Максимальный размер листа, при котором допускается отказ от разбиения (если разбиение не выгодно)
+    const GLuint SAH_MAX_LEAF_SIZE = 16;
+    // Минимальное кол-во примитивов поддерева, которое имеет смысл строить в отдельном потоке
+    const GLuint PARALLEL_MIN_PRIMITIVES = 4096;
+
+    /**
+     * Площадь поверхности коробки
+     * @param min Минимальная точка
+     * @param max Максимальная точка
+     * @return Площадь
+     */
+    static GLfloat surfaceArea(const glm::vec3& min, const glm::vec3& max)
+    {
+        const glm::vec3 d = glm::max(max - min, glm::vec3(0.0f));
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    /**
+     * Рекурсивное построение узла
+     * @param context Данные построения
+     * @param nodeIndex Индекс заполняемого узла
+     * @param begin Начало диапазона примитивов
+     * @param end Конец диапазона примитивов
+     * @param parallelDepth Оставшаяся глубина, на которой поддеревья строятся в отдельных потоках
+     */
+    void BvhBuilder::buildNode(BuildContext &context, GLint nodeIndex, GLuint begin, GLuint end, GLuint parallelDepth)
+    {
+        const auto& primitives = *context.primitives;
+        const GLuint count = end - begin;
+
+        // Границы узла и границы центров примитивов
+        glm::vec3 nodeMin(std::numeric_limits<GLfloat>::max()), nodeMax(-std::numeric_limits<GLfloat>::max());
+        glm::vec3 centerMin = nodeMin, centerMax = nodeMax;
+        for(GLuint i = begin; i < end; i++){
+            const GLuint p = context.order[i];
+            nodeMin = glm::min(nodeMin, primitives[p].min);
+            nodeMax = glm::max(nodeMax, primitives[p].max);
+            centerMin = glm::min(centerMin, context.centers[p]);
+            centerMax = glm::max(centerMax, context.centers[p]);
+        }
+
+        Node& node = context.nodes[nodeIndex];
+        node.min = nodeMin;
+        node.max = nodeMax;
+
+        // Достаточно малый диапазон - лист
+        if(count <= context.maxLeafSize){
+            node.left = static_cast<GLint>(begin);
+            node.right = -static_cast<GLint>(count);
+            return;
+        }
+
+        // Поиск наилучшего разбиения (ось и корзина) по стоимости SAH
+        GLfloat bestCost = std::numeric_limits<GLfloat>::max();
+        GLint bestAxis = -1;
+        GLuint bestBin = 0;
+
+        for(GLint axis = 0; axis < 3; axis++)
+        {
+            const GLfloat extent = centerMax[axis] - centerMin[axis];
+            if(extent <= 0.0f) continue;
+
+            // Распределение примитивов по корзинам
+            GLuint binCounts[SAH_BINS] = {};
+            glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+            std::fill(binMin, binMin + SAH_BINS, glm::vec3(std::numeric_limits<GLfloat>::max()));
+            std::fill(binMax, binMax + SAH_BINS, glm::vec3(-std::numeric_limits<GLfloat>::max()));
+
+            const GLfloat scale = static_cast<GLfloat>(SAH_BINS) / extent;
+            for(GLuint i = begin; i < end; i++){
+                const GLuint p = context.order[i];
+                const auto bin = std::min(static_cast<GLuint>((context.centers[p][axis] - centerMin[axis]) * scale), SAH_BINS - 1);
+                binCounts[bin]++;
+                binMin[bin] = glm::min(binMin[bin], primitives[p].min);
+                binMax[bin] = glm::max(binMax[bin], primitives[p].max);
+            }
+
+            // Площади и кол-ва примитивов слева от каждой границы корзин
+            GLfloat leftArea[SAH_BINS - 1];
+            GLuint leftCount[SAH_BINS - 1];
+            glm::vec3 accMin(std::numeric_limits<GLfloat>::max()), accMax(-std::numeric_limits<GLfloat>::max());
+            GLuint accCount = 0;
+            for(GLuint b = 0; b < SAH_BINS - 1; b++){
+                accMin = glm::min(accMin, binMin[b]);
+                accMax = glm::max(accMax, binMax[b]);
+                accCount += binCounts[b];
+                leftArea[b] = accCount > 0 ? surfaceArea(accMin, accMax) : 0.0f;
+                leftCount[b] = accCount;
+            }
+
+            // Проход справа налево с вычислением стоимости каждого разбиения
+            accMin = glm::vec3(std::numeric_limits<GLfloat>::max());
+            accMax = glm::vec3(-std::numeric_limits<GLfloat>::max());
+            accCount = 0;
+            for(GLuint b = SAH_BINS - 1; b > 0; b--){
+                accMin = glm::min(accMin, binMin[b]);
+                accMax = glm::max(accMax, binMax[b]);
+                accCount += binCounts[b];
+                if(leftCount[b - 1] == 0 || accCount == 0) continue;
+
+                const GLfloat cost = leftArea[b - 1] * static_cast<GLfloat>(leftCount[b - 1]) + surfaceArea(accMin, accMax) * static_cast<GLfloat>(accCount);
+                if(cost < bestCost){
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b - 1;
+                }
+            }
+        }
+
+        // Разбиение не выгодно (или невозможно) и примитивов немного - лист
+        const GLfloat leafCost = static_cast<GLfloat>(count);
+        const GLfloat nodeArea = surfaceArea(nodeMin, nodeMax);
+        const bool splitUseless = bestAxis < 0 || (nodeArea > 0.0f && 1.0f + bestCost / nodeArea >= leafCost);
+        if(splitUseless && count <= SAH_MAX_LEAF_SIZE){
+            node.left = static_cast<GLint>(begin);
+            node.right = -static_cast<GLint>(count);
+            return;
+        }
+
+        // Разделение диапазона (при невозможности разбиения по SAH - пополам)
+        GLuint middle = begin + count / 2;
+        if(bestAxis >= 0)
+        {
+            const GLfloat scale = static_cast<GLfloat>(SAH_BINS) / (centerMax[bestAxis] - centerMin[bestAxis]);
+            const auto it = std::partition(context.order.begin() + begin, context.order.begin() + end, [&](GLuint p){
+                return std::min(static_cast<GLuint>((context.centers[p][bestAxis] - centerMin[bestAxis]) * scale), SAH_BINS - 1) <= bestBin;
+            });
+
+            middle = static_cast<GLuint>(it - context.order.begin());
+            if(middle == begin || middle == end) middle = begin + count / 2;
+        }
+
+        // Потомки размещаются рядом друг с другом
+        const GLint children = context.nodeCount.fetch_add(2);
+        node.left = children;
+        node.right = children + 1;
+
+        // Крупные поддеревья строятся параллельно
+        if(parallelDepth > 0 && count >= PARALLEL_MIN_PRIMITIVES)
+        {
+            auto leftTask = std::async(std::launch::async, [&context, children, begin, middle, parallelDepth](){
+                buildNode(context, children, begin, middle, parallelDepth - 1);
+            });
+            buildNode(context, children + 1, middle, end, parallelDepth - 1);
+            leftTask.get();
+        }
+        else
+        {
+            buildNode(context, children, begin, middle, 0);
+            buildNode(context, children + 1, middle, end, 0);
+        }
+    }
+
+    /**
+     * Построение BVH
+     * @param primitives Массив границ примитивов
+     * @param maxLeafSize Максимальное кол-во примитивов в листе
+     * @param threads Кол-во потоков (0 - по кол-ву ядер процессора)
+     * @return Узлы и порядок примитивов
+     */
+    BvhBuilder::Result BvhBuilder::build(const std::vector<Primitive> &primitives, GLuint maxLeafSize, GLuint threads)
+    {
+        Result result;
+        if(primitives.empty()) return result;
+
+        // Подготовка данных построения
+        const auto count = static_cast<GLuint>(primitives.size());
+        BuildContext context;
+        context.primitives = &primitives;
+        context.maxLeafSize = std::max(maxLeafSize, 1u);
+        context.centers.resize(count);
+        context.order.resize(count);
+        context.nodes.resize(2 * count - 1);
+        context.nodeCount = 1;
+
+        for(GLuint i = 0; i < count; i++){
+            context.centers[i] = (primitives[i].min + primitives[i].max) * 0.5f;
+            context.order[i] = i;
+        }
+
+        // Глубина на которой поддеревья еще распределяются по потокам
+        if(threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+        GLuint parallelDepth = 0;
+        while((1u << parallelDepth) < threads) parallelDepth++;
+
+        // Построение начиная с корня
+        buildNode(context, 0, 0, count, parallelDepth);
+
+        context.nodes.resize(static_cast<size_t>(context.nodeCount.load()));
+        result.nodes = std::move(context.nodes);
+        result.order = std::move(context.order);
+        return result;
+    }
+}
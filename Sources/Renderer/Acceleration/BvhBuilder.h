@@ -0,0 +1,80 @@
+/**
+ * Построитель BVH на стороне CPU (binned SAH)
+ * Используется для построения BLAS геометрии (треугольники), TLAS сцены (экземпляры мешей) и BVH аналитических примитивов
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace rtgl
+{
+    class BvhBuilder final
+    {
+    public:
+        /// Узел BVH (соответствует структуре BvhNode в шейдерах, выравнивание std430)
+        struct Node
+        {
+            // Минимальная точка границ узла
+            glm::vec3 min;
+            // Внутренний узел - индекс левого потомка, лист - индекс первого примитива
+            GLint left;
+            // Максимальная точка границ узла
+            glm::vec3 max;
+            // Внутренний узел - индекс правого потомка, лист - кол-во примитивов со знаком минус
+            GLint right;
+        };
+
+        /// Границы примитива (треугольника или экземпляра)
+        struct Primitive
+        {
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        /// Результат построения
+        struct Result
+        {
+            // Узлы (корень - нулевой узел)
+            std::vector<Node> nodes;
+            // Порядок примитивов (листья ссылаются на диапазоны в этом порядке)
+            std::vector<GLuint> order;
+        };
+
+    private:
+        /// Данные общие для всех потоков построения
+        struct BuildContext
+        {
+            const std::vector<Primitive>* primitives = nullptr;
+            std::vector<glm::vec3> centers;
+            std::vector<GLuint> order;
+            std::vector<Node> nodes;
+            std::atomic<GLint> nodeCount{0};
+            GLuint maxLeafSize = 1;
+        };
+
+        /**
+         * Рекурсивное построение узла
+         * @param context Данные построения
+         * @param nodeIndex Индекс заполняемого узла
+         * @param begin Начало диапазона примитивов
+         * @param end Конец диапазона примитивов
+         * @param parallelDepth Оставшаяся глубина, на которой поддеревья строятся в отдельных потоках
+         */
+        static void buildNode(BuildContext& context, GLint nodeIndex, GLuint begin, GLuint end, GLuint parallelDepth);
+
+    public:
+        /**
+         * Построение BVH
+         * @param primitives Массив границ примитивов
+         * @param maxLeafSize Максимальное кол-во примитивов в листе
+         * @param threads Кол-во потоков (0 - по кол-ву ядер процессора)
+         * @return Узлы и порядок примитивов
+         */
+        static Result build(const std::vector<Primitive>& primitives, GLuint maxLeafSize = 4, GLuint threads = 0);
+    };
+}
@@ -0,0 +1,261 @@
+/**
+ * Упрощение геометрии стягиванием ребер по квадрикам ошибки (Garland-Heckbert)
+ * Используется для построения упрощенной геометрии мешей, которую обходят вторичные и теневые лучи
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "GeometrySimplifier.h"
+
+#include <map>
+#include <queue>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+namespace rtgl
+{
+    // Вес квадрик границ открытой геометрии (относительно квадрик треугольников)
+    const GLdouble BOUNDARY_WEIGHT = 100.0;
+
+    /// Группа вершин с совпадающим положением (стягивается как одна вершина)
+    struct SimplifierCluster
+    {
+        glm::dvec3 position;
+        glm::dmat4 quadric;
+        // Вершина исходного буфера, замещающая вершины стянутых в группу групп
+        GLuint representative;
+        // Треугольники, содержащие группу (включая удаленные - отбрасываются при обходе)
+        std::vector<GLuint> triangles;
+        // Версия группы (меняется при каждом стягивании в нее, устаревшие ребра очереди отбрасываются)
+        GLuint stamp;
+        bool alive;
+    };
+
+    /// Треугольник (вершины исходного буфера и их группы)
+    struct SimplifierTriangle
+    {
+        GLuint vertices[3];
+        GLuint clusters[3];
+        bool alive;
+    };
+
+    /// Кандидат на стягивание ребра (группа a стягивается в группу b)
+    struct SimplifierCollapse
+    {
+        GLdouble cost;
+        GLuint a, b;
+        GLuint stampA, stampB;
+        glm::dvec3 position;
+
+        bool operator>(const SimplifierCollapse& other) const { return cost > other.cost; }
+    };
+
+    /**
+     * Ошибка положения относительно квадрики
+     * @param quadric Квадрика
+     * @param position Положение
+     * @return Сумма квадратов расстояний до плоскостей квадрики
+     */
+    static GLdouble QuadricError(const glm::dmat4& quadric, const glm::dvec3& position)
+    {
+        const glm::dvec4 v(position, 1.0);
+        return glm::dot(v, quadric * v);
+    }
+
+    /**
+     * Квадрика плоскости (сумма квадратов расстояний до нее)
+     * @param normal Единичная нормаль плоскости
+     * @param point Точка плоскости
+     * @param weight Вес
+     * @return Квадрика
+     */
+    static glm::dmat4 PlaneQuadric(const glm::dvec3& normal, const glm::dvec3& point, GLdouble weight)
+    {
+        const glm::dvec4 plane(normal, -glm::dot(normal, point));
+        return glm::outerProduct(plane, plane) * weight;
+    }
+
+    /**
+     * Упрощение геометрии
+     * @param vertices Массив вершин
+     * @param indices Массив индексов
+     * @param targetTriangles Желаемое кол-во треугольников (может остаться больше, если стягивать нечего)
+     * @return Вершины и индексы упрощенной геометрии
+     */
+    GeometrySimplifier::Result GeometrySimplifier::simplify(const std::vector<Vertex<GLfloat>> &vertices, const std::vector<GLuint> &indices, size_t targetTriangles)
+    {
+        // Группы вершин с совпадающими положениями
+        std::vector<SimplifierCluster> clusters;
+        std::vector<GLuint> vertexClusters(vertices.size());
+        std::map<std::tuple<GLfloat, GLfloat, GLfloat>, GLuint> positionClusters;
+        for(size_t v = 0; v < vertices.size(); v++)
+        {
+            const auto& p = vertices[v].position;
+            auto it = positionClusters.emplace(std::make_tuple(p.x, p.y, p.z), static_cast<GLuint>(clusters.size()));
+            if(it.second) clusters.push_back({glm::dvec3(p.x, p.y, p.z), glm::dmat4(0.0), static_cast<GLuint>(v), {}, 0, true});
+            vertexClusters[v] = it.first->second;
+        }
+
+        // Треугольники и квадрики их плоскостей (с весом по площади), вырожденные треугольники отбрасываются
+        std::vector<SimplifierTriangle> triangles(indices.size() / 3);
+        std::map<std::pair<GLuint, GLuint>, std::pair<GLuint, GLuint>> edges;
+        size_t liveTriangles = 0;
+        for(size_t t = 0; t < triangles.size(); t++)
+        {
+            SimplifierTriangle& triangle = triangles[t];
+            for(size_t c = 0; c < 3; c++){
+                if(indices[t * 3 + c] >= vertices.size()) throw std::runtime_error("ERROR: Vertex index is out of range");
+                triangle.vertices[c] = indices[t * 3 + c];
+                triangle.clusters[c] = vertexClusters[triangle.vertices[c]];
+            }
+
+            const GLuint* cl = triangle.clusters;
+            triangle.alive = cl[0] != cl[1] && cl[1] != cl[2] && cl[0] != cl[2];
+            if(!triangle.alive) continue;
+
+            const glm::dvec3 cross = glm::cross(clusters[cl[1]].position - clusters[cl[0]].position, clusters[cl[2]].position - clusters[cl[0]].position);
+            const GLdouble length = glm::length(cross);
+            if(length > 0.0){
+                const glm::dmat4 quadric = PlaneQuadric(cross / length, clusters[cl[0]].position, length * 0.5);
+                for(size_t c = 0; c < 3; c++) clusters[cl[c]].quadric += quadric;
+            }
+
+            for(size_t c = 0; c < 3; c++){
+                clusters[cl[c]].triangles.push_back(static_cast<GLuint>(t));
+                auto& edge = edges[std::minmax(cl[c], cl[(c + 1) % 3])];
+                edge.first++;
+                edge.second = static_cast<GLuint>(t);
+            }
+            liveTriangles++;
+        }
+
+        // Границы (ребра одного треугольника) сохраняются квадриками плоскостей, перпендикулярных треугольнику
+        for(const auto& edge : edges)
+        {
+            if(edge.second.first != 1) continue;
+
+            const GLuint* cl = triangles[edge.second.second].clusters;
+            const glm::dvec3 normal = glm::cross(clusters[cl[1]].position - clusters[cl[0]].position, clusters[cl[2]].position - clusters[cl[0]].position);
+            const glm::dvec3& a = clusters[edge.first.first].position;
+            const glm::dvec3 direction = clusters[edge.first.second].position - a;
+            const glm::dvec3 boundary = glm::cross(direction, normal);
+            const GLdouble length = glm::length(boundary);
+            if(length <= 0.0) continue;
+
+            const glm::dmat4 quadric = PlaneQuadric(boundary / length, a, BOUNDARY_WEIGHT * glm::dot(direction, direction));
+            clusters[edge.first.first].quadric += quadric;
+            clusters[edge.first.second].quadric += quadric;
+        }
+
+        // Кандидат на стягивание - положение с наименьшей ошибкой среди концов ребра и его середины
+        std::priority_queue<SimplifierCollapse, std::vector<SimplifierCollapse>, std::greater<>> queue;
+        auto pushCollapse = [&](GLuint a, GLuint b)
+        {
+            const glm::dmat4 quadric = clusters[a].quadric + clusters[b].quadric;
+            const glm::dvec3 candidates[3] = {clusters[b].position, clusters[a].position, (clusters[a].position + clusters[b].position) * 0.5};
+
+            SimplifierCollapse collapse = {QuadricError(quadric, candidates[0]), a, b, clusters[a].stamp, clusters[b].stamp, candidates[0]};
+            for(size_t i = 1; i < 3; i++){
+                const GLdouble cost = QuadricError(quadric, candidates[i]);
+                if(cost < collapse.cost){
+                    collapse.cost = cost;
+                    collapse.position = candidates[i];
+                }
+            }
+            queue.push(collapse);
+        };
+        for(const auto& edge : edges) pushCollapse(edge.first.first, edge.first.second);
+
+        // Переворачивает ли перенос группы в новое положение какой-либо из ее треугольников (кроме стягиваемых)
+        auto flips = [&](GLuint moved, GLuint other, const glm::dvec3& position)
+        {
+            for(GLuint t : clusters[moved].triangles)
+            {
+                const SimplifierTriangle& triangle = triangles[t];
+                if(!triangle.alive) continue;
+                if(triangle.clusters[0] == other || triangle.clusters[1] == other || triangle.clusters[2] == other) continue;
+
+                glm::dvec3 before[3], after[3];
+                for(size_t c = 0; c < 3; c++){
+                    before[c] = clusters[triangle.clusters[c]].position;
+                    after[c] = triangle.clusters[c] == moved ? position : before[c];
+                }
+                const glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if(glm::dot(normalBefore, normalAfter) <= 0.0) return true;
+            }
+            return false;
+        };
+
+        // Стягивание ребер с наименьшей ошибкой до достижения желаемого кол-ва треугольников
+        while(liveTriangles > targetTriangles && !queue.empty())
+        {
+            const SimplifierCollapse collapse = queue.top();
+            queue.pop();
+
+            SimplifierCluster& a = clusters[collapse.a];
+            SimplifierCluster& b = clusters[collapse.b];
+            if(!a.alive || !b.alive || a.stamp != collapse.stampA || b.stamp != collapse.stampB) continue;
+            if(flips(collapse.a, collapse.b, collapse.position) || flips(collapse.b, collapse.a, collapse.position)) continue;
+
+            // Треугольники ребра вырождаются, остальные треугольники группы a переходят к группе b
+            for(GLuint t : a.triangles)
+            {
+                SimplifierTriangle& triangle = triangles[t];
+                if(!triangle.alive) continue;
+
+                bool degenerate = false;
+                for(GLuint c : triangle.clusters) degenerate = degenerate || c == collapse.b;
+                if(degenerate){
+                    triangle.alive = false;
+                    liveTriangles--;
+                    continue;
+                }
+
+                for(size_t c = 0; c < 3; c++){
+                    if(triangle.clusters[c] != collapse.a) continue;
+                    triangle.clusters[c] = collapse.b;
+                    triangle.vertices[c] = b.representative;
+                }
+                b.triangles.push_back(t);
+            }
+
+            a.alive = false;
+            a.triangles.clear();
+            b.position = collapse.position;
+            b.quadric += a.quadric;
+            b.stamp++;
+            b.triangles.erase(std::remove_if(b.triangles.begin(), b.triangles.end(), [&](GLuint t){ return !triangles[t].alive; }), b.triangles.end());
+
+            // Ребра группы b с новой ошибкой (прежние записи очереди устарели)
+            for(GLuint t : b.triangles){
+                for(GLuint c : triangles[t].clusters){
+                    if(c != collapse.b) pushCollapse(c, collapse.b);
+                }
+            }
+        }
+
+        // Используемые вершины исходного буфера (положение - положение их группы)
+        Result result;
+        std::vector<GLint> remap(vertices.size(), -1);
+        for(const SimplifierTriangle& triangle : triangles)
+        {
+            if(!triangle.alive) continue;
+            for(size_t c = 0; c < 3; c++)
+            {
+                const GLuint v = triangle.vertices[c];
+                if(remap[v] < 0){
+                    remap[v] = static_cast<GLint>(result.vertices.size());
+                    Vertex<GLfloat> vertex = vertices[v];
+                    const glm::dvec3& p = clusters[triangle.clusters[c]].position;
+                    vertex.position = {static_cast<GLfloat>(p.x), static_cast<GLfloat>(p.y), static_cast<GLfloat>(p.z)};
+                    result.vertices.push_back(vertex);
+                }
+                result.indices.push_back(static_cast<GLuint>(remap[v]));
+            }
+        }
+
+        return result;
+    }
+}
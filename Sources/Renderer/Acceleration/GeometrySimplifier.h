@@ -0,0 +1,37 @@
+/**
+ * Упрощение геометрии стягиванием ребер по квадрикам ошибки (Garland-Heckbert)
+ * Используется для построения упрощенной геометрии мешей, которую обходят вторичные и теневые лучи
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+#include <vector>
+#include <GL/glew.h>
+
+namespace rtgl
+{
+    class GeometrySimplifier final
+    {
+    public:
+        /// Результат упрощения
+        struct Result
+        {
+            std::vector<Vertex<GLfloat>> vertices;
+            std::vector<GLuint> indices;
+        };
+
+        /**
+         * Упрощение геометрии
+         * @details Вершины с совпадающими положениями стягиваются вместе (швы нормалей и текстурных координат не
+         * разрываются), границы открытой геометрии сохраняются, стягивания, переворачивающие треугольники, отклоняются
+         * @param vertices Массив вершин
+         * @param indices Массив индексов
+         * @param targetTriangles Желаемое кол-во треугольников (может остаться больше, если стягивать нечего)
+         * @return Вершины и индексы упрощенной геометрии
+         */
+        static Result simplify(const std::vector<Vertex<GLfloat>>& vertices, const std::vector<GLuint>& indices, size_t targetTriangles);
+    };
+}
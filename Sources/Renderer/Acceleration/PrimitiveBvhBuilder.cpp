@@ -0,0 +1,127 @@
+/**
+ * Построитель BVH аналитических примитивов - узлы и записи примитивов выгружаются в собственные буферы
+ * Перестраивается каждый кадр (как и TLAS), стоимость зависит только от кол-ва примитивов
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "PrimitiveBvhBuilder.h"
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param nodeBufferBinding Индекс привязки буфера узлов
+     * @param recordBufferBinding Индекс привязки буфера записей примитивов
+     */
+    PrimitiveBvhBuilder::PrimitiveBvhBuilder(GLuint nodeBufferBinding, GLuint recordBufferBinding):
+            nodeBufferId_(0),
+            recordBufferId_(0)
+    {
+        // Буферы изначально содержат один элемент (чтобы привязки были корректными до первого построения)
+        glGenBuffers(1, &nodeBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BvhBuilder::Node), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, nodeBufferBinding, nodeBufferId_);
+
+        glGenBuffers(1, &recordBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, recordBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Record), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, recordBufferBinding, recordBufferId_);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    PrimitiveBvhBuilder::~PrimitiveBvhBuilder()
+    {
+        if(this->nodeBufferId_) glDeleteBuffers(1, &nodeBufferId_);
+        if(this->recordBufferId_) glDeleteBuffers(1, &recordBufferId_);
+    }
+
+    /**
+     * Добавить примитив
+     * @param primitive Указатель на примитив
+     */
+    void PrimitiveBvhBuilder::addPrimitive(const Primitive *primitive)
+    {
+        primitives_.push_back(primitive);
+    }
+
+    /**
+     * Очистить набор примитивов
+     */
+    void PrimitiveBvhBuilder::clear()
+    {
+        primitives_.clear();
+    }
+
+    /**
+     * Построение BVH и выгрузка узлов и записей примитивов в буферы
+     * @param dataPool Хранилище данных примитивов (должно быть выгружено)
+     */
+    void PrimitiveBvhBuilder::build(const PrimitiveDataPool &dataPool)
+    {
+        if(primitives_.empty()) return;
+
+        // Мировые границы и данные каждого примитива
+        std::vector<BvhBuilder::Primitive> bounds(primitives_.size());
+        std::vector<Record> records(primitives_.size());
+
+        for(size_t i = 0; i < primitives_.size(); i++)
+        {
+            const Primitive* primitive = primitives_[i];
+            primitive->getWorldBounds(bounds[i].min, bounds[i].max);
+
+            Record& record = records[i];
+            record = {};
+            record.worldToObject = glm::inverse(primitive->getModelMatrix());
+            record.albedo = primitive->material.albedo;
+            record.metallic = primitive->material.metallic;
+            record.roughness = primitive->material.roughness;
+            record.primaryCoff = primitive->material.primaryToSecondary;
+            record.reflectToRefract = primitive->material.reflectionToRefraction;
+            record.refractionCoff = primitive->material.refractionCoff;
+            record.type = static_cast<GLuint>(primitive->type);
+
+            if(primitive->type == PrimitiveType::PRIMITIVE_HEIGHTFIELD){
+                record.dataOffset = dataPool.getOffset(primitive->heightfield);
+                record.dataWidth = primitive->heightfield->getWidth();
+                record.dataDepth = primitive->heightfield->getDepth();
+            }
+            else if(primitive->type == PrimitiveType::PRIMITIVE_VOXELS){
+                record.dataOffset = dataPool.getOffset(primitive->voxels);
+                record.dataWidth = primitive->voxels->getResolution();
+                record.dataDepth = primitive->voxels->getResolution();
+            }
+        }
+
+        // Построение BVH (примитивов немного - в одном потоке)
+        BvhBuilder::Result bvh = BvhBuilder::build(bounds, 1, 1);
+
+        // Записи в порядке листьев
+        std::vector<Record> ordered(records.size());
+        for(size_t i = 0; i < records.size(); i++){
+            ordered[i] = records[bvh.order[i]];
+        }
+
+        // Выгрузка узлов и записей (буферы пересоздаются под текущий размер)
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(bvh.nodes.size() * sizeof(BvhBuilder::Node)), bvh.nodes.data(), GL_STREAM_DRAW);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, recordBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(ordered.size() * sizeof(Record)), ordered.data(), GL_STREAM_DRAW);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Кол-во примитивов текущего кадра
+     * @return Кол-во примитивов
+     */
+    GLuint PrimitiveBvhBuilder::getCount() const
+    {
+        return static_cast<GLuint>(primitives_.size());
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * Построитель BVH аналитических примитивов - узлы и записи примитивов выгружаются в собственные буферы
+ * Перестраивается каждый кадр (как и TLAS), стоимость зависит только от кол-ва примитивов
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "BvhBuilder.h"
+#include "PrimitiveDataPool.h"
+#include "../Scene/Primitive.h"
+
+#include <vector>
+
+namespace rtgl
+{
+    class PrimitiveBvhBuilder final
+    {
+    public:
+        /// Запись примитива (соответствует структуре Primitive в шейдерах, выравнивание std430)
+        struct Record
+        {
+            // Матрица перевода луча из мирового пространства в пространство объекта
+            glm::mat4 worldToObject;
+            // Материал
+            glm::vec3 albedo;
+            GLfloat metallic;
+            GLfloat roughness;
+            GLfloat primaryCoff;
+            GLfloat reflectToRefract;
+            GLfloat refractionCoff;
+            // Тип примитива (значение PrimitiveType)
+            GLuint type;
+            // Сдвиг данных примитива в общем буфере и их размеры по осям X и Z
+            // (карта высот - кол-во отсчетов, октодерево - кол-во вокселей по стороне сетки)
+            GLuint dataOffset;
+            GLuint dataWidth;
+            GLuint dataDepth;
+        };
+
+    private:
+        /// OpenGL дескриптор буфера узлов BVH примитивов
+        GLuint nodeBufferId_;
+        /// OpenGL дескриптор буфера записей примитивов
+        GLuint recordBufferId_;
+        /// Примитивы добавленные на сцену в текущем кадре
+        std::vector<const Primitive*> primitives_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        PrimitiveBvhBuilder(const PrimitiveBvhBuilder& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        PrimitiveBvhBuilder& operator=(const PrimitiveBvhBuilder& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param nodeBufferBinding Индекс привязки буфера узлов
+         * @param recordBufferBinding Индекс привязки буфера записей примитивов
+         */
+        PrimitiveBvhBuilder(GLuint nodeBufferBinding, GLuint recordBufferBinding);
+
+        /**
+         * Очистка ресурса
+         */
+        ~PrimitiveBvhBuilder();
+
+        /**
+         * Добавить примитив
+         * @param primitive Указатель на примитив
+         */
+        void addPrimitive(const Primitive* primitive);
+
+        /**
+         * Очистить набор примитивов
+         */
+        void clear();
+
+        /**
+         * Построение BVH и выгрузка узлов и записей примитивов в буферы
+         * @param dataPool Хранилище данных примитивов (должно быть выгружено)
+         */
+        void build(const PrimitiveDataPool& dataPool);
+
+        /**
+         * Кол-во примитивов текущего кадра
+         * @return Кол-во примитивов
+         */
+        [[nodiscard]] GLuint getCount() const;
+    };
+}
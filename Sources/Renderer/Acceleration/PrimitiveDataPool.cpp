@@ -0,0 +1,141 @@
+/**
+ * Хранилище данных примитивов (карты высот, октодеревья вокселей) - данные всех ресурсов размещаются
+ * в общем буфере текстуры (usamplerBuffer), значения float хранятся своим битовым представлением
+ * Буфер текстуры не занимает блоков хранения программы трассировки (их кол-во ограничено)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "PrimitiveDataPool.h"
+
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param textureUnit Текстурный блок, к которому привязывается буфер
+     */
+    PrimitiveDataPool::PrimitiveDataPool(GLuint textureUnit):
+            bufferId_(0),
+            textureId_(0),
+            maxTexels_(0),
+            texelCount_(0),
+            dirty_(false)
+    {
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels_);
+
+        // Буфер изначально содержит одно значение (чтобы привязка была корректной до появления ресурсов)
+        const GLuint empty = 0;
+        glGenBuffers(1, &bufferId_);
+        glBindBuffer(GL_TEXTURE_BUFFER, bufferId_);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(GLuint), &empty, GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // Текстура ссылается на буфер и остается привязанной к своему блоку (пересоздание буфера ее не затрагивает)
+        glGenTextures(1, &textureId_);
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, textureId_);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, bufferId_);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    PrimitiveDataPool::~PrimitiveDataPool()
+    {
+        if(this->textureId_) glDeleteTextures(1, &textureId_);
+        if(this->bufferId_) glDeleteBuffers(1, &bufferId_);
+    }
+
+    /**
+     * Регистрация участка ресурса
+     * @param resource Ресурс
+     * @param data Значения ресурса в порядке размещения в буфере
+     * @param texelCount Кол-во значений
+     */
+    void PrimitiveDataPool::addRange(const void *resource, const GLvoid *data, size_t texelCount)
+    {
+        if(texelCount_ + texelCount > static_cast<size_t>(maxTexels_))
+            throw std::runtime_error("Not enough space in primitive data buffer");
+
+        ranges_[resource] = {data, texelCount, 0};
+        texelCount_ += texelCount;
+        dirty_ = true;
+    }
+
+    /**
+     * Добавление карты высот (отсчеты float хранятся своим битовым представлением)
+     * @param heightfield Карта высот
+     */
+    void PrimitiveDataPool::add(const Heightfield *heightfield)
+    {
+        this->addRange(heightfield, heightfield->getSamples().data(), heightfield->getSamples().size());
+    }
+
+    /**
+     * Добавление октодерева вокселей
+     * @param octree Октодерево
+     */
+    void PrimitiveDataPool::add(const VoxelOctree *octree)
+    {
+        this->addRange(octree, octree->getNodes().data(), octree->getNodes().size());
+    }
+
+    /**
+     * Удаление данных ресурса
+     * @param resource Ресурс
+     */
+    void PrimitiveDataPool::remove(const void *resource)
+    {
+        auto it = ranges_.find(resource);
+        if(it == ranges_.end()) return;
+
+        texelCount_ -= it->second.texelCount;
+        ranges_.erase(it);
+        dirty_ = true;
+    }
+
+    /**
+     * Сдвиг данных ресурса в общем буфере
+     * @param resource Ресурс
+     * @return Сдвиг (в значениях)
+     */
+    GLuint PrimitiveDataPool::getOffset(const void *resource) const
+    {
+        auto it = ranges_.find(resource);
+        if(it == ranges_.end()) throw std::runtime_error("Primitive data resource is not registered");
+        return it->second.offset;
+    }
+
+    /**
+     * Выгрузка данных всех ресурсов в буфер (только если набор изменился)
+     */
+    void PrimitiveDataPool::upload()
+    {
+        if(!dirty_) return;
+
+        // Пустой набор - оставляем текущее содержимое (к нему никто не обращается)
+        if(texelCount_ > 0)
+        {
+            // Буфер выделяется под все ресурсы, данные каждого копируются в свой участок прямо из памяти ресурса
+            glBindBuffer(GL_TEXTURE_BUFFER, bufferId_);
+            glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(texelCount_ * sizeof(GLuint)), nullptr, GL_STATIC_DRAW);
+
+            GLuint offset = 0;
+            for(auto& item : ranges_)
+            {
+                item.second.offset = offset;
+                glBufferSubData(GL_TEXTURE_BUFFER,
+                        static_cast<GLintptr>(offset * sizeof(GLuint)),
+                        static_cast<GLsizeiptr>(item.second.texelCount * sizeof(GLuint)),
+                        item.second.data);
+                offset += static_cast<GLuint>(item.second.texelCount);
+            }
+
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        dirty_ = false;
+    }
+}
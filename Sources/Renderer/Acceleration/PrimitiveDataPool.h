@@ -0,0 +1,107 @@
+/**
+ * Хранилище данных примитивов (карты высот, октодеревья вокселей) - данные всех ресурсов размещаются
+ * в общем буфере текстуры (usamplerBuffer), значения float хранятся своим битовым представлением
+ * Буфер текстуры не занимает блоков хранения программы трассировки (их кол-во ограничено)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Resources/Heightfield.h"
+#include "../Resources/VoxelOctree.h"
+
+#include <unordered_map>
+
+namespace rtgl
+{
+    class PrimitiveDataPool final
+    {
+    private:
+        /// OpenGL дескриптор буфера значений
+        GLuint bufferId_;
+        /// OpenGL дескриптор текстуры, представляющей буфер (формат R32UI)
+        GLuint textureId_;
+        /// Предельное кол-во значений в буфере текстуры
+        GLint maxTexels_;
+        /// Участок ресурса в общем буфере (данные не копируются - выгружаются прямо из памяти ресурса)
+        struct Range
+        {
+            /// Значения ресурса (принадлежат ресурсу, неизменны после его создания)
+            const GLvoid* data;
+            /// Кол-во значений
+            size_t texelCount;
+            /// Сдвиг в общем буфере (актуален после upload)
+            GLuint offset;
+        };
+
+        /// Участки каждого ресурса (ресурс => участок)
+        std::unordered_map<const void*, Range> ranges_;
+        /// Общее кол-во значений всех ресурсов
+        size_t texelCount_;
+        /// Требуется ли повторная выгрузка в буфер
+        bool dirty_;
+
+        /**
+         * Регистрация участка ресурса
+         * @param resource Ресурс
+         * @param data Значения ресурса в порядке размещения в буфере
+         * @param texelCount Кол-во значений
+         */
+        void addRange(const void* resource, const GLvoid* data, size_t texelCount);
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        PrimitiveDataPool(const PrimitiveDataPool& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        PrimitiveDataPool& operator=(const PrimitiveDataPool& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param textureUnit Текстурный блок, к которому привязывается буфер
+         */
+        explicit PrimitiveDataPool(GLuint textureUnit);
+
+        /**
+         * Очистка ресурса
+         */
+        ~PrimitiveDataPool();
+
+        /**
+         * Добавление карты высот (отсчеты float хранятся своим битовым представлением)
+         * @param heightfield Карта высот
+         */
+        void add(const Heightfield* heightfield);
+
+        /**
+         * Добавление октодерева вокселей
+         * @param octree Октодерево
+         */
+        void add(const VoxelOctree* octree);
+
+        /**
+         * Удаление данных ресурса
+         * @param resource Ресурс
+         */
+        void remove(const void* resource);
+
+        /**
+         * Сдвиг данных ресурса в общем буфере
+         * @param resource Ресурс
+         * @return Сдвиг (в значениях)
+         */
+        [[nodiscard]] GLuint getOffset(const void* resource) const;
+
+        /**
+         * Выгрузка данных всех ресурсов в буфер (только если набор изменился)
+         */
+        void upload();
+    };
+}
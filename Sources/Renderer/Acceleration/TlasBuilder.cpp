@@ -0,0 +1,152 @@
+/**
+ * Построитель TLAS (top level acceleration structure) - BVH над экземплярами мешей сцены
+ * Перестраивается каждый кадр, стоимость зависит только от кол-ва экземпляров
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "TlasBuilder.h"
+
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param instanceBufferBinding Индекс привязки буфера экземпляров
+     */
+    TlasBuilder::TlasBuilder(GLuint instanceBufferBinding):
+            instanceBufferId_(0)
+    {
+        // Буфер изначально содержит один элемент (чтобы привязка была корректной до первого построения)
+        glGenBuffers(1, &instanceBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Instance), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instanceBufferBinding, instanceBufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    TlasBuilder::~TlasBuilder()
+    {
+        if(this->instanceBufferId_) glDeleteBuffers(1, &instanceBufferId_);
+    }
+
+    /**
+     * Добавить меш как экземпляр
+     * @param mesh Указатель на меш
+     */
+    void TlasBuilder::addMesh(const Mesh *mesh)
+    {
+        meshes_.push_back(mesh);
+    }
+
+    /**
+     * Очистить набор экземпляров
+     */
+    void TlasBuilder::clear()
+    {
+        meshes_.clear();
+        instanceMeshes_.clear();
+        instanceGeometries_.clear();
+    }
+
+    /**
+     * Построение TLAS и выгрузка узлов и экземпляров в буферы
+     * @param blasPool Хранилище BLAS (должно быть выгружено)
+     * @param nodeBufferId Буфер узлов BVH сцены
+     * @param viewPosition Положение камеры (для выбора геометрии первичных лучей по расстоянию)
+     */
+    void TlasBuilder::build(const BlasPool &blasPool, GLuint nodeBufferId, const glm::vec3& viewPosition)
+    {
+        if(meshes_.empty()) return;
+
+        // Мировые границы и данные каждого экземпляра
+        std::vector<BvhBuilder::Primitive> primitives(meshes_.size());
+        std::vector<Instance> instances(meshes_.size());
+        std::vector<const GeometryBuffer*> geometries(meshes_.size());
+
+        for(size_t i = 0; i < meshes_.size(); i++)
+        {
+            const Mesh* mesh = meshes_[i];
+            const BlasPool::Entry* blas = blasPool.find(mesh->geometry);
+            if(blas == nullptr) throw std::runtime_error("Mesh geometry has no acceleration structure");
+
+            // Границы BLAS переводятся в мировое пространство
+            const glm::mat4& model = mesh->getModelMatrix();
+            BlasPool::transformBounds(*blas, model, primitives[i].min, primitives[i].max);
+
+            Instance& instance = instances[i];
+            instance = {};
+            instance.worldToObject = glm::inverse(model);
+            instance.albedo = mesh->material.albedo;
+            instance.metallic = mesh->material.metallic;
+            instance.roughness = mesh->material.roughness;
+            instance.primaryCoff = mesh->material.primaryToSecondary;
+            instance.reflectToRefract = mesh->material.reflectionToRefraction;
+            instance.refractionCoff = mesh->material.refractionCoff;
+            instance.nodeOffset = blas->nodeOffset;
+            instance.triangleOffset = blas->triangleOffset;
+            instance.proxyNodeOffset = blas->nodeOffset;
+            instance.proxyTriangleOffset = blas->triangleOffset;
+            geometries[i] = mesh->geometry;
+
+            // Упрощенную геометрию обходят вторичные лучи, а первичные - если границы меша дальше заданного расстояния
+            const BlasPool::Entry* proxy = mesh->proxy != nullptr ? blasPool.find(mesh->proxy) : nullptr;
+            if(proxy != nullptr)
+            {
+                instance.proxyNodeOffset = proxy->nodeOffset;
+                instance.proxyTriangleOffset = proxy->triangleOffset;
+
+                const glm::vec3 nearest = glm::clamp(viewPosition, primitives[i].min, primitives[i].max);
+                if(mesh->proxyDistance > 0.0f && glm::distance(viewPosition, nearest) > mesh->proxyDistance)
+                {
+                    instance.nodeOffset = proxy->nodeOffset;
+                    instance.triangleOffset = proxy->triangleOffset;
+                    geometries[i] = mesh->proxy;
+                }
+            }
+        }
+
+        // Построение BVH (по одному экземпляру в листе, экземпляров немного - в одном потоке)
+        BvhBuilder::Result bvh = BvhBuilder::build(primitives, 1, 1);
+
+        // Экземпляры в порядке листьев
+        std::vector<Instance> ordered(instances.size());
+        instanceMeshes_.resize(instances.size());
+        instanceGeometries_.resize(instances.size());
+        for(size_t i = 0; i < instances.size(); i++){
+            ordered[i] = instances[bvh.order[i]];
+            instanceMeshes_[i] = meshes_[bvh.order[i]];
+            instanceGeometries_[i] = geometries[bvh.order[i]];
+        }
+
+        // Выгрузка узлов и экземпляров
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBufferId);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(bvh.nodes.size() * sizeof(BvhBuilder::Node)), bvh.nodes.data());
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(ordered.size() * sizeof(Instance)), ordered.data(), GL_STREAM_DRAW);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Меши в порядке экземпляров (актуально после build, до clear)
+     * @return Ссылка на массив мешей
+     */
+    const std::vector<const Mesh*> &TlasBuilder::getInstanceMeshes() const
+    {
+        return instanceMeshes_;
+    }
+
+    /**
+     * Геометрия первичных лучей в порядке экземпляров (актуально после build, до clear)
+     * @return Ссылка на массив геометрических буферов
+     */
+    const std::vector<const GeometryBuffer*> &TlasBuilder::getInstanceGeometries() const
+    {
+        return instanceGeometries_;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+ * Построитель TLAS (top level acceleration structure) - BVH над экземплярами мешей сцены
+ * Перестраивается каждый кадр, стоимость зависит только от кол-ва экземпляров
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "BlasPool.h"
+#include "../Scene/Mesh.h"
+
+namespace rtgl
+{
+    class TlasBuilder final
+    {
+    public:
+        /// Экземпляр меша (соответствует структуре Instance в шейдерах, выравнивание std430)
+        struct Instance
+        {
+            // Матрица перевода луча из мирового пространства в пространство объекта
+            glm::mat4 worldToObject;
+            // Материал
+            glm::vec3 albedo;
+            GLfloat metallic;
+            GLfloat roughness;
+            GLfloat primaryCoff;
+            GLfloat reflectToRefract;
+            GLfloat refractionCoff;
+            // Сдвиг узлов и треугольников BLAS первичных лучей в общих буферах
+            GLuint nodeOffset;
+            GLuint triangleOffset;
+            // Сдвиг узлов и треугольников BLAS вторичных и теневых лучей (упрощенная геометрия или основная)
+            GLuint proxyNodeOffset;
+            GLuint proxyTriangleOffset;
+        };
+
+    private:
+        /// OpenGL дескриптор буфера экземпляров
+        GLuint instanceBufferId_;
+        /// Меши добавленные на сцену в текущем кадре
+        std::vector<const Mesh*> meshes_;
+        /// Меши в порядке экземпляров построенного TLAS (индекс меша - индекс экземпляра в шейдерах)
+        std::vector<const Mesh*> instanceMeshes_;
+        /// Геометрия первичных лучей каждого экземпляра (основная или упрощенная, выбранная по расстоянию от камеры)
+        std::vector<const GeometryBuffer*> instanceGeometries_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        TlasBuilder(const TlasBuilder& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        TlasBuilder& operator=(const TlasBuilder& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param instanceBufferBinding Индекс привязки буфера экземпляров
+         */
+        explicit TlasBuilder(GLuint instanceBufferBinding);
+
+        /**
+         * Очистка ресурса
+         */
+        ~TlasBuilder();
+
+        /**
+         * Добавить меш как экземпляр
+         * @param mesh Указатель на меш
+         */
+        void addMesh(const Mesh* mesh);
+
+        /**
+         * Очистить набор экземпляров
+         */
+        void clear();
+
+        /**
+         * Построение TLAS и выгрузка узлов и экземпляров в буферы
+         * @param blasPool Хранилище BLAS (должно быть выгружено)
+         * @param nodeBufferId Буфер узлов BVH сцены
+         * @param viewPosition Положение камеры (для выбора геометрии первичных лучей по расстоянию)
+         */
+        void build(const BlasPool& blasPool, GLuint nodeBufferId, const glm::vec3& viewPosition);
+
+        /**
+         * Меши в порядке экземпляров (актуально после build, до clear)
+         * @return Ссылка на массив мешей
+         */
+        [[nodiscard]] const std::vector<const Mesh*>& getInstanceMeshes() const;
+
+        /**
+         * Геометрия первичных лучей в порядке экземпляров (актуально после build, до clear)
+         * @return Ссылка на массив геометрических буферов
+         */
+        [[nodiscard]] const std::vector<const GeometryBuffer*>& getInstanceGeometries() const;
+    };
+}
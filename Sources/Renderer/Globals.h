@@ -6,26 +6,96 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 
 #include "Resources/FrameBuffer.h"
 #include "Resources/GeometryBuffer.h"
 #include "Resources/ShaderProgram.h"
+#include "Resources/ShaderPermutations.h"
 #include "Scene/Camera.h"
+#include "Acceleration/BlasPool.h"
+#include "Acceleration/TlasBuilder.h"
+#include "Acceleration/PrimitiveBvhBuilder.h"
+#include "Acceleration/PrimitiveDataPool.h"
+#include "Resources/ReflectionProbePool.h"
+#include "Resources/ShadowMapArray.h"
+#include "Scene/ReflectionProbe.h"
+#include "Resources/MeshInstanceBuffer.h"
+#include "Scene/RetainedScene.h"
 
 namespace rtgl
 {
     /** Константны **/
     // Константы значения которых используются для обнуления буферов
     const unsigned INITIAL_ZERO = 0;
-    const unsigned INITIAL_MAX_INT = INT_MAX;
-    const unsigned INITIAL_MIN_INT = INT_MIN;
-    // Максимальное кол-во треугольников, которые могут быть записаны в буфер на этапе подготовки геометрии
-    const unsigned MAX_TRIANGLES_PREPARE = 10000;
-    // Максимальное кол-во источников освещения (определяет размер UBO для структуры источника)
-    const unsigned MAX_LIGHTS = 10;
-    // Максимальное кол-во мешей
-    const unsigned MAX_MESHES = 10;
+    // Размер рабочей группы вычислительного шейдера построения BVH (должен совпадать с шейдером)
+    const unsigned BVH_GROUP_SIZE = 256;
+    // Кол-во бит сортируемых за один проход поразрядной сортировки кодов Мортона
+    const unsigned BVH_RADIX_BITS = 4;
+    // Размер рабочей группы вычислительного шейдера подготовки геометрии (должен совпадать с шейдером)
+    const unsigned GEOMETRY_PREPARE_GROUP_SIZE = 64;
+    // Размер рабочей группы вычислительного шейдера волновой трассировки (должен совпадать с шейдером)
+    const unsigned WAVEFRONT_GROUP_SIZE = 64;
+    // Кол-во рабочих групп трассировки постоянными потоками, если размер устройства узнать не удалось
+    const unsigned PERSISTENT_THREADS_DEFAULT_GROUPS = 256;
+    // Кол-во бит ключа сортировки вторичных лучей (октант направления и код Мортона начала, должно совпадать с шейдером)
+    const unsigned RAY_SORT_KEY_BITS = 15;
+    // Размер луча очереди и результата поиска пересечения (выравнивание std430)
+    const unsigned QUEUED_RAY_SIZE = 32;
+    const unsigned RAY_HIT_SIZE = 24;
+    // Размер положения треугольника (вершина и два ребра), атрибутов треугольника и материала меша (выравнивание std430)
+    const unsigned TRIANGLE_POSITIONS_SIZE = 48;
+    const unsigned TRIANGLE_ATTRIBUTES_SIZE = 96;
+    const unsigned MESH_MATERIAL_SIZE = 32;
+    // Размер источника света (выравнивание std140)
+    const unsigned LIGHT_SOURCE_SIZE = 64;
+    // Ближняя плоскость отсечения при растеризации буфера видимости (дальней нет - как и у первичного луча)
+    const GLfloat VISIBILITY_NEAR_PLANE = 0.01f;
+    // Предельное кол-во зондов отражений кадра (должно совпадать с шейдером) и размер грани их кубических карт
+    const GLuint MAX_REFLECTION_PROBES = 8;
+    const GLuint REFLECTION_PROBE_FACE_SIZE = 128;
+    // Предельное кол-во карт теней кадра (источники сверх него затеняются теневыми лучами) и размер грани их кубических карт
+    const GLuint MAX_SHADOW_MAPS = 8;
+    const GLuint SHADOW_MAP_FACE_SIZE = 256;
+    // Ближняя плоскость отсечения при растеризации карт теней
+    const GLfloat SHADOW_MAP_NEAR_PLANE = 0.01f;
+    // Маска всех типов источников света (бит на значение LightSourceType)
+    const GLuint LIGHT_TYPES_ALL = (1u << LIGHT_POINT) | (1u << LIGHT_SPOT) | (1u << LIGHT_DIRECTIONAL);
+
+    // Этапы построения BVH (значения должны совпадать с шейдером)
+    enum BvhBuildStage : GLuint
+    {
+        BVH_STAGE_MORTON,
+        BVH_STAGE_RADIX_COUNT,
+        BVH_STAGE_RADIX_SCAN,
+        BVH_STAGE_RADIX_SCATTER,
+        BVH_STAGE_HIERARCHY,
+        BVH_STAGE_BOUNDS
+    };
+
+    // Этапы волновой трассировки (значения должны совпадать с шейдером)
+    enum WavefrontStage : GLuint
+    {
+        WF_STAGE_GENERATE,
+        WF_STAGE_INTERSECT,
+        WF_STAGE_SHADE,
+        WF_STAGE_COMPACT,
+        WF_STAGE_PERSISTENT,
+        WF_STAGE_SORT_KEYS,
+        WF_STAGE_SORT_COUNT,
+        WF_STAGE_SORT_SCAN,
+        WF_STAGE_SORT_SCATTER,
+        WF_STAGE_SORT_GATHER
+    };
+
+    // Проходы трассировки фрагментным шейдером (значения должны совпадать с шейдером)
+    enum TracePass : GLuint
+    {
+        TP_FULL,
+        TP_PRIMARY,
+        TP_SECONDARY
+    };
 
     /** Состояние и инициализация **/
 
@@ -55,25 +125,112 @@ namespace rtgl
     // Оснвной кадровый буфер экрана
     FrameBuffer* _screenFrameBuffer = nullptr;
 
+    // Буфер видимости первичных лучей (экземпляр, треугольник, барицентрические координаты и расстояние для каждого пикселя)
+    FrameBuffer* _visibilityFrameBuffer = nullptr;
+
+    // Изображение предыдущего кадра (цвет точек, найденных отражениями в экранном пространстве)
+    FrameBuffer* _reflectionHistoryFrameBuffer = nullptr;
+
+    // Цвет и поверхность первичных пересечений в полном разрешении и вторичных лучей в пониженном
+    // (создаются при смене разрешения вторичных лучей)
+    FrameBuffer* _primaryFrameBuffer = nullptr;
+    FrameBuffer* _secondaryFrameBuffer = nullptr;
+
     // Шейдерные программы для каждого этапа
-    ShaderProgram* _shaderPrograms[3] = {};
+    ShaderProgram* _shaderPrograms[4] = {};
+
+    // Вычислительная программа подготовки геометрии (альтернатива вершинному и геометрическому шейдерам)
+    ShaderProgram* _geometryPrepareComputeProgram = nullptr;
+
+    // Вычислительная программа волновой трассировки (альтернатива трассировке во фрагментном шейдере)
+    ShaderProgram* _rayTracingComputeProgram = nullptr;
+
+    // Специализации программ трассировки (фрагментной и вычислительной) по параметрам сцены
+    // Программы трассировки в _shaderPrograms и _rayTracingComputeProgram - текущие специализации, ими владеют наборы
+    ShaderPermutations* _rayTracingPermutations = nullptr;
+    ShaderPermutations* _rayTracingComputePermutations = nullptr;
+
+    // Программа растеризации буфера видимости первичных лучей (не обязательна)
+    ShaderProgram* _visibilityProgram = nullptr;
+
+    // Программа растеризации карт теней (не обязательна)
+    ShaderProgram* _shadowMapProgram = nullptr;
 
     // Ресурсы геометрии по умолчанию
     GeometryBuffer* _geometryQuad = nullptr;
 
     /** Хендлы буферов **/
 
-    // Буфер хранения (SSBO) для геометрии (для параллельной записи используется атомарный счетчик)
-    GLuint _triangleBuffer = 0;
+    // Буферы хранения (SSBO) для геометрии (для параллельной записи используется атомарный счетчик)
+    // Положения треугольников читаются при обходе BVH, атрибуты и материалы - только для ближайшего пересечения
+    GLuint _trianglePositionBuffer = 0;
+    GLuint _triangleAttributeBuffer = 0;
+    GLuint _meshMaterialBuffer = 0;
     GLuint _triangleCounterPerMeshBuffer = 0;
     GLuint _triangleCounterGlobalBuffer = 0;
     GLuint _meshBoundsMinBuffer = 0;
     GLuint _meshBoundsMaxBuffer = 0;
 
-    // Буферы UBO для передачи информации об источниках света и прочих настрйоках
+    // Буферы хранения (SSBO) для построения и обхода BVH
+    GLuint _bvhNodeBuffer = 0;
+    GLuint _bvhMortonBuffers[2] = {};
+    GLuint _bvhRadixHistogramBuffer = 0;
+    GLuint _bvhParentBuffer = 0;
+
+    // Буферы хранения (SSBO) волновой трассировки - очереди лучей (вход и выход отскока), результаты поиска пересечений,
+    // счетчики очередей и работы вместе с аргументами косвенного вызова (размер очередей - по лучу на пиксель)
+    GLuint _rayQueueBuffers[2] = {};
+    GLuint _rayHitBuffer = 0;
+    GLuint _wavefrontStateBuffer = 0;
+
+    // Буфер хранения (SSBO) сортировки вторичных лучей - пары (ключ, индекс луча), две половины (вход и выход прохода)
+    // Гистограммы разрядов хранятся в буфере состояния волновой трассировки
+    GLuint _raySortBuffer = 0;
+
+    /** Двухуровневая структура ускорения **/
+
+    // Хранилище BLAS геометрических буферов (строятся при создании геометрии)
+    BlasPool* _blasPool = nullptr;
+
+    // Построитель TLAS над мешами сцены (строится каждый кадр)
+    TlasBuilder* _tlasBuilder = nullptr;
+
+    // Построитель BVH аналитических примитивов (строится каждый кадр, используется при любой структуре ускорения)
+    PrimitiveBvhBuilder* _primitiveBvhBuilder = nullptr;
+
+    // Хранилище данных примитивов (карты высот и октодеревья вокселей в общем буфере текстуры)
+    PrimitiveDataPool* _primitiveDataPool = nullptr;
+
+    // Хранилище кубических карт зондов отражений (слот зонда сохраняется между кадрами до его уничтожения)
+    ReflectionProbePool* _reflectionProbePool = nullptr;
+
+    // Кубические карты теней источников света кадра (только при наличии программы карт теней)
+    ShadowMapArray* _shadowMaps = nullptr;
+
+    // Буфер экземпляров мешей для пакетной подготовки геометрии
+    MeshInstanceBuffer* _meshInstanceBuffer = nullptr;
+
+    /** Сохраняемая сцена **/
+
+    // Меши, остающиеся на сцене между кадрами (занимают постоянные участки в начале буфера треугольников)
+    RetainedScene* _retainedScene = nullptr;
+
+    // Буфер хранения (SSBO) источников света и UBO для передачи прочих настроек
     GLuint _lightSourcesBuffer = 0;
     GLuint _commonSettingsBuffer = 0;
 
+    /** Вместимость буферов **/
+
+    // Текущая вместимость буферов треугольников, мешей и источников света (увеличивается при превышении)
+    GLuint _triangleCapacity = 0;
+    GLuint _meshCapacity = 0;
+    GLuint _lightCapacity = 0;
+
+    // Предельная вместимость (определяется максимальным размером буфера хранения)
+    GLuint _triangleCapacityLimit = 0;
+    GLuint _meshCapacityLimit = 0;
+    GLuint _lightCapacityLimit = 0;
+
     /** Рендеринг **/
 
     // Идентификатор последнего этапа (прохода)
@@ -85,4 +242,120 @@ namespace rtgl
     // Кол-во мешей добавленных на сцену в данный момент
     GLuint _meshesCount = 0;
 
+    // Используемый тип структуры ускорения
+    AccelerationStructureType _accelerationStructure = AS_TWO_LEVEL;
+
+    // Используемый способ подготовки геометрии
+    GeometryPrepareMode _geometryPrepareMode = GP_GEOMETRY_SHADER;
+
+    // Используемый способ трассировки лучей
+    RayTracingMode _rayTracingMode = RT_FRAGMENT_SHADER;
+
+    // Глубина трассировки (кол-во последовательных кастов луча, включая первичный)
+    GLuint _rayDepth = 5;
+
+    // Параметры трассировки постоянными потоками - пикселей на поток в порции и кол-во групп (0 - по размеру устройства)
+    GLuint _persistentBatchSize = 4;
+    GLuint _persistentGroupCount = 0;
+
+    // Сортировать ли вторичные лучи перед каждым отскоком волновой трассировки
+    bool _secondaryRaySorting = false;
+
+    // Обходить ли структуру ускорения всей подгруппой (действует только при поддержке GL_KHR_shader_subgroup драйвером)
+    bool _subgroupTraversal = true;
+
+    // Ядро проверки пересечений при обходе структуры ускорения
+    IntersectionKernel _intersectionKernel = IK_PRECOMPUTED;
+
+    // Проверять ли видимость источников света теневыми лучами (поиск любого пересечения до сферы источника)
+    bool _shadows = true;
+
+    // Способ получения теней (карты теней требуют двухуровневой структуры ускорения, иначе тени трассируются)
+    ShadowMode _shadowMode = SM_TRACED;
+
+    // Начинать ли первичные лучи с растеризованного буфера видимости (только при AS_TWO_LEVEL, иначе первичные лучи трассируются)
+    bool _primaryVisibility = false;
+
+    // Способ получения отражений первичных лучей (экранное пространство требует буфера видимости)
+    ReflectionMode _reflectionMode = RM_TRACED;
+
+    // Параметры отражений в экранном пространстве - предельное кол-во шагов по экрану и толщина поверхностей буфера видимости
+    GLuint _reflectionMaxSteps = 64;
+    GLfloat _reflectionThickness = 0.1f;
+
+    // Параметры зондов отражений - шероховатость, начиная с которой отражение берется из зонда, отскок, начиная с которого
+    // из зонда берется отражение любой поверхности, и кол-во граней кубических карт, обновляемых за кадр
+    GLfloat _reflectionProbeRoughness = 0.5f;
+    GLuint _reflectionProbeBounceDepth = 3;
+    GLuint _reflectionProbeFacesPerFrame = 1;
+
+    // Разрешение вторичных лучей при трассировке фрагментным шейдером
+    SecondaryRayResolution _secondaryRayResolution = SRR_FULL;
+
+    // Зонд кадра, грани которого обновляются (зонды обновляются по очереди, по одной грани)
+    GLuint _reflectionProbeCursor = 0;
+
+    // Содержит ли изображение предыдущего кадра результат трассировки и матрица вида-проекции, с которой он получен
+    bool _reflectionHistoryValid = false;
+    glm::mat4 _reflectionHistoryViewProjection = glm::mat4(1.0f);
+
+    // Вес луча, ниже которого путь продолжается лишь по результату русской рулетки (0 - пути не завершаются)
+    GLfloat _rayWeightThreshold = 0.05f;
+
+    // Кол-во рабочих групп трассировки, одновременно размещаемых на устройстве
+    GLuint _deviceGroupCount = PERSISTENT_THREADS_DEFAULT_GROUPS;
+
+    // Предельное кол-во рабочих групп вычислительного шейдера по осям X и Y (GL_MAX_COMPUTE_WORK_GROUP_COUNT)
+    GLuint _maxComputeGroupCount[2] = {65535, 65535};
+
+    /** Статистика **/
+
+    // Запрос времени подготовки геометрии (GL_TIME_ELAPSED)
+    GLuint _geometryPrepareTimeQuery = 0;
+
+    // Начат ли запрос в текущем кадре, ожидает ли завершенный запрос чтения результата
+    bool _geometryPrepareTimeQueryActive = false;
+    bool _geometryPrepareTimeQueryPending = false;
+
+    // Запрос времени трассировки лучей (GL_TIME_ELAPSED) и ожидает ли он чтения результата
+    GLuint _rayTracingTimeQuery = 0;
+    bool _rayTracingTimeQueryPending = false;
+
+    // Запрос времени растеризации буфера видимости (GL_TIME_ELAPSED) и ожидает ли он чтения результата
+    GLuint _primaryVisibilityTimeQuery = 0;
+    bool _primaryVisibilityTimeQueryPending = false;
+
+    // Ожидают ли счетчики лучей (завершенных русской рулеткой, отраженных и найденных в экранном пространстве) чтения результата
+    bool _terminatedRaysPending = false;
+
+    // Метки времени вторичных лучей волновой трассировки (по три на отскок - начало сортировки, начало трассировки, конец)
+    std::vector<GLuint> _secondaryRayTimestampQueries;
+
+    // Кол-во отскоков вторичных лучей последнего кадра, ожидают ли метки времени и счетчик лучей чтения результата
+    GLuint _secondaryRayBounces = 0;
+    bool _secondaryRayStatisticsPending = false;
+
+    // Статистика последнего кадра
+    FrameStatistics _frameStatistics = {};
+
+    // Кол-во треугольников мешей текущего кадра (в режиме AS_SCENE_LBVH) и увеличений буферов за текущий кадр
+    GLuint _frameTriangleCount = 0;
+    GLuint _frameBufferGrowCount = 0;
+
+    // Типы источников света (маска) и наличие преломляющих материалов среди мешей текущего кадра (для выбора специализации)
+    GLuint _frameLightTypes = 0;
+    bool _frameRefraction = false;
+
+    // Начинаются ли первичные лучи с буфера видимости и ищутся ли отражения в экранном пространстве в текущем кадре
+    bool _framePrimaryVisibility = false;
+    bool _frameScreenSpaceReflections = false;
+
+    // Зонды отражений текущего кадра
+    ReflectionProbe* _frameReflectionProbes[MAX_REFLECTION_PROBES] = {};
+    GLuint _frameReflectionProbeCount = 0;
+
+    // Положения первых источников света кадра (для карт теней) и кол-во карт теней, отрисованных в текущем кадре
+    glm::vec3 _frameLightPositions[MAX_SHADOW_MAPS] = {};
+    GLuint _frameShadowMapCount = 0;
+
 }
\ No newline at end of file
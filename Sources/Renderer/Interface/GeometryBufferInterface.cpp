@@ -5,7 +5,10 @@
 
 #include "GeometryBufferInterface.h"
 #include "../Resources/GeometryBuffer.h"
+#include "../Acceleration/BlasPool.h"
+#include "../Acceleration/GeometrySimplifier.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <GL/gl.h>
 
@@ -16,6 +19,8 @@ namespace rtgl
     extern std::string _strLastErrorMsg;
     /// Инициализирована ли библиотека (объявлено в Globals.h->Renderer.cpp)
     extern bool _bInitialized;
+    /// Хранилище BLAS геометрических буферов (объявлено в Globals.h->Renderer.cpp)
+    extern BlasPool* _blasPool;
 
     /**
      * Создать буфер геометрии
@@ -35,9 +40,71 @@ namespace rtgl
         {
             if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
-            auto const geometry = new GeometryBuffer(
-                    std::vector<Vertex<GLfloat>>(vertices, vertices + verticesQnt),
-                    std::vector<GLuint>(indices, indices + indicesQnt));
+            std::vector<Vertex<GLfloat>> vertexData(vertices, vertices + verticesQnt);
+            std::vector<GLuint> indexData(indices, indices + indicesQnt);
+
+            auto const geometry = new GeometryBuffer(vertexData, indexData);
+
+            // BLAS строится один раз (в пространстве объекта) и используется всеми мешами с этой геометрией
+            try
+            {
+                _blasPool->add(geometry, vertexData, indexData);
+            }
+            catch(std::exception&)
+            {
+                delete geometry;
+                throw;
+            }
+
+            return reinterpret_cast<HGeometryBuffer>(geometry);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Создать упрощенный буфер геометрии (стягиванием ребер по квадрикам ошибки)
+     * @param vertices Массив вершин исходной геометрии
+     * @param verticesQnt Кол-во вершин
+     * @param indices Массив индексов исходной геометрии
+     * @param indicesQnt Кол-во индексов
+     * @param ratio Доля сохраняемых треугольников (0, 1]
+     * @return Хендл геометрического буфера
+     */
+    HGeometryBuffer __cdecl CreateSimplifiedGeometryBuffer(
+            Vertex<float> vertices[],
+            const size_t verticesQnt,
+            unsigned indices[],
+            const size_t indicesQnt,
+            float ratio)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(ratio <= 0.0f || ratio > 1.0f) throw std::runtime_error("Simplification ratio must be in range (0, 1]");
+
+            std::vector<Vertex<GLfloat>> vertexData(vertices, vertices + verticesQnt);
+            std::vector<GLuint> indexData(indices, indices + indicesQnt);
+
+            // Упрощенная геометрия сохраняет хотя бы один треугольник
+            const size_t targetTriangles = std::max(static_cast<size_t>(static_cast<float>(indicesQnt / 3) * ratio), static_cast<size_t>(1));
+            GeometrySimplifier::Result simplified = GeometrySimplifier::simplify(vertexData, indexData, targetTriangles);
+
+            auto const geometry = new GeometryBuffer(simplified.vertices, simplified.indices);
+
+            try
+            {
+                _blasPool->add(geometry, simplified.vertices, simplified.indices);
+            }
+            catch(std::exception&)
+            {
+                delete geometry;
+                throw;
+            }
 
             return reinterpret_cast<HGeometryBuffer>(geometry);
         }
@@ -61,6 +128,7 @@ namespace rtgl
             if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
             const auto pResource = reinterpret_cast<GeometryBuffer*>(*pBufferHandle);
+            _blasPool->remove(pResource);
             delete pResource;
             *pBufferHandle = nullptr;
         }
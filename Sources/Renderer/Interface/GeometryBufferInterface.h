@@ -25,6 +25,23 @@ namespace rtgl
                 unsigned* indices,
                 const size_t indicesQnt);
 
+        /**
+         * Создать упрощенный буфер геометрии (стягиванием ребер по квадрикам ошибки)
+         * @details Результат - обычный геометрический буфер, предназначенный для использования как упрощенная геометрия меша
+         * @param vertices Массив вершин исходной геометрии
+         * @param verticesQnt Кол-во вершин
+         * @param indices Массив индексов исходной геометрии
+         * @param indicesQnt Кол-во индексов
+         * @param ratio Доля сохраняемых треугольников (0, 1]
+         * @return Хендл геометрического буфера
+         */
+        RENDERER_LIB_API HGeometryBuffer __cdecl CreateSimplifiedGeometryBuffer(
+                Vertex<float>* vertices,
+                const size_t verticesQnt,
+                unsigned* indices,
+                const size_t indicesQnt,
+                float ratio);
+
         /**
          * Уничтожить геометрический буфер
          * @param pBufferHandle Хендл буфера
@@ -0,0 +1,85 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса карты высот
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "HeightfieldInterface.h"
+#include "../Resources/Heightfield.h"
+#include "../Acceleration/PrimitiveDataPool.h"
+
+#include <string>
+#include <stdexcept>
+#include <utility>
+
+namespace rtgl
+{
+    /// Сообщение о последней ошибке (объявлено в Globals.h->Renderer.cpp)
+    extern std::string _strLastErrorMsg;
+    /// Инициализирована ли библиотека (объявлено в Globals.h->Renderer.cpp)
+    extern bool _bInitialized;
+    /// Хранилище данных примитивов (объявлено в Globals.h->Renderer.cpp)
+    extern PrimitiveDataPool* _primitiveDataPool;
+
+    /**
+     * Создать карту высот
+     * @param heights Массив отсчетов высоты (width * depth значений, построчно по оси X)
+     * @param width Кол-во отсчетов по оси X (не менее 2)
+     * @param depth Кол-во отсчетов по оси Z (не менее 2)
+     * @return Хендл карты высот
+     */
+    HHeightfield __cdecl CreateHeightfield(const float *heights, const unsigned &width, const unsigned &depth)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(heights == nullptr) throw std::runtime_error("No heights provided");
+
+            std::vector<GLfloat> heightData(heights, heights + static_cast<size_t>(width) * depth);
+            auto const heightfield = new Heightfield(std::move(heightData), width, depth);
+
+            // Отсчеты и пирамида выгружаются в общий буфер при следующей трассировке
+            try
+            {
+                _primitiveDataPool->add(heightfield);
+            }
+            catch(std::exception&)
+            {
+                delete heightfield;
+                throw;
+            }
+
+            return reinterpret_cast<HHeightfield>(heightfield);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Уничтожить карту высот
+     * @param pHeightfieldHandle Указатель на хендл карты высот
+     * @return Состояние операции
+     */
+    bool __cdecl DestroyHeightfield(HHeightfield *pHeightfieldHandle)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            const auto pResource = reinterpret_cast<Heightfield*>(*pHeightfieldHandle);
+            _primitiveDataPool->remove(pResource);
+            delete pResource;
+            *pHeightfieldHandle = nullptr;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,33 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса карты высот
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+namespace rtgl
+{
+    extern "C"
+    {
+        /**
+         * Создать карту высот
+         * @param heights Массив отсчетов высоты (width * depth значений, построчно по оси X)
+         * @param width Кол-во отсчетов по оси X (не менее 2)
+         * @param depth Кол-во отсчетов по оси Z (не менее 2)
+         * @return Хендл карты высот
+         */
+        RENDERER_LIB_API HHeightfield __cdecl CreateHeightfield(
+                const float* heights,
+                const unsigned& width,
+                const unsigned& depth);
+
+        /**
+         * Уничтожить карту высот
+         * @param pHeightfieldHandle Указатель на хендл карты высот
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl DestroyHeightfield(HHeightfield* pHeightfieldHandle);
+    }
+}
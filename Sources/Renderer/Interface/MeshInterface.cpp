@@ -5,6 +5,8 @@
 
 #include "MeshInterface.h"
 #include "../Scene/Mesh.h"
+#include "../Scene/RetainedScene.h"
+#include "../Renderer.h"
 
 #include <stdexcept>
 
@@ -14,6 +16,8 @@ namespace rtgl
     extern std::string _strLastErrorMsg;
     /// Инициализирована ли библиотека (объявлено в Globals.h->Renderer.cpp)
     extern bool _bInitialized;
+    /// Сохраняемая сцена (объявлено в Globals.h->Renderer.cpp)
+    extern RetainedScene* _retainedScene;
 
     /**
      * Создать меш
@@ -63,6 +67,11 @@ namespace rtgl
             if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
             const auto pResource = reinterpret_cast<Mesh*>(*pMeshHandle);
+
+            // Уничтожаемый меш не должен оставаться на сохраняемой сцене
+            if(_retainedScene->contains(pResource) && !RemoveMeshFromScene(*pMeshHandle))
+                throw std::runtime_error(_strLastErrorMsg);
+
             delete pResource;
             *pMeshHandle = nullptr;
         }
@@ -105,6 +114,34 @@ namespace rtgl
             pMesh->material.primaryToSecondary = primaryCoff;
             pMesh->material.reflectionToRefraction = reflectionToRefraction;
             pMesh->material.refractionCoff = refractionCoff;
+            pMesh->markChanged();
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Установка упрощенной геометрии меша (действует только при двухуровневой структуре ускорения)
+     * @param mesh Дескриптор меша
+     * @param proxy Упрощенная геометрия (nullptr - все лучи обходят основную геометрию)
+     * @param distance Расстояние от камеры до границ меша, начиная с которого упрощенную геометрию обходят и первичные лучи
+     * @return Состояние операции
+     */
+    bool __cdecl SetMeshProxyGeometry(HMesh mesh, HGeometryBuffer proxy, float distance)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(distance < 0.0f) throw std::runtime_error("Proxy geometry distance can't be negative");
+
+            const auto pMesh = reinterpret_cast<Mesh*>(mesh);
+            pMesh->proxy = reinterpret_cast<GeometryBuffer*>(proxy);
+            pMesh->proxyDistance = distance;
         }
         catch(std::exception& ex)
         {
@@ -51,5 +51,16 @@ namespace rtgl
                 const float& primaryCoff = 1.0f,
                 const float& reflectionToRefraction = 1.0f,
                 const float& refractionCoff = 0.6f);
+
+        /**
+         * Установка упрощенной геометрии меша (действует только при двухуровневой структуре ускорения)
+         * Упрощенную геометрию обходят вторичные и теневые лучи, а первичные - если меш дальше заданного расстояния от камеры
+         * @param mesh Дескриптор меша
+         * @param proxy Упрощенная геометрия (nullptr - все лучи обходят основную геометрию)
+         * @param distance Расстояние от камеры до границ меша, начиная с которого упрощенную геометрию обходят
+         * и первичные лучи (0 - первичные лучи всегда обходят основную геометрию)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetMeshProxyGeometry(HMesh mesh, HGeometryBuffer proxy, float distance = 0.0f);
     }
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса аналитического примитива
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "PrimitiveInterface.h"
+#include "../Scene/Primitive.h"
+#include "../Resources/Heightfield.h"
+#include "../Resources/VoxelOctree.h"
+
+#include <string>
+#include <stdexcept>
+
+namespace rtgl
+{
+    /// Сообщение о последней ошибке (объявлено в Globals.h->Renderer.cpp)
+    extern std::string _strLastErrorMsg;
+    /// Инициализирована ли библиотека (объявлено в Globals.h->Renderer.cpp)
+    extern bool _bInitialized;
+
+    /**
+     * Создать аналитический примитив
+     * @param type Тип примитива (каноническая форма вписана в куб [-1, 1], размеры задаются масштабом)
+     * @param position Положение
+     * @param orientation Ориентация
+     * @param scale Масштабирование (для сферы радиусом 0.5 - {0.5, 0.5, 0.5})
+     * @return Дескриптор примитива
+     */
+    HPrimitive __cdecl CreatePrimitive(const PrimitiveType &type,
+            const Vec3<float> &position,
+            const Vec3<float> &orientation,
+            const Vec3<float> &scale)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(type == PrimitiveType::PRIMITIVE_HEIGHTFIELD) throw std::runtime_error("Heightfield primitive requires a heightfield. Please use rtgl::CreateHeightfieldPrimitive.");
+            if(type == PrimitiveType::PRIMITIVE_VOXELS) throw std::runtime_error("Voxel primitive requires a voxel octree. Please use rtgl::CreateVoxelPrimitive.");
+            if(type > PrimitiveType::PRIMITIVE_VOXELS) throw std::runtime_error("Unknown primitive type");
+
+            auto primitive = new Primitive();
+            primitive->type = type;
+            primitive->setPosition({ position.x, position.y, position.z }, false);
+            primitive->setOrientation({ orientation.x, orientation.y, orientation.z }, false);
+            primitive->setScale({ scale.x, scale.y, scale.z }, true);
+
+            return reinterpret_cast<HPrimitive>(primitive);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Создать примитив карты высот (карта занимает квадрат [-1, 1] плоскости XZ, высота по Y - значения отсчетов)
+     * @param heightfield Карта высот (может использоваться несколькими примитивами)
+     * @param position Положение
+     * @param orientation Ориентация
+     * @param scale Масштабирование (половина размера по X и Z, множитель высоты по Y)
+     * @return Дескриптор примитива
+     */
+    HPrimitive __cdecl CreateHeightfieldPrimitive(HHeightfield heightfield,
+            const Vec3<float> &position,
+            const Vec3<float> &orientation,
+            const Vec3<float> &scale)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(heightfield == nullptr) throw std::runtime_error("No heightfield provided");
+
+            auto primitive = new Primitive();
+            primitive->type = PrimitiveType::PRIMITIVE_HEIGHTFIELD;
+            primitive->heightfield = reinterpret_cast<const Heightfield*>(heightfield);
+            primitive->setPosition({ position.x, position.y, position.z }, false);
+            primitive->setOrientation({ orientation.x, orientation.y, orientation.z }, false);
+            primitive->setScale({ scale.x, scale.y, scale.z }, true);
+
+            return reinterpret_cast<HPrimitive>(primitive);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Создать примитив октодерева вокселей (сетка занимает куб [-1, 1])
+     * @param voxels Октодерево вокселей (может использоваться несколькими примитивами)
+     * @param position Положение
+     * @param orientation Ориентация
+     * @param scale Масштабирование (половина размера сетки по каждой оси)
+     * @return Дескриптор примитива
+     */
+    HPrimitive __cdecl CreateVoxelPrimitive(HVoxelOctree voxels,
+            const Vec3<float> &position,
+            const Vec3<float> &orientation,
+            const Vec3<float> &scale)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(voxels == nullptr) throw std::runtime_error("No voxel octree provided");
+
+            auto primitive = new Primitive();
+            primitive->type = PrimitiveType::PRIMITIVE_VOXELS;
+            primitive->voxels = reinterpret_cast<const VoxelOctree*>(voxels);
+            primitive->setPosition({ position.x, position.y, position.z }, false);
+            primitive->setOrientation({ orientation.x, orientation.y, orientation.z }, false);
+            primitive->setScale({ scale.x, scale.y, scale.z }, true);
+
+            return reinterpret_cast<HPrimitive>(primitive);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Уничтожение примитива
+     * @param pPrimitiveHandle Указатель на дескриптор примитива
+     * @return Состояние операции
+     */
+    bool __cdecl DestroyPrimitive(HPrimitive *pPrimitiveHandle)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            const auto pResource = reinterpret_cast<Primitive*>(*pPrimitiveHandle);
+            delete pResource;
+            *pPrimitiveHandle = nullptr;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Уствнока параметров материала примитива (PBR, как у меша)
+     * @param primitive Дескриптор примитива
+     * @param albedo Альбедо-цвет (аналог diffuse)
+     * @param metallic Металличность
+     * @param roughness Шероховатость
+     * @param primaryCoff Соотношение собственного цвета к отражению/преломлению
+     * @param reflectionToRefraction Соотношение отраженного к преломленному компоненту
+     * @param refractionCoff Коэфициент преломления
+     * @return Состояние операции
+     */
+    bool __cdecl SetPrimitiveMaterialSettings(HPrimitive primitive,
+            const Vec3<float> &albedo,
+            const float &metallic,
+            const float &roughness,
+            const float &primaryCoff,
+            const float &reflectionToRefraction,
+            const float &refractionCoff)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            const auto pPrimitive = reinterpret_cast<Primitive*>(primitive);
+            pPrimitive->material.albedo = {albedo.r,albedo.g,albedo.b};
+            pPrimitive->material.metallic = metallic;
+            pPrimitive->material.roughness = roughness;
+            pPrimitive->material.primaryToSecondary = primaryCoff;
+            pPrimitive->material.reflectionToRefraction = reflectionToRefraction;
+            pPrimitive->material.refractionCoff = refractionCoff;
+            pPrimitive->markChanged();
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+}
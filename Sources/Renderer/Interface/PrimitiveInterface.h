@@ -0,0 +1,79 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса аналитического примитива
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+namespace rtgl
+{
+    extern "C"
+    {
+        /**
+         * Создать аналитический примитив
+         * @param type Тип примитива (каноническая форма вписана в куб [-1, 1], размеры задаются масштабом)
+         * @param position Положение
+         * @param orientation Ориентация
+         * @param scale Масштабирование (для сферы радиусом 0.5 - {0.5, 0.5, 0.5})
+         * @return Дескриптор примитива
+         */
+        RENDERER_LIB_API HPrimitive __cdecl CreatePrimitive(const PrimitiveType& type,
+                const Vec3<float>& position,
+                const Vec3<float>& orientation = {0.0f,0.0f,0.0f},
+                const Vec3<float>& scale = {1.0f,1.0f,1.0f});
+
+        /**
+         * Создать примитив карты высот (карта занимает квадрат [-1, 1] плоскости XZ, высота по Y - значения отсчетов)
+         * @param heightfield Карта высот (может использоваться несколькими примитивами)
+         * @param position Положение
+         * @param orientation Ориентация
+         * @param scale Масштабирование (половина размера по X и Z, множитель высоты по Y)
+         * @return Дескриптор примитива
+         */
+        RENDERER_LIB_API HPrimitive __cdecl CreateHeightfieldPrimitive(HHeightfield heightfield,
+                const Vec3<float>& position,
+                const Vec3<float>& orientation = {0.0f,0.0f,0.0f},
+                const Vec3<float>& scale = {1.0f,1.0f,1.0f});
+
+        /**
+         * Создать примитив октодерева вокселей (сетка занимает куб [-1, 1])
+         * @param voxels Октодерево вокселей (может использоваться несколькими примитивами)
+         * @param position Положение
+         * @param orientation Ориентация
+         * @param scale Масштабирование (половина размера сетки по каждой оси)
+         * @return Дескриптор примитива
+         */
+        RENDERER_LIB_API HPrimitive __cdecl CreateVoxelPrimitive(HVoxelOctree voxels,
+                const Vec3<float>& position,
+                const Vec3<float>& orientation = {0.0f,0.0f,0.0f},
+                const Vec3<float>& scale = {1.0f,1.0f,1.0f});
+
+        /**
+         * Уничтожение примитива
+         * @param pPrimitiveHandle Указатель на дескриптор примитива
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl DestroyPrimitive(HPrimitive* pPrimitiveHandle);
+
+        /**
+         * Уствнока параметров материала примитива (PBR, как у меша)
+         * @param primitive Дескриптор примитива
+         * @param albedo Альбедо-цвет (аналог diffuse)
+         * @param metallic Металличность
+         * @param roughness Шероховатость
+         * @param primaryCoff Соотношение собственного цвета к отражению/преломлению
+         * @param reflectionToRefraction Соотношение отраженного к преломленному компоненту
+         * @param refractionCoff Коэфициент преломления
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetPrimitiveMaterialSettings(HPrimitive primitive,
+                const Vec3<float>& albedo,
+                const float& metallic,
+                const float& roughness,
+                const float& primaryCoff = 1.0f,
+                const float& reflectionToRefraction = 1.0f,
+                const float& refractionCoff = 0.6f);
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса зонда отражений
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "ReflectionProbeInterface.h"
+#include "../Scene/ReflectionProbe.h"
+#include "../Resources/ReflectionProbePool.h"
+
+#include <string>
+#include <stdexcept>
+
+namespace rtgl
+{
+    /// Сообщение о последней ошибке (объявлено в Globals.h->Renderer.cpp)
+    extern std::string _strLastErrorMsg;
+    /// Инициализирована ли библиотека (объявлено в Globals.h->Renderer.cpp)
+    extern bool _bInitialized;
+    /// Хранилище кубических карт зондов (объявлено в Globals.h->Renderer.cpp)
+    extern ReflectionProbePool* _reflectionProbePool;
+
+    /**
+     * Создание зонда отражений
+     * @param position Положение зонда (точка, из которой отрисовывается кубическая карта)
+     * @param radius Радиус влияния (точки дальше от зонда его карту не используют)
+     * @return Дескриптор зонда
+     */
+    HReflectionProbe __cdecl CreateReflectionProbe(const Vec3<float> &position, const float &radius)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(radius <= 0.0f) throw std::runtime_error("Reflection probe radius must be greater than 0");
+
+            auto reflectionProbe = new ReflectionProbe();
+            reflectionProbe->setPosition({ position.x, position.y, position.z }, true);
+            reflectionProbe->radius = radius;
+
+            return reinterpret_cast<HReflectionProbe>(reflectionProbe);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Уничтожение зонда отражений (его кубическая карта освобождается)
+     * @param pReflectionProbeHandle Указатель на дескриптор зонда
+     * @return Состояние операции
+     */
+    bool __cdecl DestroyReflectionProbe(HReflectionProbe *pReflectionProbeHandle)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            const auto pResource = reinterpret_cast<ReflectionProbe*>(*pReflectionProbeHandle);
+            _reflectionProbePool->release(pResource);
+            delete pResource;
+            *pReflectionProbeHandle = nullptr;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Установка радиуса влияния зонда отражений
+     * @param reflectionProbe Дескриптор зонда
+     * @param radius Радиус влияния
+     * @return Состояние операции
+     */
+    bool __cdecl SetReflectionProbeRadius(HReflectionProbe reflectionProbe, const float &radius)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(radius <= 0.0f) throw std::runtime_error("Reflection probe radius must be greater than 0");
+
+            reinterpret_cast<ReflectionProbe*>(reflectionProbe)->radius = radius;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,37 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса зонда отражений
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+namespace rtgl
+{
+    extern "C"
+    {
+        /**
+         * Создание зонда отражений
+         * @param position Положение зонда (точка, из которой отрисовывается кубическая карта)
+         * @param radius Радиус влияния (точки дальше от зонда его карту не используют)
+         * @return Дескриптор зонда
+         */
+        RENDERER_LIB_API HReflectionProbe __cdecl CreateReflectionProbe(const Vec3<float>& position, const float& radius = 10.0f);
+
+        /**
+         * Уничтожение зонда отражений (его кубическая карта освобождается)
+         * @param pReflectionProbeHandle Указатель на дескриптор зонда
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl DestroyReflectionProbe(HReflectionProbe* pReflectionProbeHandle);
+
+        /**
+         * Установка радиуса влияния зонда отражений
+         * @param reflectionProbe Дескриптор зонда
+         * @param radius Радиус влияния
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetReflectionProbeRadius(HReflectionProbe reflectionProbe, const float& radius);
+    }
+}
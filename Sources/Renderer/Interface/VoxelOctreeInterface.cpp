@@ -0,0 +1,87 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса октодерева вокселей
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "VoxelOctreeInterface.h"
+#include "../Resources/VoxelOctree.h"
+#include "../Acceleration/PrimitiveDataPool.h"
+
+#include <string>
+#include <stdexcept>
+
+namespace rtgl
+{
+    /// Сообщение о последней ошибке (объявлено в Globals.h->Renderer.cpp)
+    extern std::string _strLastErrorMsg;
+    /// Инициализирована ли библиотека (объявлено в Globals.h->Renderer.cpp)
+    extern bool _bInitialized;
+    /// Хранилище данных примитивов (объявлено в Globals.h->Renderer.cpp)
+    extern PrimitiveDataPool* _primitiveDataPool;
+
+    /**
+     * Создать разреженное октодерево вокселей
+     * @param voxels Массив координат заполненных вокселей (voxelCount троек x, y, z в диапазоне [0, 2^levels))
+     * @param voxelCount Кол-во вокселей
+     * @param levels Кол-во уровней октодерева (от 1 до 10, сторона сетки - 2^levels вокселей)
+     * @return Хендл октодерева
+     */
+    HVoxelOctree __cdecl CreateVoxelOctree(const unsigned *voxels, const unsigned &voxelCount, const unsigned &levels)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(voxels == nullptr && voxelCount > 0) throw std::runtime_error("No voxels provided");
+
+            std::vector<glm::uvec3> voxelData(voxelCount);
+            for(size_t i = 0; i < voxelCount; i++){
+                voxelData[i] = {voxels[i * 3], voxels[i * 3 + 1], voxels[i * 3 + 2]};
+            }
+            auto const octree = new VoxelOctree(voxelData, levels);
+
+            // Узлы выгружаются в общий буфер при следующей трассировке
+            try
+            {
+                _primitiveDataPool->add(octree);
+            }
+            catch(std::exception&)
+            {
+                delete octree;
+                throw;
+            }
+
+            return reinterpret_cast<HVoxelOctree>(octree);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Уничтожить октодерево вокселей
+     * @param pVoxelOctreeHandle Указатель на хендл октодерева
+     * @return Состояние операции
+     */
+    bool __cdecl DestroyVoxelOctree(HVoxelOctree *pVoxelOctreeHandle)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            const auto pResource = reinterpret_cast<VoxelOctree*>(*pVoxelOctreeHandle);
+            _primitiveDataPool->remove(pResource);
+            delete pResource;
+            *pVoxelOctreeHandle = nullptr;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+}
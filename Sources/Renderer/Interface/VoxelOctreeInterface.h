@@ -0,0 +1,33 @@
+/**
+ * С-интерфейс для взаимодействия с объектами класса октодерева вокселей
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+namespace rtgl
+{
+    extern "C"
+    {
+        /**
+         * Создать разреженное октодерево вокселей
+         * @param voxels Массив координат заполненных вокселей (voxelCount троек x, y, z в диапазоне [0, 2^levels))
+         * @param voxelCount Кол-во вокселей
+         * @param levels Кол-во уровней октодерева (от 1 до 10, сторона сетки - 2^levels вокселей)
+         * @return Хендл октодерева
+         */
+        RENDERER_LIB_API HVoxelOctree __cdecl CreateVoxelOctree(
+                const unsigned* voxels,
+                const unsigned& voxelCount,
+                const unsigned& levels);
+
+        /**
+         * Уничтожить октодерево вокселей
+         * @param pVoxelOctreeHandle Указатель на хендл октодерева
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl DestroyVoxelOctree(HVoxelOctree* pVoxelOctreeHandle);
+    }
+}
@@ -8,10 +8,17 @@
 
 #include "Scene/Mesh.h"
 #include "Scene/LightSource.h"
+#include "Scene/Primitive.h"
+#include "Scene/ReflectionProbe.h"
 
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.inl>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <limits>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace rtgl
 {
@@ -31,9 +38,10 @@ namespace rtgl
      * @param screenWidth Ширина области отрисовки
      * @param screenHeight Высота области отрисовки
      * @param shaderSourcesBundle Исходные коды шейдеров
+     * @param sceneLimits Начальная вместимость буферов сцены
      * @return Состояние инициализации
      */
-    bool __cdecl Init(unsigned screenWidth, unsigned screenHeight, const ShaderSourcesBundle &shaderSourcesBundle)
+    bool __cdecl Init(unsigned screenWidth, unsigned screenHeight, const ShaderSourcesBundle &shaderSourcesBundle, const SceneLimits& sceneLimits)
     {
         // Убеждаемся что типы совместимы
         assert(sizeof(GLubyte) == sizeof(unsigned char));
@@ -57,6 +65,13 @@ namespace rtgl
                     message.append(reinterpret_cast<const char*>(glewGetErrorString(initStatus)));
                     throw std::runtime_error(message);
                 }
+
+                // Предельное кол-во рабочих групп вычислительного шейдера (гарантируется не менее 65535 по каждой оси)
+                for(GLuint axis = 0; axis < 2; axis++){
+                    GLint count = 0;
+                    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, axis, &count);
+                    if(count > 0) _maxComputeGroupCount[axis] = static_cast<GLuint>(count);
+                }
             }
 
             /// Компиляция и установка шейдеров
@@ -68,19 +83,69 @@ namespace rtgl
                         {GL_FRAGMENT_SHADER,shaderSourcesBundle.geometryPrepareFs}
                 });
 
+                // Вычислительная программа для стадии подготовки геометрии (не обязательна)
+                if(shaderSourcesBundle.geometryPrepareCs != nullptr){
+                    _geometryPrepareComputeProgram = new ShaderProgram({
+                            {GL_COMPUTE_SHADER,shaderSourcesBundle.geometryPrepareCs}
+                    });
+                }
+
+                // Программа для стадии построения BVH
+                _shaderPrograms[RS_BVH_BUILD] = new ShaderProgram({
+                        {GL_COMPUTE_SHADER,shaderSourcesBundle.bvhBuildCs}
+                });
+
+                // Специализация программ трассировки со всеми возможностями (собирается сразу, чтобы ошибки выявлялись при инициализации)
+                // Специализации под конкретную сцену собираются при рендеринге по мере появления новых параметров
+                ShaderPermutations::Key key;
+                key.rayDepth = _rayDepth;
+                key.lightTypes = LIGHT_TYPES_ALL;
+                key.refraction = true;
+                key.shadows = _shadows;
+
                 // Программа для стадии трассировки
-                _shaderPrograms[RS_RAY_TRACING] = new ShaderProgram({
+                _rayTracingPermutations = new ShaderPermutations({
                         {GL_VERTEX_SHADER,shaderSourcesBundle.rayTracingVs},
                         {GL_FRAGMENT_SHADER,shaderSourcesBundle.rayTracingFs}
+                },{
+                        {GL_FRAGMENT_SHADER,shaderSourcesBundle.rayTracingCommon}
                 });
+                _shaderPrograms[RS_RAY_TRACING] = _rayTracingPermutations->get(key);
+
+                // Вычислительная программа для волновой трассировки (не обязательна)
+                if(shaderSourcesBundle.rayTracingCs != nullptr){
+                    _rayTracingComputePermutations = new ShaderPermutations({
+                            {GL_COMPUTE_SHADER,shaderSourcesBundle.rayTracingCs}
+                    },{
+                            {GL_COMPUTE_SHADER,shaderSourcesBundle.rayTracingCommon}
+                    });
+                    _rayTracingComputeProgram = _rayTracingComputePermutations->get(key);
+                }
 
-                /*
-                // Программа для стадии пост-процессинга
-                _shaderPrograms[RS_POST_PROCESS] = new ShaderProgram({
-                        {GL_VERTEX_SHADER,shaderSourcesBundle.postProcessVs},
-                        {GL_FRAGMENT_SHADER,shaderSourcesBundle.postProcessFs}
-                });
-                */
+                // Программа растеризации буфера видимости первичных лучей (не обязательна)
+                if(shaderSourcesBundle.visibilityVs != nullptr && shaderSourcesBundle.visibilityGs != nullptr && shaderSourcesBundle.visibilityFs != nullptr){
+                    _visibilityProgram = new ShaderProgram({
+                            {GL_VERTEX_SHADER,shaderSourcesBundle.visibilityVs},
+                            {GL_GEOMETRY_SHADER,shaderSourcesBundle.visibilityGs},
+                            {GL_FRAGMENT_SHADER,shaderSourcesBundle.visibilityFs}
+                    });
+                }
+
+                // Программа пост-процессинга - повышение разрешения вторичных лучей (не обязательна)
+                if(shaderSourcesBundle.postProcessVs != nullptr && shaderSourcesBundle.postProcessFs != nullptr){
+                    _shaderPrograms[RS_POST_PROCESS] = new ShaderProgram({
+                            {GL_VERTEX_SHADER,shaderSourcesBundle.postProcessVs},
+                            {GL_FRAGMENT_SHADER,shaderSourcesBundle.postProcessFs}
+                    });
+                }
+
+                // Программа растеризации карт теней (не обязательна)
+                if(shaderSourcesBundle.shadowMapVs != nullptr && shaderSourcesBundle.shadowMapFs != nullptr){
+                    _shadowMapProgram = new ShaderProgram({
+                            {GL_VERTEX_SHADER,shaderSourcesBundle.shadowMapVs},
+                            {GL_FRAGMENT_SHADER,shaderSourcesBundle.shadowMapFs}
+                    });
+                }
             }
 
             /// Ресурсы по умолчанию - геометрия
@@ -101,76 +166,219 @@ namespace rtgl
                 //TODO: инициализация текстур по умолчанию
             }
 
+            /// Вместимость буферов сцены
+            {
+                // Предельная вместимость определяется максимальным размером буфера хранения
+                // Для треугольников наибольший буфер - атрибуты, индексы узлов BVH (2n-1) должны помещаться в int
+                GLint64 maxBlockSize = 0;
+                glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+                _triangleCapacityLimit = static_cast<GLuint>(std::min<GLint64>(maxBlockSize / TRIANGLE_ATTRIBUTES_SIZE, INT_MAX / 2));
+                _meshCapacityLimit = static_cast<GLuint>(std::min<GLint64>(maxBlockSize / MESH_MATERIAL_SIZE, INT_MAX));
+                _lightCapacityLimit = static_cast<GLuint>(std::min<GLint64>(maxBlockSize / LIGHT_SOURCE_SIZE, INT_MAX));
+
+                // Начальная вместимость (при превышении буферы увеличиваются во время построения кадра)
+                _triangleCapacity = std::clamp<GLuint>(sceneLimits.triangles, 1, _triangleCapacityLimit);
+                _meshCapacity = std::clamp<GLuint>(sceneLimits.meshes, 1, _meshCapacityLimit);
+                _lightCapacity = std::clamp<GLuint>(sceneLimits.lights, 1, _lightCapacityLimit);
+            }
+
             /// Инициализация shader-storage-буферов
             {
                 // Считаем что индексы привязок заданы в шейдере явно
-                GLuint triangleBufferBinding = 0;
+                GLuint trianglePositionBufferBinding = 0;
                 GLuint triangleBufferCounterPerMeshBinding = 1;
+                GLuint lightSourcesBufferBinding = 2;
                 GLuint triangleBufferCounterGlobalBinding = 4;
                 GLuint meshBoundsMinBufferBinding = 5;
                 GLuint meshBoundsMaxBufferBinding = 6;
-
-                // Создать SSBO для структур треугольников
+                GLuint bvhNodeBufferBinding = 7;
+                GLuint bvhMortonInBufferBinding = 8;
+                GLuint bvhMortonOutBufferBinding = 9;
+                GLuint bvhRadixHistogramBufferBinding = 10;
+                GLuint bvhParentBufferBinding = 11;
+                GLuint meshInstanceBufferBinding = 17;
+                GLuint triangleAttributeBufferBinding = 18;
+                GLuint meshMaterialBufferBinding = 19;
+
+                // Создать SSBO для положений треугольников (первая вершина и два ребра)
                 // Данные записываются в буфер треугольников на этапе подготовки геометрии (RS_GEOMETRY_PREPARE)
-                // Записанные данные используются на этапе трассировки (RS_RAY_TRACING)
-                glGenBuffers(1, &_triangleBuffer);
-                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _triangleBuffer);
-                // По предварительным подсчетам на треугольник нужно 224 байта (с учетом выравнивания std 140)
-                glBufferData(GL_SHADER_STORAGE_BUFFER, 224 * MAX_TRIANGLES_PREPARE, nullptr, GL_DYNAMIC_DRAW);
-                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, triangleBufferBinding, _triangleBuffer);
+                // Записанные данные используются при построении и обходе BVH (RS_BVH_BUILD, RS_RAY_TRACING)
+                glGenBuffers(1, &_trianglePositionBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _trianglePositionBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, TRIANGLE_POSITIONS_SIZE * static_cast<GLsizeiptr>(_triangleCapacity), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, trianglePositionBufferBinding, _trianglePositionBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Атрибуты вершин треугольников (нормали, цвета, UV) - читаются только для ближайшего пересечения
+                glGenBuffers(1, &_triangleAttributeBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _triangleAttributeBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, TRIANGLE_ATTRIBUTES_SIZE * static_cast<GLsizeiptr>(_triangleCapacity), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, triangleAttributeBufferBinding, _triangleAttributeBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Материалы мешей (записываются при подготовке геометрии, индекс меша хранится в положении треугольника)
+                glGenBuffers(1, &_meshMaterialBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshMaterialBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, MESH_MATERIAL_SIZE * static_cast<GLsizeiptr>(_meshCapacity), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, meshMaterialBufferBinding, _meshMaterialBuffer);
                 glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-                // Атомарный счетчик для подсчета кол-ва треугольников на каждый отдельный меш
+                // Счетчики треугольников каждого отдельного меша (SSBO - кол-во мешей не ограничено числом атомарных счетчиков)
                 glGenBuffers(1, &_triangleCounterPerMeshBuffer);
-                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterPerMeshBuffer);
-                glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint) * MAX_MESHES, nullptr, GL_DYNAMIC_DRAW);
-                glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, triangleBufferCounterPerMeshBinding, _triangleCounterPerMeshBuffer);
-                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _triangleCounterPerMeshBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * static_cast<GLsizeiptr>(_meshCapacity), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, triangleBufferCounterPerMeshBinding, _triangleCounterPerMeshBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-                // Атомарный счетчик для подсчета общего количества треугольников в буфере треугольников
+                // Атомарные счетчики - общее кол-во треугольников в буфере треугольников, кол-во лучей, завершенных русской рулеткой,
+                // кол-во отраженных лучей первичных пересечений, кол-во отражений, найденных в экранном пространстве,
+                // и кол-во теневых лучей, обошедших структуру ускорения мешей
+                const GLuint zeroCounters[5] = {};
                 glGenBuffers(1, &_triangleCounterGlobalBuffer);
                 glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterGlobalBuffer);
-                glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
-                glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &INITIAL_ZERO);
+                glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(zeroCounters), zeroCounters, GL_DYNAMIC_DRAW);
                 glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, triangleBufferCounterGlobalBinding, _triangleCounterGlobalBuffer);
                 glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
 
-                // Буфер хранящий информацию о минимальной точке
+                // Мировые границы каждого меша - минимальная точка (вычисляются на CPU при подготовке меша)
                 glGenBuffers(1, &_meshBoundsMinBuffer);
                 glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBoundsMinBuffer);
-                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLint) * 4 * MAX_MESHES, nullptr, GL_DYNAMIC_DRAW);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLfloat) * 4 * static_cast<GLsizeiptr>(_meshCapacity), nullptr, GL_DYNAMIC_DRAW);
                 glBindBufferBase(GL_SHADER_STORAGE_BUFFER, meshBoundsMinBufferBinding, _meshBoundsMinBuffer);
                 glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-                // Атомарный счетчик для выяснения bounding box'ов каждого меша (максимальная точка)
+                // Мировые границы каждого меша - максимальная точка
                 glGenBuffers(1, &_meshBoundsMaxBuffer);
                 glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBoundsMaxBuffer);
-                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLint) * 4 * MAX_MESHES, nullptr, GL_DYNAMIC_DRAW);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLfloat) * 4 * static_cast<GLsizeiptr>(_meshCapacity), nullptr, GL_DYNAMIC_DRAW);
                 glBindBufferBase(GL_SHADER_STORAGE_BUFFER, meshBoundsMaxBufferBinding, _meshBoundsMaxBuffer);
                 glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Узлы BVH (n-1 внутренних узлов и n листьев), по 32 байта на узел (std430)
+                // Строится на этапе RS_BVH_BUILD, используется на этапе трассировки (RS_RAY_TRACING)
+                glGenBuffers(1, &_bvhNodeBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _bvhNodeBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, 32 * (2 * static_cast<GLsizeiptr>(_triangleCapacity) - 1), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bvhNodeBufferBinding, _bvhNodeBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Пары (код Мортона, индекс треугольника) - вход и выход прохода поразрядной сортировки
+                glGenBuffers(2, _bvhMortonBuffers);
+                for(GLuint buffer : _bvhMortonBuffers){
+                    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+                    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * 2 * static_cast<GLsizeiptr>(_triangleCapacity), nullptr, GL_DYNAMIC_DRAW);
+                }
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bvhMortonInBufferBinding, _bvhMortonBuffers[0]);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bvhMortonOutBufferBinding, _bvhMortonBuffers[1]);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Гистограммы разрядов сортировки (для каждой рабочей группы)
+                const GLuint bvhGroups = (_triangleCapacity + BVH_GROUP_SIZE - 1) / BVH_GROUP_SIZE;
+                glGenBuffers(1, &_bvhRadixHistogramBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _bvhRadixHistogramBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * (1u << BVH_RADIX_BITS) * bvhGroups, nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bvhRadixHistogramBufferBinding, _bvhRadixHistogramBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Индексы родителей и счетчики посещений узлов (для вычисления границ снизу вверх)
+                glGenBuffers(1, &_bvhParentBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _bvhParentBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLint) * 2 * (2 * static_cast<GLsizeiptr>(_triangleCapacity) - 1), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bvhParentBufferBinding, _bvhParentBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Источники света (std140, размер буфера увеличивается по мере добавления источников)
+                glGenBuffers(1, &_lightSourcesBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _lightSourcesBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, LIGHT_SOURCE_SIZE * static_cast<GLsizeiptr>(_lightCapacity), nullptr, GL_DYNAMIC_DRAW);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, lightSourcesBufferBinding, _lightSourcesBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Экземпляры мешей (матрицы и материалы) для пакетной подготовки геометрии
+                _meshInstanceBuffer = new MeshInstanceBuffer(meshInstanceBufferBinding);
+            }
+
+            /// Сохраняемая сцена
+            {
+                // Участки и индексы мешей ограничены лишь предельной вместимостью (буферы увеличиваются при добавлении)
+                _retainedScene = new RetainedScene(_triangleCapacityLimit, _meshCapacityLimit);
+            }
+
+            /// Двухуровневая структура ускорения
+            {
+                // Считаем что индексы привязок заданы в шейдере явно
+                GLuint blasNodeBufferBinding = 12;
+                GLuint blasPositionBufferBinding = 13;
+                GLuint instanceBufferBinding = 14;
+                GLuint blasAttributeBufferBinding = 20;
+                GLuint blasLeafIndexBufferBinding = 30;
+
+                // BLAS всех геометрических буферов (узлы, положения и атрибуты треугольников в пространстве объекта)
+                // Соответствие треугольников буфера индексов треугольникам BLAS читается только при растеризации буфера видимости
+                _blasPool = new BlasPool(blasNodeBufferBinding, blasPositionBufferBinding, blasAttributeBufferBinding, blasLeafIndexBufferBinding);
+
+                // TLAS записывается в буфер узлов BVH сцены, экземпляры мешей - в отдельный буфер
+                _tlasBuilder = new TlasBuilder(instanceBufferBinding);
+            }
+
+            /// Аналитические примитивы
+            {
+                // Считаем что индексы привязок заданы в шейдере явно
+                GLuint primitiveNodeBufferBinding = 28;
+                GLuint primitiveBufferBinding = 29;
+                GLuint primitiveDataTextureUnit = 1;
+
+                // Узлы BVH и записи примитивов хранятся в собственных буферах (не зависят от структуры ускорения мешей)
+                _primitiveBvhBuilder = new PrimitiveBvhBuilder(primitiveNodeBufferBinding, primitiveBufferBinding);
+
+                // Карты высот и октодеревья читаются через буфер текстуры (блоки хранения программы трассировки исчерпаны)
+                _primitiveDataPool = new PrimitiveDataPool(primitiveDataTextureUnit);
+            }
+
+            /// Зонды отражений
+            {
+                // Считаем что текстурный блок задан в шейдере явно
+                GLuint reflectionProbeTextureUnit = 4;
+
+                // Кубические карты всех зондов - слои одного массива (карта выбирается индексом слоя в шейдере)
+                _reflectionProbePool = new ReflectionProbePool(REFLECTION_PROBE_FACE_SIZE, MAX_REFLECTION_PROBES, reflectionProbeTextureUnit);
+            }
+
+            /// Карты теней
+            if(_shadowMapProgram != nullptr)
+            {
+                // Считаем что текстурный блок задан в шейдере явно
+                GLuint shadowMapTextureUnit = 9;
+
+                // Кубические карты источников кадра - слои одного массива (слой - индекс источника в кадре)
+                _shadowMaps = new ShadowMapArray(SHADOW_MAP_FACE_SIZE, MAX_SHADOW_MAPS, shadowMapTextureUnit);
             }
 
             /// Инициализация UBO-буферов
             {
                 // Считаем что индексы привязок заданы в шейдере явно
-                GLuint lightSourcesBufferBinding = 2;
                 GLuint commonSettingsBufferBinding = 3;
 
-                // Создать UBO для массив структур источников света
-                glGenBuffers(1, &_lightSourcesBuffer);
-                glBindBuffer(GL_UNIFORM_BUFFER, _lightSourcesBuffer);
-                glBufferData(GL_UNIFORM_BUFFER, 64 * MAX_LIGHTS, nullptr, GL_STREAM_DRAW);
-                glBindBufferBase(GL_UNIFORM_BUFFER, lightSourcesBufferBinding, _lightSourcesBuffer);
-                glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-                // Создать UBO для общих настроек и параметров
+                // Создать UBO для общих настроек и параметров (вместимость буфера треугольников передается шейдерам здесь)
+                // Кол-во примитивов (смещение 16) начинает второй 16-байтный блок std140
+                const GLuint noPrimitives = 0;
                 glGenBuffers(1, &_commonSettingsBuffer);
                 glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
-                glBufferData(GL_UNIFORM_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+                glBufferData(GL_UNIFORM_BUFFER, 32, nullptr, GL_STREAM_DRAW);
+                glBufferSubData(GL_UNIFORM_BUFFER, 16, 4, &noPrimitives);
+                glBufferSubData(GL_UNIFORM_BUFFER, 8, 4, &_accelerationStructure);
+                glBufferSubData(GL_UNIFORM_BUFFER, 12, 4, &_triangleCapacity);
                 glBindBufferBase(GL_UNIFORM_BUFFER, commonSettingsBufferBinding, _commonSettingsBuffer);
                 glBindBuffer(GL_UNIFORM_BUFFER, 0);
             }
 
+            /// Запросы статистики
+            {
+                glGenQueries(1, &_geometryPrepareTimeQuery);
+                glGenQueries(1, &_rayTracingTimeQuery);
+                glGenQueries(1, &_primaryVisibilityTimeQuery);
+            }
+
             /// Кадровые буферы
             {
                 // Разрешение экрана
@@ -179,11 +387,99 @@ namespace rtgl
 
                 // Кадровый буфер экрана - основной текстурный буфер в который осуществляется запись картинки
                 // Буфер состоит только из цветового вложения, поскольку нам НЕ нужен буфер глубины (ray tracing)
+                // Формат с альфа-каналом нужен для доступа к вложению как к изображению (волновая трассировка)
                 _screenFrameBuffer = new FrameBuffer(_screenWidth,_screenHeight);
-                _screenFrameBuffer -> addTextureAttachment(GL_RGB32F,GL_RGB,GL_COLOR_ATTACHMENT0,false);
+                _screenFrameBuffer -> addTextureAttachment(GL_RGBA32F,GL_RGBA,GL_COLOR_ATTACHMENT0,false);
                 if(!_screenFrameBuffer->prepareBuffer({GL_COLOR_ATTACHMENT0})){
                     throw std::runtime_error("Can't initialize screen frame buffer");
                 }
+
+                // Буфер видимости - целочисленное цветовое вложение и буфер глубины (только при наличии программы растеризации)
+                // Текстура вложения постоянно привязана к своему блоку, из нее читают программы трассировки
+                if(_visibilityProgram != nullptr){
+                    GLuint visibilityTextureUnit = 2;
+
+                    _visibilityFrameBuffer = new FrameBuffer(_screenWidth,_screenHeight);
+                    _visibilityFrameBuffer -> addTextureAttachment(GL_RGBA32UI,GL_RGBA_INTEGER,GL_COLOR_ATTACHMENT0,false);
+                    _visibilityFrameBuffer -> addRenderBufferAttachment(GL_DEPTH_COMPONENT32F,GL_DEPTH_ATTACHMENT);
+                    if(!_visibilityFrameBuffer->prepareBuffer({GL_COLOR_ATTACHMENT0})){
+                        throw std::runtime_error("Can't initialize visibility frame buffer");
+                    }
+
+                    glActiveTexture(GL_TEXTURE0 + visibilityTextureUnit);
+                    glBindTexture(GL_TEXTURE_2D, _visibilityFrameBuffer->getTextureAttachments()[0]);
+                    glActiveTexture(GL_TEXTURE0);
+
+                    // Изображение предыдущего кадра для отражений в экранном пространстве (копируется из основного кадрового буфера)
+                    GLuint reflectionHistoryTextureUnit = 3;
+
+                    _reflectionHistoryFrameBuffer = new FrameBuffer(_screenWidth,_screenHeight);
+                    _reflectionHistoryFrameBuffer -> addTextureAttachment(GL_RGBA32F,GL_RGBA,GL_COLOR_ATTACHMENT0,false);
+                    if(!_reflectionHistoryFrameBuffer->prepareBuffer({GL_COLOR_ATTACHMENT0})){
+                        throw std::runtime_error("Can't initialize reflection history frame buffer");
+                    }
+
+                    glActiveTexture(GL_TEXTURE0 + reflectionHistoryTextureUnit);
+                    glBindTexture(GL_TEXTURE_2D, _reflectionHistoryFrameBuffer->getTextureAttachments()[0]);
+                    glActiveTexture(GL_TEXTURE0);
+                }
+            }
+
+            /// Буферы волновой трассировки
+            {
+                // Считаем что индексы привязок заданы в шейдере явно
+                GLuint rayQueueInBufferBinding = 21;
+                GLuint rayQueueOutBufferBinding = 22;
+                GLuint rayHitBufferBinding = 23;
+                GLuint wavefrontStateBufferBinding = 24;
+                GLuint raySortBufferBinding = 25;
+
+                // Каждый луч порождает не более одного луча следующего отскока - очереди рассчитаны на луч на пиксель
+                const auto pixels = static_cast<GLsizeiptr>(_screenWidth) * _screenHeight;
+
+                // Очереди лучей - вход и выход отскока (меняются местами после каждого отскока)
+                glGenBuffers(2, _rayQueueBuffers);
+                for(GLuint buffer : _rayQueueBuffers){
+                    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+                    glBufferData(GL_SHADER_STORAGE_BUFFER, QUEUED_RAY_SIZE * pixels, nullptr, GL_DYNAMIC_COPY);
+                }
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, rayQueueInBufferBinding, _rayQueueBuffers[0]);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, rayQueueOutBufferBinding, _rayQueueBuffers[1]);
+
+                // Результаты поиска пересечений (по одному на луч входной очереди)
+                glGenBuffers(1, &_rayHitBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _rayHitBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, RAY_HIT_SIZE * pixels, nullptr, GL_DYNAMIC_COPY);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, rayHitBufferBinding, _rayHitBuffer);
+
+                // Аргументы косвенного вызова (3 значения), счетчики лучей входной и выходной очередей, счетчик работы
+                // и счетчик лучей всех отскоков кадра, за ними - гистограммы разрядов сортировки (для каждой рабочей группы)
+                // Гистограммы хранятся в том же буфере, чтобы не занимать отдельный блок хранения вычислительной программы
+                const GLuint initialState[7] = {0, 1, 1, 0, 0, 0, 0};
+                const GLsizeiptr sortGroups = (pixels + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE;
+                glGenBuffers(1, &_wavefrontStateBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _wavefrontStateBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(initialState) + sizeof(GLuint) * (1u << BVH_RADIX_BITS) * sortGroups, nullptr, GL_DYNAMIC_COPY);
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(initialState), initialState);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, wavefrontStateBufferBinding, _wavefrontStateBuffer);
+
+                // Пары (ключ сортировки, индекс луча) - две половины буфера, вход и выход прохода поразрядной сортировки вторичных лучей
+                glGenBuffers(1, &_raySortBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _raySortBuffer);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * 2 * 2 * pixels, nullptr, GL_DYNAMIC_COPY);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, raySortBufferBinding, _raySortBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                // Кол-во одновременно размещаемых рабочих групп (для постоянных потоков) известно только через расширение
+                if(GLEW_NV_shader_thread_group){
+                    GLint smCount = 0, warpsPerSm = 0, warpSize = 0;
+                    glGetIntegerv(GL_SM_COUNT_NV, &smCount);
+                    glGetIntegerv(GL_WARPS_PER_SM_NV, &warpsPerSm);
+                    glGetIntegerv(GL_WARP_SIZE_NV, &warpSize);
+                    if(smCount > 0 && warpsPerSm > 0 && warpSize > 0){
+                        _deviceGroupCount = std::max(static_cast<GLuint>(smCount * warpsPerSm * warpSize) / WAVEFRONT_GROUP_SIZE, 1u);
+                    }
+                }
             }
 
             /// Камера (установка камеры по умолчанию)
@@ -227,22 +523,89 @@ namespace rtgl
 
         // Уничтожение фрейм-буферов
         delete _screenFrameBuffer;
+        delete _visibilityFrameBuffer;
+        delete _reflectionHistoryFrameBuffer;
+        _visibilityFrameBuffer = nullptr;
+        _reflectionHistoryFrameBuffer = nullptr;
+        delete _primaryFrameBuffer;
+        delete _secondaryFrameBuffer;
+        _primaryFrameBuffer = nullptr;
+        _secondaryFrameBuffer = nullptr;
+        _secondaryRayResolution = SRR_FULL;
+        _reflectionHistoryValid = false;
 
         // Уничтожение SSBO (Storage Buffer)
-        GLuint ssbo[5] = {_triangleBuffer, _triangleCounterPerMeshBuffer, _triangleCounterGlobalBuffer, _meshBoundsMinBuffer, _meshBoundsMaxBuffer};
-        glDeleteBuffers(5, ssbo);
+        GLuint ssbo[13] = {_trianglePositionBuffer, _triangleAttributeBuffer, _meshMaterialBuffer, _triangleCounterPerMeshBuffer, _triangleCounterGlobalBuffer,
+                           _meshBoundsMinBuffer, _meshBoundsMaxBuffer, _bvhNodeBuffer, _bvhMortonBuffers[0], _bvhMortonBuffers[1],
+                           _bvhRadixHistogramBuffer, _bvhParentBuffer, _lightSourcesBuffer};
+        glDeleteBuffers(13, ssbo);
+
+        // Уничтожение буферов волновой трассировки
+        GLuint wavefront[5] = {_rayQueueBuffers[0], _rayQueueBuffers[1], _rayHitBuffer, _wavefrontStateBuffer, _raySortBuffer};
+        glDeleteBuffers(5, wavefront);
+
+        // Уничтожение буфера экземпляров
+        delete _meshInstanceBuffer;
+        _meshInstanceBuffer = nullptr;
+
+        // Уничтожение сохраняемой сцены
+        delete _retainedScene;
+        _retainedScene = nullptr;
+
+        // Уничтожение двухуровневой структуры ускорения
+        delete _blasPool;
+        delete _tlasBuilder;
+        _blasPool = nullptr;
+        _tlasBuilder = nullptr;
+
+        // Уничтожение BVH аналитических примитивов
+        delete _primitiveBvhBuilder;
+        delete _primitiveDataPool;
+        _primitiveBvhBuilder = nullptr;
+        _primitiveDataPool = nullptr;
+
+        // Уничтожение кубических карт зондов отражений
+        delete _reflectionProbePool;
+        _reflectionProbePool = nullptr;
+        _frameReflectionProbeCount = 0;
+        _reflectionProbeCursor = 0;
+
+        // Уничтожение карт теней
+        delete _shadowMaps;
+        _shadowMaps = nullptr;
+        _frameShadowMapCount = 0;
+        _shadowMode = SM_TRACED;
+
+        // Уничтожение запросов статистики
+        glDeleteQueries(1, &_geometryPrepareTimeQuery);
+        glDeleteQueries(1, &_rayTracingTimeQuery);
+        glDeleteQueries(1, &_primaryVisibilityTimeQuery);
+        glDeleteQueries(static_cast<GLsizei>(_secondaryRayTimestampQueries.size()), _secondaryRayTimestampQueries.data());
+        _secondaryRayTimestampQueries.clear();
 
         // Уничтожение UBO (Uniform Buffer)
-        GLuint ubo[2] = {_lightSourcesBuffer, _commonSettingsBuffer};
-        glDeleteBuffers(2, ubo);
+        glDeleteBuffers(1, &_commonSettingsBuffer);
 
         // Уничтожение геометрии по умолчанию
         delete _geometryQuad;
 
         // Уничтожение шейдерных программ
         delete _shaderPrograms[RS_GEOMETRY_PREPARE];
-        delete _shaderPrograms[RS_RAY_TRACING];
+        delete _shaderPrograms[RS_BVH_BUILD];
         delete _shaderPrograms[RS_POST_PROCESS];
+        delete _geometryPrepareComputeProgram;
+        delete _visibilityProgram;
+        delete _shadowMapProgram;
+        _visibilityProgram = nullptr;
+        _shadowMapProgram = nullptr;
+
+        // Программы трассировки принадлежат наборам специализаций
+        delete _rayTracingPermutations;
+        delete _rayTracingComputePermutations;
+        _rayTracingPermutations = nullptr;
+        _rayTracingComputePermutations = nullptr;
+        _shaderPrograms[RS_RAY_TRACING] = nullptr;
+        _rayTracingComputeProgram = nullptr;
     }
 
     /// К А М Е Р А
@@ -312,36 +675,28 @@ namespace rtgl
         return true;
     }
 
-    /// Р Е Н Д Е Р И Н Г
+    /// Н А С Т Р О Й К И
 
     /**
-     * Добавление источника света на сцену (UBO-буфер источников света)
-     * @param lightSource Хендл источника
+     * Установка типа структуры ускорения (действует начиная со следующего кадра)
+     * @param type Тип структуры ускорения
      * @return Состояние операции
      */
-    bool __cdecl SetLightSource(HLightSource lightSource)
+    bool __cdecl SetAccelerationStructure(AccelerationStructureType type)
     {
         try
         {
-            // Указатель на источник света
-            auto pLightSource = reinterpret_cast<LightSource*>(lightSource);
-
-            // Проверка на готовность к операции
-            if(!_bInitialized)
-                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
-
-            if(pLightSource == nullptr)
-                throw std::runtime_error("No light source provided");
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(_meshesCount > 0) throw std::runtime_error("Acceleration structure can't be changed while scene is being set");
 
-            // Запись источника в буфер
-            pLightSource->writeToUniformBufferStd140(_lightSourcesBuffer,_lightSourceCount * 64);
+            _accelerationStructure = type;
 
-            // Увеличение кол-ва источников света
-            _lightSourceCount++;
+            // Буфер треугольников не обновлялся в двухуровневом режиме - меши сохраняемой сцены готовятся заново
+            _retainedScene->invalidate();
 
-            // Обновить количество источников света в uniform-буфере
+            // Обновить тип структуры в uniform-буфере
             glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
-            glBufferSubData(GL_UNIFORM_BUFFER, 0, 4, &_lightSourceCount);
+            glBufferSubData(GL_UNIFORM_BUFFER, 8, 4, &_accelerationStructure);
             glBindBuffer(GL_UNIFORM_BUFFER, 0);
         }
         catch(std::exception& ex)
@@ -354,96 +709,135 @@ namespace rtgl
     }
 
     /**
-     * Добавление меша в геометрический буфер (SSBO-буфер треугольников)
-     * @param mesh Хендл меша
+     * Установка способа подготовки геометрии (действует начиная со следующего кадра)
+     * @param mode Способ подготовки геометрии
      * @return Состояние операции
      */
-    bool __cdecl SetMesh(HMesh mesh)
+    bool __cdecl SetGeometryPrepareMode(GeometryPrepareMode mode)
     {
         try
         {
-            // Указатель на меш
-            auto pMesh = reinterpret_cast<Mesh*>(mesh);
-
-            // Проверка на готовность к операции
-            if(!_bInitialized)
-                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(_meshesCount > 0) throw std::runtime_error("Geometry prepare mode can't be changed while scene is being set");
+            if(mode == GP_COMPUTE_SHADER && _geometryPrepareComputeProgram == nullptr) throw std::runtime_error("No required shader set");
 
-            if(_shaderPrograms[RS_GEOMETRY_PREPARE] == nullptr)
-                throw std::runtime_error("No required shader set");
+            _geometryPrepareMode = mode;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-            if(pMesh == nullptr)
-                throw std::runtime_error("No mesh provided");
+        return true;
+    }
 
-            // Если пердыдущий проход был другим - установить необходимые параметры
-            if(_lastRenderingStage != RS_GEOMETRY_PREPARE)
-            {
-                // Привязываемся ко фрейм-буфферу (временно используем основной)
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    /**
+     * Установка способа трассировки лучей
+     * @param mode Способ трассировки
+     * @return Состояние операции
+     */
+    bool __cdecl SetRayTracingMode(RayTracingMode mode)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(mode != RT_FRAGMENT_SHADER && _rayTracingComputeProgram == nullptr) throw std::runtime_error("No required shader set");
 
-                // Использовать шейдер
-                glUseProgram(_shaderPrograms[RS_GEOMETRY_PREPARE]->getId());
+            _rayTracingMode = mode;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-                // Сменить идентификатор последного прохода
-                _lastRenderingStage = RS_GEOMETRY_PREPARE;
+        return true;
+    }
 
-                // Сброс общего атомарного счетчика треугольников
-                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterGlobalBuffer);
-                glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &INITIAL_ZERO);
-                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
-            }
+    /**
+     * Установка глубины трассировки (кол-во последовательных кастов луча, включая первичный)
+     * @param depth Глубина трассировки (для новой глубины собирается своя специализация программы трассировки)
+     * @return Состояние операции
+     */
+    bool __cdecl SetRayDepth(unsigned depth)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(depth == 0) throw std::runtime_error("Ray depth must be greater than zero");
 
-            // Сброс атомарного счетчика треугольников для текущего меша
-            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterPerMeshBuffer);
-            glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint) * _meshesCount, sizeof(GLuint), &INITIAL_ZERO);
-            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+            _rayDepth = depth;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-            // Сброс минимальной точки меша
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBoundsMinBuffer);
-            for(unsigned i = 0; i < 3; i++) {
-                GLsizei offset = (sizeof(GLint) * 4 * _meshesCount) + (sizeof(GLint) * i);
-                glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, sizeof(GLint), &INITIAL_MAX_INT);
-            }
-            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+        return true;
+    }
 
-            // Сброс максимальной точки меша
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBoundsMaxBuffer);
-            for(unsigned i = 0; i < 3; i++) {
-                GLsizei offset = (sizeof(GLint) * 4 * _meshesCount) + (sizeof(GLint) * i);
-                glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, sizeof(GLint), &INITIAL_MIN_INT);
-            }
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    /**
+     * Установка параметров трассировки постоянными потоками (режим RT_PERSISTENT_THREADS)
+     * @param batchSize Кол-во пикселей каждого потока в порции, получаемой группой за одно обращение к счетчику работы
+     * @param groupCount Кол-во запускаемых рабочих групп (0 - по размеру устройства, ограничено предельным кол-вом групп устройства)
+     * @return Состояние операции
+     */
+    bool __cdecl SetPersistentThreadsParameters(unsigned batchSize, unsigned groupCount)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(batchSize == 0) throw std::runtime_error("Batch size must be greater than zero");
+            if(batchSize > std::numeric_limits<GLuint>::max() / WAVEFRONT_GROUP_SIZE) throw std::runtime_error("Batch size is too large");
 
-            // Передача матриц в шейдер
-            glUniformMatrix4fv(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->view, 1, GL_FALSE, glm::value_ptr(_camera->getViewMatrix()));
-            glUniformMatrix4fv(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->model,1, GL_FALSE, glm::value_ptr(pMesh->getModelMatrix()));
+            _persistentBatchSize = batchSize;
+            _persistentGroupCount = groupCount;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-            // Передача информации о материале в шейдер
-            glUniform3fv(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->materialAlbedo, 1, glm::value_ptr(pMesh->material.albedo));
-            glUniform1f(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->materialMetallic, pMesh->material.metallic);
-            glUniform1f(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->materialRoughness, pMesh->material.roughness);
-            glUniform1f(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->materialPrimaryToSecondaryRatio, pMesh->material.primaryToSecondary);
-            glUniform1f(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->materialReflectToRefractRatio, pMesh->material.reflectionToRefraction);
-            glUniform1f(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->materialRefractionCoff, pMesh->material.refractionCoff);
+        return true;
+    }
 
-            // Передача информации об индексе текущего меша в шейдер
-            glUniform1ui(_shaderPrograms[RS_GEOMETRY_PREPARE]->getUniformLocations()->meshIndex, _meshesCount);
+    /**
+     * Включение сортировки вторичных лучей перед каждым отскоком (режим RT_WAVEFRONT)
+     * @param enabled Сортировать ли лучи (по октанту направления и коду Мортона начала)
+     * @return Состояние операции
+     */
+    bool __cdecl SetSecondaryRaySorting(bool enabled)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
-            // Привязать геометрию и нарисовать ее
-            glBindVertexArray(pMesh->geometry->getVaoId());
-            glDrawElements(GL_TRIANGLES, pMesh->geometry->getIndexCount(), GL_UNSIGNED_INT, nullptr);
-            glBindVertexArray(0);
+            _secondaryRaySorting = enabled;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-            // Ожидаем завершения работы с вершинами
-            glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        return true;
+    }
 
-            // Увеличение кол-ва мешей
-            _meshesCount++;
+    /**
+     * Включение совместного обхода структуры ускорения лучами подгруппы (GL_KHR_shader_subgroup_ballot/vote)
+     * @param enabled Обходить ли структуру всей подгруппой (без поддержки расширений драйвером всегда используется обход каждым потоком)
+     * @return Состояние операции
+     */
+    bool __cdecl SetSubgroupTraversal(bool enabled)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
-            // Обновить количество мешей в буфере UBO
-            glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
-            glBufferSubData(GL_UNIFORM_BUFFER, 4, 4, &_meshesCount);
-            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            _subgroupTraversal = enabled;
         }
         catch(std::exception& ex)
         {
@@ -455,66 +849,1869 @@ namespace rtgl
     }
 
     /**
-     * Отрисовка всей сцены (проход трассировки лучей)
+     * Выбор ядра проверки пересечений при обходе структуры ускорения
+     * @param kernel Ядро (IK_REFERENCE - исходные проверки, IK_PRECOMPUTED - с величинами, вычисленными для луча заранее)
      * @return Состояние операции
      */
-    bool __cdecl RenderScene()
+    bool __cdecl SetIntersectionKernel(IntersectionKernel kernel)
     {
         try
         {
-            // Проверка на готовность к операции
-            if(!_bInitialized)
-                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
-            if(_shaderPrograms[RS_RAY_TRACING] == nullptr)
-                throw std::runtime_error("No required shader set");
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
-            // Если пердыдущий проход был другим - установить необходимые параметры
-            if(_lastRenderingStage != RS_RAY_TRACING)
-            {
-                // Привязываемся ко фрейм-буфферу (временно используем основной)
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            _intersectionKernel = kernel;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-                // Использовать шейдер
-                glUseProgram(_shaderPrograms[RS_RAY_TRACING]->getId());
+        return true;
+    }
 
-                // Включить запись в цветовой буфер
-                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    /**
+     * Включение теней (теневой луч к каждому источнику, обход завершается на первом пересечении до сферы источника)
+     * @param enabled Трассировать ли тени
+     * @return Состояние операции
+     */
+    bool __cdecl SetShadows(bool enabled)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
 
-                // Указать область кадра доступную для отрисовки
-                glScissor(0, 0, _screenWidth, _screenHeight);
-                glViewport(0, 0, _screenWidth, _screenHeight);
+            _shadows = enabled;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-                // Сменить идентификатор последного прохода
-                _lastRenderingStage = RS_RAY_TRACING;
-            }
+        return true;
+    }
 
-            // Очистка буфера
-            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+    /**
+     * Установка способа получения теней
+     * Карты теней растеризуются только при двухуровневой структуре ускорения (иначе тени трассируются) и только для первых
+     * MAX_SHADOW_MAPS источников кадра, остальные источники затеняются теневыми лучами
+     * @param mode Способ получения теней
+     * @return Состояние операции
+     */
+    bool __cdecl SetShadowMode(ShadowMode mode)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(mode == SM_HYBRID && _shadowMapProgram == nullptr) throw std::runtime_error("No required shader set");
 
-            // Передать FOV
-            glUniform1f(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->fov,_camera->getFov());
-            // Передать соотношение сторон
-            glUniform1f(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->aspectRatio,_camera->getAspectRatio());
-            // Передать положение камеры
-            glUniform3fv(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->camPosition, 1, glm::value_ptr(_camera->getPosition()));
-            // Передать матрицу вида для преобразования положений источников света в пространство вида
-            glUniformMatrix4fv(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->camModelMat, 1, GL_FALSE, glm::value_ptr(_camera->getModelMatrix()));
+            _shadowMode = mode;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
 
-            // Привязать геометрию и нарисовать ее
-            glBindVertexArray(_geometryQuad->getVaoId());
-            glDrawElements(GL_TRIANGLES, _geometryQuad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
-            glBindVertexArray(0);
+        return true;
+    }
+
+    /**
+     * Установка порога веса луча для завершения путей русской рулеткой
+     * Луч с весом ниже порога продолжается с вероятностью вес/порог (вес выжившего луча становится равным порогу)
+     * @param threshold Порог веса (0 - пути не завершаются)
+     * @return Состояние операции
+     */
+    bool __cdecl SetRayWeightThreshold(float threshold)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(threshold < 0.0f || threshold > 1.0f) throw std::runtime_error("Ray weight threshold must be in [0, 1] range");
+
+            _rayWeightThreshold = threshold;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Включение буфера видимости первичных лучей (меши растеризуются, обход структуры ускорения - только для вторичных лучей)
+     * Действует только при двухуровневой структуре ускорения, при AS_SCENE_LBVH первичные лучи трассируются
+     * @param enabled Растеризовать ли первичную видимость
+     * @return Состояние операции
+     */
+    bool __cdecl SetPrimaryVisibility(bool enabled)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(enabled && _visibilityProgram == nullptr) throw std::runtime_error("No required shader set");
+
+            _primaryVisibility = enabled;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Установка способа получения отражений первичных лучей
+     * Отражения в экранном пространстве используют буфер видимости (только при двухуровневой структуре ускорения,
+     * иначе отраженные лучи трассируются) и изображение предыдущего кадра - в первом кадре после включения лучи трассируются
+     * @param mode Способ получения отражений
+     * @return Состояние операции
+     */
+    bool __cdecl SetReflectionMode(ReflectionMode mode)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(mode == RM_SCREEN_SPACE && _visibilityProgram == nullptr) throw std::runtime_error("No required shader set");
+
+            _reflectionMode = mode;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Установка параметров отражений в экранном пространстве
+     * @param maxSteps Предельное кол-во шагов по экрану (отрезок луча длиннее - проходится с шагом больше пикселя)
+     * @param thickness Толщина поверхностей буфера видимости (луч, прошедший за поверхностью глубже, не засчитывает пересечение)
+     * @return Состояние операции
+     */
+    bool __cdecl SetScreenSpaceReflectionParameters(unsigned maxSteps, float thickness)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(maxSteps == 0) throw std::runtime_error("Screen space reflection step count must be greater than 0");
+            if(thickness <= 0.0f) throw std::runtime_error("Screen space reflection thickness must be greater than 0");
+
+            _reflectionMaxSteps = maxSteps;
+            _reflectionThickness = thickness;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Установка параметров зондов отражений
+     * @param roughnessThreshold Шероховатость, начиная с которой отражение поверхности берется из зонда
+     * @param bounceDepth Отскок, начиная с которого из зонда берется отражение любой поверхности (0 - с первичных лучей)
+     * @param facesPerFrame Кол-во граней кубических карт, отрисовываемых за кадр (0 - карты не обновляются)
+     * @return Состояние операции
+     */
+    bool __cdecl SetReflectionProbeParameters(float roughnessThreshold, unsigned bounceDepth, unsigned facesPerFrame)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(roughnessThreshold < 0.0f) throw std::runtime_error("Reflection probe roughness threshold can't be negative");
+
+            _reflectionProbeRoughness = roughnessThreshold;
+            _reflectionProbeBounceDepth = bounceDepth;
+            _reflectionProbeFacesPerFrame = facesPerFrame;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Установка разрешения вторичных лучей (только при трассировке фрагментным шейдером)
+     * @param resolution Разрешение вторичных лучей
+     * @return Состояние операции
+     */
+    bool __cdecl SetSecondaryRayResolution(SecondaryRayResolution resolution)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(resolution != SRR_FULL && _shaderPrograms[RS_POST_PROCESS] == nullptr) throw std::runtime_error("No required shader set");
+
+            delete _primaryFrameBuffer;
+            delete _secondaryFrameBuffer;
+            _primaryFrameBuffer = nullptr;
+            _secondaryFrameBuffer = nullptr;
+            _secondaryRayResolution = resolution;
+
+            if(resolution == SRR_FULL) return true;
+
+            // Цвет (вложение 0) и поверхность первичного пересечения (вложение 1) - в полном и пониженном разрешении
+            // Текстуры вложений постоянно привязаны к своим блокам, из них читает программа пост-процессинга
+            const GLsizei divisor = 1 << resolution;
+            const GLuint primaryTextureUnit = 5;
+            const GLuint secondaryTextureUnit = 7;
+
+            _primaryFrameBuffer = new FrameBuffer(_screenWidth,_screenHeight);
+            _secondaryFrameBuffer = new FrameBuffer((_screenWidth + divisor - 1) / divisor,(_screenHeight + divisor - 1) / divisor);
+
+            for(FrameBuffer* frameBuffer : {_primaryFrameBuffer, _secondaryFrameBuffer})
+            {
+                frameBuffer -> addTextureAttachment(GL_RGBA32F,GL_RGBA,GL_COLOR_ATTACHMENT0,false);
+                frameBuffer -> addTextureAttachment(GL_RGBA32F,GL_RGBA,GL_COLOR_ATTACHMENT1,false);
+                if(!frameBuffer->prepareBuffer({GL_COLOR_ATTACHMENT0,GL_COLOR_ATTACHMENT1})){
+                    throw std::runtime_error("Can't initialize secondary ray frame buffers");
+                }
+            }
+
+            for(GLuint i = 0; i < 2; i++)
+            {
+                glActiveTexture(GL_TEXTURE0 + primaryTextureUnit + i);
+                glBindTexture(GL_TEXTURE_2D, _primaryFrameBuffer->getTextureAttachments()[i]);
+                glActiveTexture(GL_TEXTURE0 + secondaryTextureUnit + i);
+                glBindTexture(GL_TEXTURE_2D, _secondaryFrameBuffer->getTextureAttachments()[i]);
+            }
+            glActiveTexture(GL_TEXTURE0);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /// С Т А Т И С Т И К А
+
+    /**
+     * Получение статистики последнего отрисованного кадра
+     * @param statistics Указатель на структуру статистики
+     * @return Состояние операции
+     */
+    bool __cdecl GetFrameStatistics(FrameStatistics* statistics)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(statistics == nullptr) throw std::runtime_error("No statistics structure provided");
+
+            // Чтение результата завершенного запроса (ожидание GPU происходит только здесь)
+            if(_geometryPrepareTimeQueryPending)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(_geometryPrepareTimeQuery, GL_QUERY_RESULT, &elapsed);
+                _frameStatistics.geometryPrepareTime = static_cast<float>(elapsed) / 1000000.0f;
+                _geometryPrepareTimeQueryPending = false;
+            }
+
+            if(_rayTracingTimeQueryPending)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(_rayTracingTimeQuery, GL_QUERY_RESULT, &elapsed);
+                _frameStatistics.rayTracingTime = static_cast<float>(elapsed) / 1000000.0f;
+                _rayTracingTimeQueryPending = false;
+            }
+
+            if(_primaryVisibilityTimeQueryPending)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(_primaryVisibilityTimeQuery, GL_QUERY_RESULT, &elapsed);
+                _frameStatistics.primaryVisibilityTime = static_cast<float>(elapsed) / 1000000.0f;
+                _primaryVisibilityTimeQueryPending = false;
+            }
+
+            if(_terminatedRaysPending)
+            {
+                // Завершенные русской рулеткой, отраженные, найденные в экранном пространстве и теневые лучи (счетчики подряд)
+                GLuint rayCounters[4] = {};
+                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterGlobalBuffer);
+                glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), sizeof(rayCounters), rayCounters);
+                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+                _frameStatistics.terminatedRayCount = rayCounters[0];
+                _frameStatistics.reflectionRayCount = rayCounters[1];
+                _frameStatistics.screenSpaceReflectionCount = rayCounters[2];
+                _frameStatistics.screenSpaceReflectionRatio = rayCounters[1] > 0 ?
+                        static_cast<float>(rayCounters[2]) / static_cast<float>(rayCounters[1]) : 0.0f;
+                _frameStatistics.shadowRayCount = rayCounters[3];
+                _terminatedRaysPending = false;
+            }
+
+            // Вторичные лучи последнего кадра волновой трассировки (счетчик включает первичные лучи - по одному на пиксель)
+            if(_secondaryRayStatisticsPending)
+            {
+                GLuint tracedRays = 0;
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, _wavefrontStateBuffer);
+                glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * 6, sizeof(GLuint), &tracedRays);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+                GLuint64 sortTime = 0, traceTime = 0;
+                for(GLuint bounce = 0; bounce < _secondaryRayBounces; bounce++)
+                {
+                    GLuint64 timestamps[3] = {};
+                    for(GLuint k = 0; k < 3; k++){
+                        glGetQueryObjectui64v(_secondaryRayTimestampQueries[bounce * 3 + k], GL_QUERY_RESULT, &timestamps[k]);
+                    }
+                    sortTime += timestamps[1] - timestamps[0];
+                    traceTime += timestamps[2] - timestamps[1];
+                }
+
+                const GLuint pixels = static_cast<GLuint>(_screenWidth) * static_cast<GLuint>(_screenHeight);
+                _frameStatistics.secondaryRayCount = tracedRays > pixels ? tracedRays - pixels : 0;
+                _frameStatistics.secondaryRaySortTime = static_cast<float>(sortTime) / 1000000.0f;
+                _frameStatistics.secondaryRayTraceTime = static_cast<float>(traceTime) / 1000000.0f;
+                _frameStatistics.secondaryMraysPerSecond = sortTime + traceTime > 0 ?
+                        static_cast<float>(static_cast<double>(_frameStatistics.secondaryRayCount) * 1000.0 / static_cast<double>(sortTime + traceTime)) : 0.0f;
+                _secondaryRayStatisticsPending = false;
+            }
+
+            *statistics = _frameStatistics;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /// В Н У Т Р Е Н Н И Е   Ф У Н К Ц И И
+
+    /**
+     * Обновить общее кол-во мешей (меши сохраняемой сцены и меши текущего кадра) в uniform-буфере
+     */
+    static void UpdateTotalMeshes()
+    {
+        const GLuint totalMeshes = _retainedScene->getMeshHighWater() + _meshesCount;
+        glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 4, 4, &totalMeshes);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    /**
+     * Сброс счетчиков треугольников диапазона мешей (одной операцией)
+     * @param first Индекс первого меша
+     * @param count Кол-во мешей
+     */
+    static void ResetMeshCounters(GLuint first, GLuint count)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _triangleCounterPerMeshBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, sizeof(GLuint) * static_cast<GLintptr>(first),
+                sizeof(GLuint) * static_cast<GLsizeiptr>(count), GL_RED_INTEGER, GL_UNSIGNED_INT, &INITIAL_ZERO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Запись мировых границ диапазона мешей (границы BLAS геометрии, переведенные матрицей модели)
+     * @details Границы вычисляются на CPU точно (без квантования и атомарных операций при подготовке геометрии)
+     * @param meshes Массив мешей (для nullptr записываются пустые границы, не влияющие на границы сцены)
+     * @param count Кол-во мешей
+     * @param first Индекс первого меша
+     */
+    static void WriteMeshBounds(const Mesh* const* meshes, size_t count, GLuint first)
+    {
+        std::vector<glm::vec4> boundsMin(count, glm::vec4(std::numeric_limits<GLfloat>::max()));
+        std::vector<glm::vec4> boundsMax(count, glm::vec4(-std::numeric_limits<GLfloat>::max()));
+
+        for(size_t i = 0; i < count; i++)
+        {
+            if(meshes[i] == nullptr) continue;
+
+            const BlasPool::Entry* blas = _blasPool->find(meshes[i]->geometry);
+            if(blas == nullptr) throw std::runtime_error("Mesh geometry has no acceleration structure");
+
+            glm::vec3 min, max;
+            BlasPool::transformBounds(*blas, meshes[i]->getModelMatrix(), min, max);
+            boundsMin[i] = glm::vec4(min, 0.0f);
+            boundsMax[i] = glm::vec4(max, 0.0f);
+        }
+
+        const auto offset = static_cast<GLintptr>(sizeof(glm::vec4) * first);
+        const auto size = static_cast<GLsizeiptr>(sizeof(glm::vec4) * count);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBoundsMinBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, boundsMin.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBoundsMaxBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, boundsMax.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Пересоздание буфера хранения с новым размером (буфер привязывается заново)
+     * @param buffer Хендл буфера (заменяется хендлом нового буфера)
+     * @param binding Индекс привязки буфера хранения
+     * @param oldSize Текущий размер буфера
+     * @param newSize Новый размер буфера
+     * @param preserve Копировать ли содержимое текущего буфера
+     */
+    static void ResizeStorageBuffer(GLuint& buffer, GLuint binding, GLsizeiptr oldSize, GLsizeiptr newSize, bool preserve)
+    {
+        GLuint resized = 0;
+        glGenBuffers(1, &resized);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+        glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_DYNAMIC_DRAW);
+
+        if(preserve){
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &buffer);
+        buffer = resized;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+    }
+
+    /**
+     * Новая вместимость буфера при превышении текущей (как минимум вдвое больше, чтобы постепенный рост сцены
+     * не приводил к пересозданию буферов каждый кадр)
+     * @param capacity Текущая вместимость
+     * @param required Требуемая вместимость
+     * @param limit Предельная вместимость
+     * @return Новая вместимость
+     */
+    static GLuint GrownCapacity(GLuint capacity, GLuint required, GLuint limit)
+    {
+        return std::min(std::max(required, capacity > limit / 2 ? limit : capacity * 2), limit);
+    }
+
+    /**
+     * Увеличение буфера треугольников и буферов построения BVH до требуемой вместимости
+     * @param required Требуемое кол-во треугольников (для двухуровневой структуры - экземпляров TLAS)
+     * @return Помещаются ли треугольники (при превышении предельной вместимости лишние треугольники отбрасываются)
+     */
+    static bool ReserveTriangleCapacity(GLuint required)
+    {
+        if(required <= _triangleCapacity) return true;
+        if(_triangleCapacity == _triangleCapacityLimit) return false;
+
+        const GLuint capacity = GrownCapacity(_triangleCapacity, required, _triangleCapacityLimit);
+        const auto oldCount = static_cast<GLsizeiptr>(_triangleCapacity);
+        const auto newCount = static_cast<GLsizeiptr>(capacity);
+        const auto groups = static_cast<GLsizeiptr>((capacity + BVH_GROUP_SIZE - 1) / BVH_GROUP_SIZE);
+
+        // Содержимое копируется после завершения записи уже подготовленных треугольников
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        // Положения и атрибуты сохраняются (участки сохраняемой сцены и меши, подготовленные ранее в этом кадре)
+        ResizeStorageBuffer(_trianglePositionBuffer, 0, TRIANGLE_POSITIONS_SIZE * oldCount, TRIANGLE_POSITIONS_SIZE * newCount, true);
+        ResizeStorageBuffer(_triangleAttributeBuffer, 18, TRIANGLE_ATTRIBUTES_SIZE * oldCount, TRIANGLE_ATTRIBUTES_SIZE * newCount, true);
+
+        // Буферы построения BVH заполняются заново каждый кадр
+        ResizeStorageBuffer(_bvhNodeBuffer, 7, 0, 32 * (2 * newCount - 1), false);
+        ResizeStorageBuffer(_bvhMortonBuffers[0], 8, 0, sizeof(GLuint) * 2 * newCount, false);
+        ResizeStorageBuffer(_bvhMortonBuffers[1], 9, 0, sizeof(GLuint) * 2 * newCount, false);
+        ResizeStorageBuffer(_bvhRadixHistogramBuffer, 10, 0, sizeof(GLuint) * (1u << BVH_RADIX_BITS) * groups, false);
+        ResizeStorageBuffer(_bvhParentBuffer, 11, 0, sizeof(GLint) * 2 * (2 * newCount - 1), false);
+
+        _triangleCapacity = capacity;
+        _frameBufferGrowCount++;
+
+        // Обновить вместимость в uniform-буфере
+        glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 12, 4, &_triangleCapacity);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        return required <= _triangleCapacity;
+    }
+
+    /**
+     * Увеличение буферов мешей (счетчики, границы, материалы) до требуемой вместимости
+     * @param required Требуемое кол-во мешей
+     */
+    static void ReserveMeshCapacity(GLuint required)
+    {
+        if(required <= _meshCapacity) return;
+        if(required > _meshCapacityLimit) throw std::runtime_error("Too many meshes");
+
+        const GLuint capacity = GrownCapacity(_meshCapacity, required, _meshCapacityLimit);
+        const auto oldCount = static_cast<GLsizeiptr>(_meshCapacity);
+        const auto newCount = static_cast<GLsizeiptr>(capacity);
+
+        // Данные мешей сохраняемой сцены и мешей, подготовленных ранее в этом кадре, сохраняются
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        ResizeStorageBuffer(_triangleCounterPerMeshBuffer, 1, sizeof(GLuint) * oldCount, sizeof(GLuint) * newCount, true);
+        ResizeStorageBuffer(_meshBoundsMinBuffer, 5, sizeof(GLfloat) * 4 * oldCount, sizeof(GLfloat) * 4 * newCount, true);
+        ResizeStorageBuffer(_meshBoundsMaxBuffer, 6, sizeof(GLfloat) * 4 * oldCount, sizeof(GLfloat) * 4 * newCount, true);
+        ResizeStorageBuffer(_meshMaterialBuffer, 19, MESH_MATERIAL_SIZE * oldCount, MESH_MATERIAL_SIZE * newCount, true);
+
+        _meshCapacity = capacity;
+        _frameBufferGrowCount++;
+    }
+
+    /**
+     * Увеличение буфера источников света до требуемой вместимости
+     * @param required Требуемое кол-во источников
+     */
+    static void ReserveLightCapacity(GLuint required)
+    {
+        if(required <= _lightCapacity) return;
+        if(required > _lightCapacityLimit) throw std::runtime_error("Too many light sources");
+
+        const GLuint capacity = GrownCapacity(_lightCapacity, required, _lightCapacityLimit);
+        ResizeStorageBuffer(_lightSourcesBuffer, 2, LIGHT_SOURCE_SIZE * static_cast<GLsizeiptr>(_lightCapacity),
+                LIGHT_SOURCE_SIZE * static_cast<GLsizeiptr>(capacity), true);
+
+        _lightCapacity = capacity;
+        _frameBufferGrowCount++;
+    }
+
+    /**
+     * Запуск вычислительного шейдера с заданным кол-вом рабочих групп
+     * @details Кол-во групп по каждой оси ограничено устройством, поэтому группы раскладываются по сетке X*Y -
+     * шейдер получает линейный индекс группы как gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x
+     * (группы последней строки сверх заданного кол-ва ничего не делают)
+     * @param groups Кол-во рабочих групп
+     */
+    static void DispatchComputeGroups(GLuint groups)
+    {
+        if(groups == 0) return;
+        const GLuint width = std::min(groups, _maxComputeGroupCount[0]);
+        glDispatchCompute(width, (groups + width - 1) / width, 1);
+    }
+
+    /**
+     * Подготовка одного меша (перевод треугольников в мировое пространство и запись в буфер по общему счетчику)
+     * @param pMesh Указатель на меш
+     * @param meshIndex Индекс меша
+     * @param compute Использовать ли вычислительную программу (иначе - вершинная и геометрическая)
+     */
+    static void PrepareMesh(Mesh* pMesh, GLuint meshIndex, bool compute)
+    {
+        ShaderProgram* program = compute ? _geometryPrepareComputeProgram : _shaderPrograms[RS_GEOMETRY_PREPARE];
+
+        // Использовать шейдер (в пределах кадра программа подготовки может меняться между вызовами)
+        glUseProgram(program->getId());
+
+        // Привязываемся ко фрейм-буфферу (временно используем основной)
+        if(!compute) glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Сброс счетчика треугольников и запись границ текущего меша
+        const Mesh* boundsMesh = pMesh;
+        ResetMeshCounters(meshIndex, 1);
+        WriteMeshBounds(&boundsMesh, 1, meshIndex);
+
+        // Передача матриц в шейдер
+        glUniformMatrix4fv(program->getUniformLocations()->view, 1, GL_FALSE, glm::value_ptr(_camera->getViewMatrix()));
+        glUniformMatrix4fv(program->getUniformLocations()->model,1, GL_FALSE, glm::value_ptr(pMesh->getModelMatrix()));
+
+        // Передача информации о материале в шейдер
+        glUniform3fv(program->getUniformLocations()->materialAlbedo, 1, glm::value_ptr(pMesh->material.albedo));
+        glUniform1f(program->getUniformLocations()->materialMetallic, pMesh->material.metallic);
+        glUniform1f(program->getUniformLocations()->materialRoughness, pMesh->material.roughness);
+        glUniform1f(program->getUniformLocations()->materialPrimaryToSecondaryRatio, pMesh->material.primaryToSecondary);
+        glUniform1f(program->getUniformLocations()->materialReflectToRefractRatio, pMesh->material.reflectionToRefraction);
+        glUniform1f(program->getUniformLocations()->materialRefractionCoff, pMesh->material.refractionCoff);
+
+        // Передача информации об индексе текущего меша в шейдер
+        glUniform1ui(program->getUniformLocations()->meshIndex, meshIndex);
+
+        if(compute)
+        {
+            // Матрица нормалей вычисляется один раз на меш (а не для каждой вершины)
+            const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(pMesh->getModelMatrix())));
+            glUniformMatrix3fv(program->getUniformLocations()->normalMatrix, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+            glUniform1ui(program->getUniformLocations()->indexCount, pMesh->geometry->getIndexCount());
+            glUniform1ui(program->getUniformLocations()->instanceCount, 0);
+
+            // Вершины и индексы геометрии читаются шейдером напрямую
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, pMesh->geometry->getVboId());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, pMesh->geometry->getEboId());
+
+            // По одному потоку на треугольник
+            const GLuint triangles = pMesh->geometry->getIndexCount() / 3;
+            DispatchComputeGroups((triangles + GEOMETRY_PREPARE_GROUP_SIZE - 1) / GEOMETRY_PREPARE_GROUP_SIZE);
+        }
+        else
+        {
+            // Привязать геометрию и нарисовать ее
+            glBindVertexArray(pMesh->geometry->getVaoId());
+            glDrawElements(GL_TRIANGLES, pMesh->geometry->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+            glBindVertexArray(0);
+
+            // Ожидаем завершения работы с вершинами
+            glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        }
+    }
+
+    /**
+     * Повторная подготовка мешей сохраняемой сцены, изменившихся с момента последней подготовки
+     * @details Каждый меш записывается в свой постоянный участок буфера треугольников, остальные участки не изменяются
+     */
+    static void PrepareRetainedScene()
+    {
+        std::vector<const RetainedScene::Slot*> dirty;
+        _retainedScene->collectDirty(dirty);
+        if(dirty.empty()) return;
+
+        // Вычислительный шейдер - все изменившиеся меши готовятся одним вызовом (сдвиги записи заданы для каждого меша)
+        if(_geometryPrepareMode == GP_COMPUTE_SHADER)
+        {
+            std::vector<const Mesh*> meshes(dirty.size());
+            std::vector<GLuint> meshIndices(dirty.size());
+            std::vector<GLuint> outputOffsets(dirty.size());
+
+            for(size_t i = 0; i < dirty.size(); i++){
+                meshes[i] = dirty[i]->mesh;
+                meshIndices[i] = dirty[i]->meshIndex;
+                outputOffsets[i] = dirty[i]->firstTriangle;
+                ResetMeshCounters(dirty[i]->meshIndex, 1);
+                WriteMeshBounds(&meshes[i], 1, dirty[i]->meshIndex);
+            }
+
+            _blasPool->upload();
+            const GLuint groups = _meshInstanceBuffer->update(meshes.data(), meshes.size(), *_blasPool, GEOMETRY_PREPARE_GROUP_SIZE,
+                    0, meshIndices.data(), outputOffsets.data());
+
+            glUseProgram(_geometryPrepareComputeProgram->getId());
+            glUniform1ui(_geometryPrepareComputeProgram->getUniformLocations()->instanceCount, static_cast<GLuint>(dirty.size()));
+            DispatchComputeGroups(groups);
+        }
+        // Геометрический шейдер - перед подготовкой каждого меша общий счетчик устанавливается на начало его участка
+        else
+        {
+            for(const RetainedScene::Slot* slot : dirty)
+            {
+                glMemoryBarrier(GL_ATOMIC_COUNTER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterGlobalBuffer);
+                glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &slot->firstTriangle);
+                glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+                PrepareMesh(slot->mesh, slot->meshIndex, false);
+            }
+
+            glMemoryBarrier(GL_ATOMIC_COUNTER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        }
+    }
+
+    /**
+     * Начало этапа подготовки геометрии (один раз за кадр, перед подготовкой первого меша)
+     * @details Подготавливаются изменившиеся меши сохраняемой сцены, после чего общий счетчик треугольников
+     * устанавливается на границу ее участков (меши текущего кадра записываются после нее)
+     */
+    static void BeginGeometryPrepare()
+    {
+        // Сменить идентификатор последного прохода
+        _lastRenderingStage = RS_GEOMETRY_PREPARE;
+
+        // Начало замера времени подготовки геометрии (завершается при отрисовке сцены)
+        if(!_geometryPrepareTimeQueryActive){
+            glBeginQuery(GL_TIME_ELAPSED, _geometryPrepareTimeQuery);
+            _geometryPrepareTimeQueryActive = true;
+        }
+
+        // Подготовка изменившихся мешей сохраняемой сцены
+        PrepareRetainedScene();
+
+        // Сброс общего атомарного счетчика треугольников (до границы участков сохраняемой сцены)
+        const GLuint highWater = _retainedScene->getTriangleHighWater();
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterGlobalBuffer);
+        glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &highWater);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+    }
+
+    /**
+     * Матрица проекции буфера видимости (без дальней плоскости - первичный луч не ограничен по расстоянию)
+     * @return Матрица проекции
+     */
+    static glm::mat4 VisibilityProjection()
+    {
+        return glm::infinitePerspective(glm::radians(_camera->getFov()), _camera->getAspectRatio(), VISIBILITY_NEAR_PLANE);
+    }
+
+    /**
+     * Растеризация буфера видимости первичных лучей - экземпляры TLAS рисуются с точки зрения камеры, для каждого пикселя
+     * записывается ближайший треугольник BLAS, барицентрические координаты и расстояние (как у пересечения первичного луча)
+     * @details Треугольники растеризуются с обеих сторон - обход структуры ускорения также не отсекает задние грани
+     */
+    static void RasterizePrimaryVisibility()
+    {
+        const auto locations = _visibilityProgram->getUniformLocations();
+
+        // Замер времени растеризации (результат читается при запросе статистики)
+        glBeginQuery(GL_TIME_ELAPSED, _primaryVisibilityTimeQuery);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, _visibilityFrameBuffer->getId());
+        glUseProgram(_visibilityProgram->getId());
+        glScissor(0, 0, _screenWidth, _screenHeight);
+        glViewport(0, 0, _screenWidth, _screenHeight);
+
+        // Нулевой экземпляр означает промах первичного луча
+        const GLuint emptyVisibility[4] = {0, 0, 0, 0};
+        const GLfloat farDepth = 1.0f;
+        glClearBufferuiv(GL_COLOR, 0, emptyVisibility);
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+
+        const glm::mat4 projection = VisibilityProjection();
+        glUniformMatrix4fv(locations->projection, 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(locations->view, 1, GL_FALSE, glm::value_ptr(_camera->getViewMatrix()));
+        // Начало первичных лучей - точка начала координат пространства камеры
+        const glm::vec3 rayOrigin = glm::vec3(_camera->getModelMatrix()[3]);
+        glUniform3fv(locations->camPosition, 1, glm::value_ptr(rayOrigin));
+
+        // Индекс меша в массиве - индекс экземпляра в буфере экземпляров (растеризуется геометрия первичных лучей экземпляра)
+        const std::vector<const Mesh*>& meshes = _tlasBuilder->getInstanceMeshes();
+        const std::vector<const GeometryBuffer*>& geometries = _tlasBuilder->getInstanceGeometries();
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            const BlasPool::Entry* blas = _blasPool->find(geometries[i]);
+
+            glUniformMatrix4fv(locations->model, 1, GL_FALSE, glm::value_ptr(meshes[i]->getModelMatrix()));
+            glUniform1ui(locations->visibilityInstance, static_cast<GLuint>(i));
+            glUniform1ui(locations->visibilityTriangleOffset, blas->triangleOffset);
+
+            glBindVertexArray(geometries[i]->getVaoId());
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(geometries[i]->getIndexCount()), GL_UNSIGNED_INT, nullptr);
+        }
+        glBindVertexArray(0);
+
+        glEnable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glEndQuery(GL_TIME_ELAPSED);
+        _primaryVisibilityTimeQueryPending = true;
+
+        // Программа и кадровый буфер сменились
+        _lastRenderingStage = RS_NONE;
+    }
+
+    /**
+     * Матрица модели камеры грани кубической карты (взгляд вдоль -Z матрицы модели)
+     * @param face Индекс грани (в порядке GL_TEXTURE_CUBE_MAP_POSITIVE_X ... NEGATIVE_Z)
+     * @param position Центр кубической карты
+     * @return Матрица модели
+     */
+    static glm::mat4 CubeFaceModelMatrix(GLuint face, const glm::vec3& position)
+    {
+        // Направления вправо, вверх и взгляда каждой грани (по соглашению кубических текстур OpenGL: +X, -X, +Y, -Y, +Z, -Z)
+        static const glm::vec3 faceAxes[6][3] = {
+                {{0.0f, 0.0f,-1.0f}, {0.0f,-1.0f, 0.0f}, { 1.0f, 0.0f, 0.0f}},
+                {{0.0f, 0.0f, 1.0f}, {0.0f,-1.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}},
+                {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, { 0.0f, 1.0f, 0.0f}},
+                {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f,-1.0f}, { 0.0f,-1.0f, 0.0f}},
+                {{1.0f, 0.0f, 0.0f}, {0.0f,-1.0f, 0.0f}, { 0.0f, 0.0f, 1.0f}},
+                {{-1.0f,0.0f, 0.0f}, {0.0f,-1.0f, 0.0f}, { 0.0f, 0.0f,-1.0f}}};
+
+        glm::mat4 faceModel(1.0f);
+        faceModel[0] = glm::vec4(faceAxes[face][0], 0.0f);
+        faceModel[1] = glm::vec4(faceAxes[face][1], 0.0f);
+        faceModel[2] = glm::vec4(-faceAxes[face][2], 0.0f);
+        faceModel[3] = glm::vec4(position, 1.0f);
+        return faceModel;
+    }
+
+    /**
+     * Растеризация кубических карт теней первых источников света кадра - экземпляры TLAS рисуются из положения источника
+     * в каждую грань, для каждого направления записывается расстояние до ближайшей поверхности
+     * @details Рисуется геометрия, которую обходят теневые лучи (упрощенная, если она задана мешу), с обеих сторон
+     */
+    static void RenderShadowMaps()
+    {
+        _frameShadowMapCount = std::min(_lightSourceCount, MAX_SHADOW_MAPS);
+        if(_frameShadowMapCount == 0) return;
+
+        const auto locations = _shadowMapProgram->getUniformLocations();
+        const auto faceSize = static_cast<GLsizei>(_shadowMaps->getFaceSize());
+
+        glUseProgram(_shadowMapProgram->getId());
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glScissor(0, 0, faceSize, faceSize);
+        glViewport(0, 0, faceSize, faceSize);
+
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+
+        // Грань - перспектива с углом обзора 90 градусов (дальней плоскости нет - как и у теневого луча)
+        const glm::mat4 projection = glm::infinitePerspective(glm::radians(90.0f), 1.0f, SHADOW_MAP_NEAR_PLANE);
+        glUniformMatrix4fv(locations->projection, 1, GL_FALSE, glm::value_ptr(projection));
+
+        // Направление без поверхностей - поверхность бесконечно далеко
+        const GLfloat emptyDistance[4] = {std::numeric_limits<GLfloat>::max(), 0.0f, 0.0f, 0.0f};
+        const GLfloat farDepth = 1.0f;
+
+        const std::vector<const Mesh*>& meshes = _tlasBuilder->getInstanceMeshes();
+        for(GLuint slot = 0; slot < _frameShadowMapCount; slot++)
+        {
+            glUniform3fv(locations->lightPosition, 1, glm::value_ptr(_frameLightPositions[slot]));
+
+            for(GLuint face = 0; face < 6; face++)
+            {
+                _shadowMaps->bindFace(slot, face);
+                glClearBufferfv(GL_COLOR, 0, emptyDistance);
+                glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+                const glm::mat4 view = glm::inverse(CubeFaceModelMatrix(face, _frameLightPositions[slot]));
+                glUniformMatrix4fv(locations->view, 1, GL_FALSE, glm::value_ptr(view));
+
+                for(const Mesh* mesh : meshes)
+                {
+                    // Упрощенная геометрия используется теневыми лучами, только если ее BLAS построена
+                    const GeometryBuffer* geometry = mesh->proxy != nullptr && _blasPool->find(mesh->proxy) != nullptr ? mesh->proxy : mesh->geometry;
+
+                    glUniformMatrix4fv(locations->model, 1, GL_FALSE, glm::value_ptr(mesh->getModelMatrix()));
+                    glBindVertexArray(geometry->getVaoId());
+                    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(geometry->getIndexCount()), GL_UNSIGNED_INT, nullptr);
+                }
+            }
+        }
+        glBindVertexArray(0);
+
+        glEnable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Программа, кадровый буфер и область отрисовки сменились
+        _lastRenderingStage = RS_NONE;
+    }
+
+    /**
+     * Передача программе трассировки параметров отражений в экранном пространстве
+     * @param program Программа трассировки
+     */
+    static void SetScreenSpaceReflectionUniforms(ShaderProgram* program)
+    {
+        auto locations = program->getUniformLocations();
+        const glm::mat4 viewProjection = VisibilityProjection() * _camera->getViewMatrix();
+
+        glUniform1i(locations->screenSpaceReflections, _frameScreenSpaceReflections);
+        glUniformMatrix4fv(locations->viewProjection, 1, GL_FALSE, glm::value_ptr(viewProjection));
+        glUniformMatrix4fv(locations->reflectionHistoryViewProjection, 1, GL_FALSE, glm::value_ptr(_reflectionHistoryViewProjection));
+        glUniform1ui(locations->reflectionMaxSteps, _reflectionMaxSteps);
+        glUniform1f(locations->reflectionThickness, _reflectionThickness);
+    }
+
+    /**
+     * Передача программе трассировки зондов отражений кадра (только зонды, все грани которых уже отрисованы)
+     * @param program Программа трассировки
+     */
+    static void SetReflectionProbeUniforms(ShaderProgram* program)
+    {
+        auto locations = program->getUniformLocations();
+
+        // Положение и радиус влияния каждого зонда, индекс его кубической карты в массиве
+        glm::vec4 probes[MAX_REFLECTION_PROBES];
+        GLuint layers[MAX_REFLECTION_PROBES];
+        GLuint count = 0;
+        for(GLuint i = 0; i < _frameReflectionProbeCount; i++)
+        {
+            const GLuint slot = _reflectionProbePool->acquire(_frameReflectionProbes[i]);
+            if(!_reflectionProbePool->isComplete(slot)) continue;
+
+            probes[count] = glm::vec4(_frameReflectionProbes[i]->getPosition(), _frameReflectionProbes[i]->radius);
+            layers[count++] = slot;
+        }
+
+        glUniform1ui(locations->reflectionProbeCount, count);
+        if(count > 0){
+            glUniform4fv(locations->reflectionProbes, static_cast<GLsizei>(count), glm::value_ptr(probes[0]));
+            glUniform1uiv(locations->reflectionProbeLayers, static_cast<GLsizei>(count), layers);
+        }
+        glUniform1f(locations->reflectionProbeRoughness, _reflectionProbeRoughness);
+        glUniform1ui(locations->reflectionProbeBounceDepth, _reflectionProbeBounceDepth);
+    }
+
+    /**
+     * Передача программе трассировки карт теней кадра (0 карт - все источники затеняются теневыми лучами)
+     * @param program Программа трассировки
+     */
+    static void SetShadowMapUniforms(ShaderProgram* program)
+    {
+        auto locations = program->getUniformLocations();
+
+        // Угловой размер текселя в центре грани (наибольший на грани) - точность положения найденных картой поверхностей
+        const GLfloat texelAngle = 2.0f / static_cast<GLfloat>(SHADOW_MAP_FACE_SIZE);
+
+        glUniform1ui(locations->shadowMapCount, _frameShadowMapCount);
+        glUniform1f(locations->shadowMapTexelAngle, texelAngle);
+    }
+
+    /**
+     * Сохранение итогового изображения кадра для отражений в экранном пространстве следующего кадра
+     * @details Изображение копируется из основного кадрового буфера, куда его выводят все способы трассировки
+     */
+    static void StoreReflectionHistory()
+    {
+        glScissor(0, 0, _screenWidth, _screenHeight);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _reflectionHistoryFrameBuffer->getId());
+        glBlitFramebuffer(0, 0, _screenWidth, _screenHeight, 0, 0, _screenWidth, _screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        _reflectionHistoryViewProjection = VisibilityProjection() * _camera->getViewMatrix();
+        _reflectionHistoryValid = true;
+        _lastRenderingStage = RS_NONE;
+    }
+
+    /**
+     * Трассировка фрагментным шейдером со вторичными лучами в пониженном разрешении (программа трассировки установлена)
+     * @details Первичные лучи трассируются в полном разрешении, вторичные - в пониженном (первичное пересечение
+     * находится повторно, его поверхность нужна для повышения разрешения). Программа пост-процессинга складывает оба
+     * изображения в основном кадровом буфере
+     */
+    static void TraceReducedSecondaryRays()
+    {
+        const auto locations = _shaderPrograms[RS_RAY_TRACING]->getUniformLocations();
+        const GLsizei secondaryWidth = _secondaryFrameBuffer->getWidth();
+        const GLsizei secondaryHeight = _secondaryFrameBuffer->getHeight();
+
+        glBindVertexArray(_geometryQuad->getVaoId());
+
+        // Первичные лучи (цвет пересечений, включая отражения из зондов и экранного пространства)
+        glBindFramebuffer(GL_FRAMEBUFFER, _primaryFrameBuffer->getId());
+        glUniform1ui(locations->tracePass, TP_PRIMARY);
+        glDrawElements(GL_TRIANGLES, _geometryQuad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+
+        // Вторичные лучи (буфер видимости соответствует полному разрешению - первичные лучи трассируются)
+        glBindFramebuffer(GL_FRAMEBUFFER, _secondaryFrameBuffer->getId());
+        glScissor(0, 0, secondaryWidth, secondaryHeight);
+        glViewport(0, 0, secondaryWidth, secondaryHeight);
+        glUniform1ui(locations->tracePass, TP_SECONDARY);
+        glUniform1i(locations->primaryVisibility, GL_FALSE);
+        glDrawElements(GL_TRIANGLES, _geometryQuad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+
+        // Повышение разрешения вторичных лучей и сложение с первичными в основном кадровом буфере
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glScissor(0, 0, _screenWidth, _screenHeight);
+        glViewport(0, 0, _screenWidth, _screenHeight);
+        glUseProgram(_shaderPrograms[RS_POST_PROCESS]->getId());
+        glDrawElements(GL_TRIANGLES, _geometryQuad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+
+        glBindVertexArray(0);
+        _lastRenderingStage = RS_POST_PROCESS;
+    }
+
+    /**
+     * Начало трассировки вычислительным шейдером - установка программы, параметров камеры и изображения кадра
+     */
+    static void BeginComputeTracing()
+    {
+        const auto locations = _rayTracingComputeProgram->getUniformLocations();
+
+        // Использовать шейдер
+        glUseProgram(_rayTracingComputeProgram->getId());
+
+        // Параметры камеры, глубина трассировки и разрешение кадра
+        glUniform1f(locations->fov, _camera->getFov());
+        glUniform1f(locations->aspectRatio, _camera->getAspectRatio());
+        glUniformMatrix4fv(locations->camModelMat, 1, GL_FALSE, glm::value_ptr(_camera->getModelMatrix()));
+        glUniform1i(locations->subgroupTraversal, _subgroupTraversal);
+        glUniform1ui(locations->intersectionKernel, _intersectionKernel);
+        glUniform1f(locations->rayWeightThreshold, _rayWeightThreshold);
+        glUniform1i(locations->primaryVisibility, _framePrimaryVisibility);
+        SetScreenSpaceReflectionUniforms(_rayTracingComputeProgram);
+        SetReflectionProbeUniforms(_rayTracingComputeProgram);
+        SetShadowMapUniforms(_rayTracingComputeProgram);
+        glUniform2ui(locations->screenSize, static_cast<GLuint>(_screenWidth), static_cast<GLuint>(_screenHeight));
+        glUniform1ui(locations->maxGroupCountX, _maxComputeGroupCount[0]);
+
+        // Цвет записывается в текстуру кадрового буфера экрана
+        glBindImageTexture(0, _screenFrameBuffer->getTextureAttachments()[0], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    }
+
+    /**
+     * Вывод изображения, записанного вычислительным шейдером, в основной кадровый буфер
+     */
+    static void PresentComputeTracing()
+    {
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+        glScissor(0, 0, _screenWidth, _screenHeight);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, _screenFrameBuffer->getId());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, _screenWidth, _screenHeight, 0, 0, _screenWidth, _screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    /**
+     * Волновая трассировка - генерация первичных лучей, затем поиск пересечений и освещение для каждого отскока
+     * @details Кол-во лучей отскока известно только на GPU, поэтому вызовы косвенные (аргументы записываются при сжатии
+     * очереди). Лучи, не нашедшие пересечения или исчерпавшие вклад, в следующую очередь не попадают
+     */
+    static void TraceWavefront()
+    {
+        const auto locations = _rayTracingComputeProgram->getUniformLocations();
+        const GLbitfield barriers = GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_COMMAND_BARRIER_BIT;
+
+        BeginComputeTracing();
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _wavefrontStateBuffer);
+
+        // Сброс счетчика лучей кадра
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _wavefrontStateBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, sizeof(GLuint) * 6, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &INITIAL_ZERO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        // Метки времени для каждого отскока вторичных лучей
+        const GLuint secondaryBounces = _rayDepth - 1;
+        if(_secondaryRayTimestampQueries.size() < secondaryBounces * 3){
+            const size_t existing = _secondaryRayTimestampQueries.size();
+            _secondaryRayTimestampQueries.resize(secondaryBounces * 3);
+            glGenQueries(static_cast<GLsizei>(_secondaryRayTimestampQueries.size() - existing), _secondaryRayTimestampQueries.data() + existing);
+        }
+
+        // Сжатие - выходная очередь становится входной, вычисляются аргументы вызова для следующего отскока
+        auto compactQueue = [&]()
+        {
+            glUniform1ui(locations->wavefrontStage, WF_STAGE_COMPACT);
+            glDispatchCompute(1, 1, 1);
+            glMemoryBarrier(barriers);
+
+            std::swap(_rayQueueBuffers[0], _rayQueueBuffers[1]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 21, _rayQueueBuffers[0]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 22, _rayQueueBuffers[1]);
+        };
+
+        // Первичные лучи (по одному на пиксель)
+        const GLuint pixels = static_cast<GLuint>(_screenWidth) * static_cast<GLuint>(_screenHeight);
+        glUniform1ui(locations->rayBounce, 0);
+        glUniform1ui(locations->wavefrontStage, WF_STAGE_GENERATE);
+        DispatchComputeGroups((pixels + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE);
+        glMemoryBarrier(barriers);
+        compactQueue();
+
+        // Сортировка лучей входной очереди - по октанту направления и коду Мортона начала
+        auto sortQueue = [&]()
+        {
+            // Ключи записываются в первую половину буфера пар
+            GLuint sortInput = 0;
+            glUniform1ui(locations->raySortInput, sortInput);
+
+            glUniform1ui(locations->wavefrontStage, WF_STAGE_SORT_KEYS);
+            glDispatchComputeIndirect(0);
+            glMemoryBarrier(barriers);
+
+            // Поразрядная сортировка ключей (по BVH_RADIX_BITS бит за проход)
+            for(GLuint shift = 0; shift < RAY_SORT_KEY_BITS; shift += BVH_RADIX_BITS)
+            {
+                glUniform1ui(locations->radixShift, shift);
+
+                glUniform1ui(locations->wavefrontStage, WF_STAGE_SORT_COUNT);
+                glDispatchComputeIndirect(0);
+                glMemoryBarrier(barriers);
+
+                glUniform1ui(locations->wavefrontStage, WF_STAGE_SORT_SCAN);
+                glDispatchCompute(1, 1, 1);
+                glMemoryBarrier(barriers);
+
+                glUniform1ui(locations->wavefrontStage, WF_STAGE_SORT_SCATTER);
+                glDispatchComputeIndirect(0);
+                glMemoryBarrier(barriers);
+
+                // Выход прохода становится входом следующего
+                sortInput = 1 - sortInput;
+                glUniform1ui(locations->raySortInput, sortInput);
+            }
+
+            // Лучи переставляются в выходную очередь, которая становится входной (счетчики не меняются)
+            glUniform1ui(locations->wavefrontStage, WF_STAGE_SORT_GATHER);
+            glDispatchComputeIndirect(0);
+            glMemoryBarrier(barriers);
+
+            std::swap(_rayQueueBuffers[0], _rayQueueBuffers[1]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 21, _rayQueueBuffers[0]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 22, _rayQueueBuffers[1]);
+        };
+
+        // Отскоки (на последнем лучи следующего отскока не добавляются)
+        for(GLuint bounce = 0; bounce < _rayDepth; bounce++)
+        {
+            glUniform1ui(locations->rayBounce, bounce);
+
+            // Вторичные лучи (сортировка и трассировка измеряются отдельно)
+            if(bounce > 0){
+                const GLuint* timestamps = &_secondaryRayTimestampQueries[(bounce - 1) * 3];
+                glQueryCounter(timestamps[0], GL_TIMESTAMP);
+                if(_secondaryRaySorting) sortQueue();
+                glQueryCounter(timestamps[1], GL_TIMESTAMP);
+            }
+
+            glUniform1ui(locations->wavefrontStage, WF_STAGE_INTERSECT);
+            glDispatchComputeIndirect(0);
+            glMemoryBarrier(barriers);
+
+            glUniform1ui(locations->wavefrontStage, WF_STAGE_SHADE);
+            glDispatchComputeIndirect(0);
+            glMemoryBarrier(barriers);
+
+            if(bounce > 0) glQueryCounter(_secondaryRayTimestampQueries[(bounce - 1) * 3 + 2], GL_TIMESTAMP);
+
+            compactQueue();
+        }
+
+        _secondaryRayBounces = secondaryBounces;
+        _secondaryRayStatisticsPending = true;
+
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+        // Вывод накопленного изображения в основной кадровый буфер
+        PresentComputeTracing();
+    }
+
+    /**
+     * Трассировка постоянными потоками - запускается фиксированное кол-во групп, группы получают порции пикселей
+     * из общего атомарного счетчика, пока пиксели кадра не закончатся
+     */
+    static void TracePersistentThreads()
+    {
+        const auto locations = _rayTracingComputeProgram->getUniformLocations();
+
+        BeginComputeTracing();
+
+        // Сброс счетчика работы (последнее значение в буфере состояния)
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _wavefrontStateBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, sizeof(GLuint) * 5, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &INITIAL_ZERO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        // Порция группы - по batchSize пикселей на поток, но не больше кадра (счетчик работы не должен переполняться)
+        const GLuint pixels = static_cast<GLuint>(_screenWidth) * static_cast<GLuint>(_screenHeight);
+        const GLuint batchSize = std::min(_persistentBatchSize, (pixels + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE);
+        const GLuint batchPixels = batchSize * WAVEFRONT_GROUP_SIZE;
+
+        // Групп не больше, чем порций пикселей, и не больше предельного кол-ва групп устройства
+        const GLuint groups = std::min({_persistentGroupCount > 0 ? _persistentGroupCount : _deviceGroupCount,
+                                        (pixels + batchPixels - 1) / batchPixels,
+                                        _maxComputeGroupCount[0]});
+
+        glUniform1ui(locations->batchSize, batchSize);
+        glUniform1ui(locations->wavefrontStage, WF_STAGE_PERSISTENT);
+        glDispatchCompute(groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        PresentComputeTracing();
+    }
+
+    /// С О Х Р А Н Я Е М А Я   С Ц Е Н А
+
+    /**
+     * Преломляет ли материал меша или примитива свет (преломленный луч выпускается шейдером только для таких материалов)
+     * @tparam T Тип элемента сцены (Mesh или Primitive)
+     * @param element Меш или примитив
+     * @return Да или нет
+     */
+    template <typename T>
+    static bool MaterialRefracts(const T* element)
+    {
+        return element->material.primaryToSecondary < 1.0f &&
+               element->material.reflectionToRefraction < 1.0f &&
+               element->material.refractionCoff > 0.0f;
+    }
+
+    /**
+     * Параметры специализации программ трассировки для текущего кадра
+     * @return Ключ специализации
+     */
+    static ShaderPermutations::Key RayTracingPermutationKey()
+    {
+        ShaderPermutations::Key key;
+        key.rayDepth = _rayDepth;
+        key.lightTypes = _frameLightTypes;
+        key.shadows = _shadows && _frameLightTypes != 0;
+        key.refraction = _frameRefraction;
+
+        // Материалы мешей сохраняемой сцены могут измениться в любой момент - проверяются каждый кадр
+        for(const RetainedScene::Slot& slot : _retainedScene->getSlots()){
+            if(key.refraction) break;
+            key.refraction = MaterialRefracts(slot.mesh);
+        }
+
+        return key;
+    }
+
+    /**
+     * Обновление кубических карт зондов отражений кадра - за кадр отрисовывается заданное кол-во граней (зонды по очереди,
+     * все грани одного зонда подряд), грань трассируется фрагментным шейдером из точки зонда с углом обзора 90 градусов
+     * @details При отрисовке граней зонды не читаются (карта не может читать саму себя), буфер видимости и отражения
+     * в экранном пространстве отключены (они относятся к камере). Фрагментный шейдер используется при любом способе трассировки
+     */
+    static void UpdateReflectionProbes()
+    {
+        _frameStatistics.reflectionProbeFaceCount = 0;
+        if(_frameReflectionProbeCount == 0 || _reflectionProbeFacesPerFrame == 0) return;
+
+        ShaderProgram* program = _rayTracingPermutations->get(RayTracingPermutationKey());
+        const auto locations = program->getUniformLocations();
+        const auto faceSize = static_cast<GLsizei>(_reflectionProbePool->getFaceSize());
+
+        glUseProgram(program->getId());
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glScissor(0, 0, faceSize, faceSize);
+        glViewport(0, 0, faceSize, faceSize);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+        glUniform1f(locations->fov, 90.0f);
+        glUniform1f(locations->aspectRatio, 1.0f);
+        glUniform1i(locations->subgroupTraversal, _subgroupTraversal);
+        glUniform1ui(locations->intersectionKernel, _intersectionKernel);
+        glUniform1f(locations->rayWeightThreshold, _rayWeightThreshold);
+        glUniform1i(locations->primaryVisibility, GL_FALSE);
+        glUniform1i(locations->screenSpaceReflections, GL_FALSE);
+        glUniform1ui(locations->reflectionProbeCount, 0);
+        glUniform1ui(locations->tracePass, TP_FULL);
+        SetShadowMapUniforms(program);
+
+        glBindVertexArray(_geometryQuad->getVaoId());
+        for(GLuint i = 0; i < _reflectionProbeFacesPerFrame; i++)
+        {
+            ReflectionProbe* probe = _frameReflectionProbes[_reflectionProbeCursor % _frameReflectionProbeCount];
+            const GLuint face = _reflectionProbePool->bindNextFace(_reflectionProbePool->acquire(probe));
+
+            // После последней грани обновляется следующий зонд
+            if(face == 5) _reflectionProbeCursor++;
+
+            // Камера грани
+            const glm::mat4 faceModel = CubeFaceModelMatrix(face, probe->getPosition());
+            glUniform3fv(locations->camPosition, 1, glm::value_ptr(probe->getPosition()));
+            glUniformMatrix4fv(locations->camModelMat, 1, GL_FALSE, glm::value_ptr(faceModel));
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDrawElements(GL_TRIANGLES, _geometryQuad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+            _frameStatistics.reflectionProbeFaceCount++;
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Размытые уровни карт (выбираются по шероховатости)
+        _reflectionProbePool->updateLevels();
+
+        // Программа, кадровый буфер и область отрисовки сменились
+        _lastRenderingStage = RS_NONE;
+    }
+
+    /**
+     * Выбор специализаций программ трассировки по параметрам кадра (глубина трассировки, типы источников света, преломление, тени)
+     * @details Специализация собирается при первом использовании ее параметров, в дальнейшем берется из набора
+     */
+    static void SelectRayTracingPrograms()
+    {
+        const ShaderPermutations::Key key = RayTracingPermutationKey();
+
+        // Собирается только специализация используемого способа трассировки
+        if(_rayTracingMode != RT_FRAGMENT_SHADER){
+            _rayTracingComputeProgram = _rayTracingComputePermutations->get(key);
+            return;
+        }
+
+        // Программа сменилась - ее нужно установить заново
+        ShaderProgram* program = _rayTracingPermutations->get(key);
+        if(program != _shaderPrograms[RS_RAY_TRACING]){
+            _shaderPrograms[RS_RAY_TRACING] = program;
+            if(_lastRenderingStage == RS_RAY_TRACING) _lastRenderingStage = RS_NONE;
+        }
+    }
+
+    /**
+     * Добавление меша на сохраняемую сцену
+     * @param mesh Хендл меша
+     * @return Состояние операции
+     */
+    bool __cdecl AddMeshToScene(HMesh mesh)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(_meshesCount > 0) throw std::runtime_error("Retained scene can't be changed while scene is being set");
+
+            // Слот и участок буфера треугольников (меш будет подготовлен в начале следующего кадра)
+            _retainedScene->add(reinterpret_cast<Mesh*>(mesh));
+            ReserveTriangleCapacity(_retainedScene->getTriangleHighWater());
+            ReserveMeshCapacity(_retainedScene->getMeshHighWater());
+            UpdateTotalMeshes();
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Удаление меша с сохраняемой сцены (участок буфера треугольников освобождается для других мешей)
+     * @param mesh Хендл меша
+     * @return Состояние операции
+     */
+    bool __cdecl RemoveMeshFromScene(HMesh mesh)
+    {
+        try
+        {
+            if(!_bInitialized) throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(_meshesCount > 0) throw std::runtime_error("Retained scene can't be changed while scene is being set");
+
+            const RetainedScene::Slot slot = _retainedScene->remove(reinterpret_cast<Mesh*>(mesh));
+
+            // Освобожденный участок заполняется пустыми треугольниками (бесконечности), которые не входят в BVH
+            const GLfloat empty = std::numeric_limits<GLfloat>::infinity();
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, _trianglePositionBuffer);
+            glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32F, TRIANGLE_POSITIONS_SIZE * static_cast<GLintptr>(slot.firstTriangle),
+                    TRIANGLE_POSITIONS_SIZE * static_cast<GLsizeiptr>(slot.triangleCount), GL_RED, GL_FLOAT, &empty);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+            // Границы освобожденного индекса меша не должны влиять на границы сцены
+            const Mesh* none = nullptr;
+            ResetMeshCounters(slot.meshIndex, 1);
+            WriteMeshBounds(&none, 1, slot.meshIndex);
+            UpdateTotalMeshes();
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /// Р Е Н Д Е Р И Н Г
+
+    /**
+     * Добавление источника света на сцену (UBO-буфер источников света)
+     * @param lightSource Хендл источника
+     * @return Состояние операции
+     */
+    bool __cdecl SetLightSource(HLightSource lightSource)
+    {
+        try
+        {
+            // Указатель на источник света
+            auto pLightSource = reinterpret_cast<LightSource*>(lightSource);
+
+            // Проверка на готовность к операции
+            if(!_bInitialized)
+                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            if(pLightSource == nullptr)
+                throw std::runtime_error("No light source provided");
+
+            // Увеличить буфер источников при необходимости
+            ReserveLightCapacity(_lightSourceCount + 1);
+
+            // Запись источника в буфер
+            pLightSource->writeToUniformBufferStd140(_lightSourcesBuffer,_lightSourceCount * LIGHT_SOURCE_SIZE);
+
+            // Положение запоминается для карты теней (карты есть только у первых источников кадра)
+            if(_lightSourceCount < MAX_SHADOW_MAPS) _frameLightPositions[_lightSourceCount] = pLightSource->getPosition();
+
+            // Увеличение кол-ва источников света (тип учитывается при выборе специализации программы трассировки)
+            _lightSourceCount++;
+            _frameLightTypes |= 1u << static_cast<GLuint>(pLightSource->type);
+
+            // Обновить количество источников света в uniform-буфере
+            glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, 4, &_lightSourceCount);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Добавление аналитического примитива на сцену текущего кадра
+     * @details Примитив не разбивается на треугольники - луч пересекается с его канонической формой напрямую
+     * (для примитивов строится отдельная BVH на стороне CPU, используется при любой структуре ускорения)
+     * @param primitive Хендл примитива
+     * @return Состояние операции
+     */
+    bool __cdecl SetPrimitive(HPrimitive primitive)
+    {
+        try
+        {
+            // Указатель на примитив
+            auto pPrimitive = reinterpret_cast<Primitive*>(primitive);
+
+            // Проверка на готовность к операции
+            if(!_bInitialized)
+                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            if(pPrimitive == nullptr)
+                throw std::runtime_error("No primitive provided");
+
+            // Материал учитывается при выборе специализации программы трассировки
+            if(MaterialRefracts(pPrimitive)) _frameRefraction = true;
+            _primitiveBvhBuilder->addPrimitive(pPrimitive);
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Добавление зонда отражений на сцену текущего кадра
+     * @details Кубическая карта зонда сохраняется между кадрами (до уничтожения зонда) и обновляется по несколько граней
+     * за кадр, отражения берутся только из зондов, все грани которых уже отрисованы
+     * @param reflectionProbe Хендл зонда
+     * @return Состояние операции
+     */
+    bool __cdecl SetReflectionProbe(HReflectionProbe reflectionProbe)
+    {
+        try
+        {
+            // Указатель на зонд
+            auto pReflectionProbe = reinterpret_cast<ReflectionProbe*>(reflectionProbe);
+
+            // Проверка на готовность к операции
+            if(!_bInitialized)
+                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            if(pReflectionProbe == nullptr)
+                throw std::runtime_error("No reflection probe provided");
+
+            if(_frameReflectionProbeCount >= MAX_REFLECTION_PROBES)
+                throw std::runtime_error("Too many reflection probes in frame");
+
+            // Слот кубической карты выделяется при первом добавлении зонда
+            _reflectionProbePool->acquire(pReflectionProbe);
+            _frameReflectionProbes[_frameReflectionProbeCount++] = pReflectionProbe;
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Добавление меша в геометрический буфер (SSBO-буфер треугольников)
+     * @param mesh Хендл меша
+     * @return Состояние операции
+     */
+    bool __cdecl SetMesh(HMesh mesh)
+    {
+        try
+        {
+            // Указатель на меш
+            auto pMesh = reinterpret_cast<Mesh*>(mesh);
+
+            // Проверка на готовность к операции
+            if(!_bInitialized)
+                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            if(_shaderPrograms[RS_GEOMETRY_PREPARE] == nullptr)
+                throw std::runtime_error("No required shader set");
+
+            if(pMesh == nullptr)
+                throw std::runtime_error("No mesh provided");
+
+            // Преломляющие материалы учитываются при выборе специализации программы трассировки
+            if(MaterialRefracts(pMesh)) _frameRefraction = true;
+
+            // Двухуровневая структура - меш лишь добавляется как экземпляр TLAS (геометрия уже в BLAS)
+            if(_accelerationStructure == AS_TWO_LEVEL)
+            {
+                _tlasBuilder->addMesh(pMesh);
+            }
+            // Иначе треугольники меша переводятся в мировое пространство и записываются в общий буфер
+            else
+            {
+                // Индексы мешей текущего кадра следуют за индексами мешей сохраняемой сцены
+                const GLuint meshIndex = _retainedScene->getMeshHighWater() + _meshesCount;
+                ReserveMeshCapacity(meshIndex + 1);
+
+                // Если пердыдущий проход был другим - начать этап подготовки геометрии
+                if(_lastRenderingStage != RS_GEOMETRY_PREPARE) BeginGeometryPrepare();
+
+                // Треугольники меша записываются после уже записанных в этом кадре (буфер увеличивается при необходимости)
+                _frameTriangleCount += pMesh->geometry->getIndexCount() / 3;
+                ReserveTriangleCapacity(_retainedScene->getTriangleHighWater() + _frameTriangleCount);
+
+                // Подготовка меша (вычислительной программой или вершинной + геометрической)
+                PrepareMesh(pMesh, meshIndex, _geometryPrepareMode == GP_COMPUTE_SHADER);
+            }
+
+            // Увеличение кол-ва мешей
+            _meshesCount++;
+
+            // Обновить количество мешей в буфере UBO
+            UpdateTotalMeshes();
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Добавление набора мешей в геометрический буфер за один проход
+     * @param meshes Массив хендлов мешей
+     * @param count Кол-во мешей
+     * @return Состояние операции
+     */
+    bool __cdecl SetMeshes(const HMesh* meshes, size_t count)
+    {
+        try
+        {
+            // Указатель на массив мешей
+            auto pMeshes = reinterpret_cast<Mesh* const*>(meshes);
+
+            // Проверка на готовность к операции
+            if(!_bInitialized)
+                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+
+            if(pMeshes == nullptr && count > 0)
+                throw std::runtime_error("No meshes provided");
+
+            if(count == 0)
+                return true;
+
+            // Двухуровневая структура - меши лишь добавляются как экземпляры TLAS
+            if(_accelerationStructure == AS_TWO_LEVEL)
+            {
+                for(size_t i = 0; i < count; i++){
+                    if(pMeshes[i] == nullptr) throw std::runtime_error("No mesh provided");
+                    if(MaterialRefracts(pMeshes[i])) _frameRefraction = true;
+                    _tlasBuilder->addMesh(pMeshes[i]);
+                }
+            }
+            // Без подготовки геометрии вычислительным шейдером меши добавляются по одному
+            else if(_geometryPrepareMode != GP_COMPUTE_SHADER)
+            {
+                for(size_t i = 0; i < count; i++){
+                    if(!SetMesh(meshes[i])) return false;
+                }
+                return true;
+            }
+            // Пакетная подготовка - один вызов вычислительного шейдера для всех мешей
+            else
+            {
+                // Индексы мешей текущего кадра следуют за индексами мешей сохраняемой сцены
+                const GLuint firstMeshIndex = _retainedScene->getMeshHighWater() + _meshesCount;
+                ReserveMeshCapacity(firstMeshIndex + static_cast<GLuint>(count));
+
+                // Если пердыдущий проход был другим - начать этап подготовки геометрии
+                if(_lastRenderingStage != RS_GEOMETRY_PREPARE) BeginGeometryPrepare();
+
+                // Треугольники пакета записываются после уже записанных в этом кадре (буфер увеличивается при необходимости)
+                for(size_t i = 0; i < count; i++){
+                    if(pMeshes[i] == nullptr) throw std::runtime_error("No mesh provided");
+                    if(MaterialRefracts(pMeshes[i])) _frameRefraction = true;
+                    _frameTriangleCount += pMeshes[i]->geometry->getIndexCount() / 3;
+                }
+                ReserveTriangleCapacity(_retainedScene->getTriangleHighWater() + _frameTriangleCount);
+
+                // Треугольники геометрии берутся из BLAS (в пространстве объекта)
+                _blasPool->upload();
+                const GLuint groups = _meshInstanceBuffer->update(pMeshes, count, *_blasPool, GEOMETRY_PREPARE_GROUP_SIZE, firstMeshIndex);
+
+                // Сброс счетчиков треугольников и запись границ всех мешей пакета
+                ResetMeshCounters(firstMeshIndex, static_cast<GLuint>(count));
+                WriteMeshBounds(pMeshes, count, firstMeshIndex);
+
+                // Использовать шейдер (в пределах кадра программа подготовки может меняться между вызовами)
+                glUseProgram(_geometryPrepareComputeProgram->getId());
+                glUniform1ui(_geometryPrepareComputeProgram->getUniformLocations()->instanceCount, static_cast<GLuint>(count));
+
+                // Подготовка всех мешей (группы раскладываются по сетке X*Y, индекс группы для поиска меша - линейный)
+                DispatchComputeGroups(groups);
+            }
+
+            // Увеличение кол-ва мешей
+            _meshesCount += static_cast<GLuint>(count);
+
+            // Обновить количество мешей в буфере UBO
+            UpdateTotalMeshes();
+        }
+        catch(std::exception& ex)
+        {
+            _strLastErrorMsg = ex.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Отрисовка всей сцены (проход трассировки лучей)
+     * @return Состояние операции
+     */
+    bool __cdecl RenderScene()
+    {
+        try
+        {
+            // Проверка на готовность к операции
+            if(!_bInitialized)
+                throw std::runtime_error("Library isn't initialized. Please call rtgl::Init fist.");
+            if(_shaderPrograms[RS_RAY_TRACING] == nullptr || _shaderPrograms[RS_BVH_BUILD] == nullptr)
+                throw std::runtime_error("No required shader set");
+            if(_rayTracingMode != RT_FRAGMENT_SHADER && _rayTracingComputeProgram == nullptr)
+                throw std::runtime_error("No required shader set");
+
+            // Меши сохраняемой сцены готовятся даже если в кадре не было других мешей
+            if(_accelerationStructure == AS_SCENE_LBVH && _lastRenderingStage != RS_GEOMETRY_PREPARE)
+                BeginGeometryPrepare();
+
+            // Завершение замера времени подготовки геометрии
+            if(_geometryPrepareTimeQueryActive){
+                glEndQuery(GL_TIME_ELAPSED);
+                _geometryPrepareTimeQueryActive = false;
+                _geometryPrepareTimeQueryPending = true;
+            }
+
+            // Растеризован ли буфер видимости в текущем кадре
+            bool visibilityRasterized = false;
+
+            // Двухуровневая структура - выгрузка изменившихся BLAS и построение TLAS над мешами (включая сохраняемую сцену)
+            if(_accelerationStructure == AS_TWO_LEVEL)
+            {
+                for(const RetainedScene::Slot& slot : _retainedScene->getSlots()) _tlasBuilder->addMesh(slot.mesh);
+
+                // TLAS записывается в буфер узлов BVH сцены (2n-1 узлов для n экземпляров)
+                ReserveTriangleCapacity(static_cast<GLuint>(_retainedScene->getSlots().size()) + _meshesCount);
+
+                _blasPool->upload();
+                _tlasBuilder->build(*_blasPool, _bvhNodeBuffer, glm::vec3(_camera->getModelMatrix()[3]));
+
+                // Карты теней источников (теневые лучи выпускаются только из полутени)
+                if(_shadows && _shadowMode == SM_HYBRID && _shadowMaps != nullptr) RenderShadowMaps();
+
+                // Первичные лучи и отражения в экранном пространстве начинаются с растеризованного буфера видимости
+                // (экземпляры уже в порядке TLAS), отражениям нужно также изображение предыдущего кадра
+                if(_primaryVisibility || _reflectionMode == RM_SCREEN_SPACE)
+                {
+                    RasterizePrimaryVisibility();
+                    _framePrimaryVisibility = _primaryVisibility;
+                    _frameScreenSpaceReflections = _reflectionMode == RM_SCREEN_SPACE && _reflectionHistoryValid;
+                    visibilityRasterized = true;
+                }
+            }
+            // Построение BVH по треугольникам записанным на этапе подготовки геометрии
+            else if(_retainedScene->getMeshHighWater() + _meshesCount > 0)
+            {
+                // Использовать шейдер
+                glUseProgram(_shaderPrograms[RS_BVH_BUILD]->getId());
+
+                // Сменить идентификатор последного прохода
+                _lastRenderingStage = RS_BVH_BUILD;
+
+                // Ожидаем завершения записи треугольников и счетчиков
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+
+                // Кол-во рабочих групп (по одному потоку на записанный треугольник, а не на всю вместимость буфера)
+                const GLuint triangles = std::min(_retainedScene->getTriangleHighWater() + _frameTriangleCount, _triangleCapacity);
+                const GLuint groups = (triangles + BVH_GROUP_SIZE - 1) / BVH_GROUP_SIZE;
+                const auto locations = _shaderPrograms[RS_BVH_BUILD]->getUniformLocations();
+                glUniform1ui(locations->bvhGroupCount, groups);
+
+                // Пустоты между участками сохраняемой сцены не входят в иерархию
+                glUniform1ui(locations->bvhHoleCount, _retainedScene->getTriangleHoleCount());
+
+                // Коды Мортона для центров треугольников
+                glUniform1ui(locations->bvhBuildStage, BVH_STAGE_MORTON);
+                glDispatchCompute(groups, 1, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                // Поразрядная сортировка кодов (по BVH_RADIX_BITS бит за проход)
+                for(GLuint shift = 0; shift < 32; shift += BVH_RADIX_BITS)
+                {
+                    glUniform1ui(locations->radixShift, shift);
+
+                    glUniform1ui(locations->bvhBuildStage, BVH_STAGE_RADIX_COUNT);
+                    glDispatchCompute(groups, 1, 1);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                    glUniform1ui(locations->bvhBuildStage, BVH_STAGE_RADIX_SCAN);
+                    glDispatchCompute(1, 1, 1);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                    glUniform1ui(locations->bvhBuildStage, BVH_STAGE_RADIX_SCATTER);
+                    glDispatchCompute(groups, 1, 1);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                    // Выход прохода становится входом следующего
+                    std::swap(_bvhMortonBuffers[0], _bvhMortonBuffers[1]);
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, _bvhMortonBuffers[0]);
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, _bvhMortonBuffers[1]);
+                }
+
+                // Построение иерархии по отсортированным кодам
+                glUniform1ui(locations->bvhBuildStage, BVH_STAGE_HIERARCHY);
+                glDispatchCompute(groups, 1, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                // Вычисление границ узлов снизу вверх
+                glUniform1ui(locations->bvhBuildStage, BVH_STAGE_BOUNDS);
+                glDispatchCompute(groups, 1, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+
+            // BVH аналитических примитивов (строится на CPU, кол-во примитивов передается шейдерам через UBO)
+            const GLuint primitiveCount = _primitiveBvhBuilder->getCount();
+            _primitiveDataPool->upload();
+            _primitiveBvhBuilder->build(*_primitiveDataPool);
+            glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 16, 4, &primitiveCount);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+            // Специализация программы трассировки для параметров кадра
+            SelectRayTracingPrograms();
+
+            // Обновление кубических карт зондов отражений (до обнуления счетчиков лучей и замера времени трассировки)
+            UpdateReflectionProbes();
+
+            // Обнулить счетчики лучей (завершенных русской рулеткой, отраженных, найденных в экранном пространстве и теневых)
+            const GLuint zeroRayCounters[4] = {};
+            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, _triangleCounterGlobalBuffer);
+            glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), sizeof(zeroRayCounters), zeroRayCounters);
+            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+            // Замер времени трассировки (результат читается при запросе статистики)
+            glBeginQuery(GL_TIME_ELAPSED, _rayTracingTimeQuery);
+
+            // Трассировка вычислительными шейдерами (вместо отрисовки экранного квадрата)
+            if(_rayTracingMode != RT_FRAGMENT_SHADER)
+            {
+                if(_rayTracingMode == RT_WAVEFRONT) TraceWavefront();
+                else TracePersistentThreads();
+
+                // Программа и кадровый буфер сменились - при трассировке фрагментным шейдером их нужно установить заново
+                _lastRenderingStage = RS_NONE;
+            }
+            // Трассировка во фрагментном шейдере (экранный квадрат)
+            else
+            {
+                // Если пердыдущий проход был другим - установить необходимые параметры
+                if(_lastRenderingStage != RS_RAY_TRACING)
+                {
+                    // Привязываемся ко фрейм-буфферу (временно используем основной)
+                    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+                    // Использовать шейдер
+                    glUseProgram(_shaderPrograms[RS_RAY_TRACING]->getId());
+
+                    // Включить запись в цветовой буфер
+                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+                    // Указать область кадра доступную для отрисовки
+                    glScissor(0, 0, _screenWidth, _screenHeight);
+                    glViewport(0, 0, _screenWidth, _screenHeight);
+
+                    // Сменить идентификатор последного прохода
+                    _lastRenderingStage = RS_RAY_TRACING;
+                }
+
+                // Очистка буфера
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                // Передать FOV
+                glUniform1f(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->fov,_camera->getFov());
+                // Передать соотношение сторон
+                glUniform1f(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->aspectRatio,_camera->getAspectRatio());
+                // Передать положение камеры
+                glUniform3fv(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->camPosition, 1, glm::value_ptr(_camera->getPosition()));
+                // Передать матрицу вида для преобразования положений источников света в пространство вида
+                glUniformMatrix4fv(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->camModelMat, 1, GL_FALSE, glm::value_ptr(_camera->getModelMatrix()));
+                // Передать способ обхода структуры ускорения
+                glUniform1i(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->subgroupTraversal, _subgroupTraversal);
+                // Передать ядро проверки пересечений
+                glUniform1ui(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->intersectionKernel, _intersectionKernel);
+                // Передать порог веса луча для русской рулетки
+                glUniform1f(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->rayWeightThreshold, _rayWeightThreshold);
+                // Передать признак растеризованного буфера видимости
+                glUniform1i(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->primaryVisibility, _framePrimaryVisibility);
+                // Передать параметры отражений в экранном пространстве
+                SetScreenSpaceReflectionUniforms(_shaderPrograms[RS_RAY_TRACING]);
+                // Передать зонды отражений
+                SetReflectionProbeUniforms(_shaderPrograms[RS_RAY_TRACING]);
+                // Передать карты теней
+                SetShadowMapUniforms(_shaderPrograms[RS_RAY_TRACING]);
+
+                // Вторичные лучи в пониженном разрешении - первичные и вторичные лучи трассируются отдельными проходами
+                if(_secondaryRayResolution != SRR_FULL)
+                {
+                    TraceReducedSecondaryRays();
+                }
+                else
+                {
+                    // Передать проход трассировки (все лучи)
+                    glUniform1ui(_shaderPrograms[RS_RAY_TRACING]->getUniformLocations()->tracePass, TP_FULL);
+
+                    // Привязать геометрию и нарисовать ее
+                    glBindVertexArray(_geometryQuad->getVaoId());
+                    glDrawElements(GL_TRIANGLES, _geometryQuad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+                    glBindVertexArray(0);
+                }
+            }
 
-            // Обнулить кол-во источников света
+            glEndQuery(GL_TIME_ELAPSED);
+            _rayTracingTimeQueryPending = true;
+            _terminatedRaysPending = true;
+
+            // Итоговое изображение - источник цвета отражений следующего кадра (при смене режима или структуры ускорения сбрасывается)
+            if(visibilityRasterized && _reflectionMode == RM_SCREEN_SPACE) StoreReflectionHistory();
+            else _reflectionHistoryValid = false;
+
+            // Статистика кадра (треугольники сверх предельной вместимости отброшены при подготовке геометрии)
+            const GLuint triangleCount = _accelerationStructure == AS_SCENE_LBVH ? _retainedScene->getTriangleHighWater() + _frameTriangleCount : 0;
+            _frameStatistics.triangleCount = triangleCount;
+            _frameStatistics.meshCount = _retainedScene->getMeshHighWater() + _meshesCount;
+            _frameStatistics.lightCount = _lightSourceCount;
+            _frameStatistics.shadowMapCount = _frameShadowMapCount;
+            _frameStatistics.primitiveCount = primitiveCount;
+            if(!visibilityRasterized) _frameStatistics.primaryVisibilityTime = 0.0f;
+            _frameStatistics.triangleCapacity = _triangleCapacity;
+            _frameStatistics.meshCapacity = _meshCapacity;
+            _frameStatistics.lightCapacity = _lightCapacity;
+            _frameStatistics.bufferGrowCount = _frameBufferGrowCount;
+            _frameStatistics.droppedTriangles = triangleCount > _triangleCapacity ? triangleCount - _triangleCapacity : 0;
+            _frameStatistics.shaderPermutationCount = static_cast<unsigned>(_rayTracingPermutations->getCount() +
+                    (_rayTracingComputePermutations != nullptr ? _rayTracingComputePermutations->getCount() : 0));
+
+            // Обнулить кол-во источников света и мешей (меши сохраняемой сцены остаются)
             _lightSourceCount = 0;
             _meshesCount = 0;
+            _frameTriangleCount = 0;
+            _frameBufferGrowCount = 0;
+            _frameLightTypes = 0;
+            _frameRefraction = false;
+            _framePrimaryVisibility = false;
+            _frameScreenSpaceReflections = false;
+            _frameReflectionProbeCount = 0;
+            _frameShadowMapCount = 0;
+            _tlasBuilder->clear();
+            _primitiveBvhBuilder->clear();
 
             // Обнулить количество источников света в uniform-буфере
             glBindBuffer(GL_UNIFORM_BUFFER, _commonSettingsBuffer);
             glBufferSubData(GL_UNIFORM_BUFFER, 0, 4, &_lightSourceCount);
-            glBufferSubData(GL_UNIFORM_BUFFER, 4, 4, &_meshesCount);
             glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            UpdateTotalMeshes();
         }
         catch(std::exception& ex)
         {
@@ -10,6 +10,10 @@
 #include "Interface/GeometryBufferInterface.h"
 #include "Interface/MeshInterface.h"
 #include "Interface/LightSourceInterface.h"
+#include "Interface/PrimitiveInterface.h"
+#include "Interface/HeightfieldInterface.h"
+#include "Interface/VoxelOctreeInterface.h"
+#include "Interface/ReflectionProbeInterface.h"
 
 namespace rtgl
 {
@@ -28,9 +32,11 @@ namespace rtgl
          * @param screenWidth Ширина области отрисовки
          * @param screenHeight Высота области отрисовки
          * @param shaderSourcesBundle Исходные коды шейдеров
+         * @param sceneLimits Начальная вместимость буферов сцены
          * @return Состояние инициализации
          */
-        RENDERER_LIB_API bool __cdecl Init(unsigned screenWidth, unsigned screenHeight, const ShaderSourcesBundle& shaderSourcesBundle);
+        RENDERER_LIB_API bool __cdecl Init(unsigned screenWidth, unsigned screenHeight, const ShaderSourcesBundle& shaderSourcesBundle,
+                const SceneLimits& sceneLimits = SceneLimits());
 
         /**
          * Уничтожение ресурсов, освобождение памяти
@@ -61,6 +67,157 @@ namespace rtgl
          */
         RENDERER_LIB_API bool __cdecl SetCameraOrientation(const Vec3<float>& orientation);
 
+        /// Н А С Т Р О Й К И
+
+        /**
+         * Установка типа структуры ускорения (действует начиная со следующего кадра)
+         * @param type Тип структуры ускорения
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetAccelerationStructure(AccelerationStructureType type);
+
+        /**
+         * Установка способа подготовки геометрии (действует начиная со следующего кадра)
+         * @param mode Способ подготовки геометрии
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetGeometryPrepareMode(GeometryPrepareMode mode);
+
+        /**
+         * Установка способа трассировки лучей
+         * @param mode Способ трассировки
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetRayTracingMode(RayTracingMode mode);
+
+        /**
+         * Установка глубины трассировки (кол-во последовательных кастов луча, включая первичный)
+         * @param depth Глубина трассировки (для новой глубины собирается своя специализация программы трассировки)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetRayDepth(unsigned depth);
+
+        /**
+         * Установка параметров трассировки постоянными потоками (режим RT_PERSISTENT_THREADS)
+         * @param batchSize Кол-во пикселей каждого потока в порции, получаемой группой за одно обращение к счетчику работы
+         * @param groupCount Кол-во запускаемых рабочих групп (0 - по размеру устройства, ограничено предельным кол-вом групп устройства)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetPersistentThreadsParameters(unsigned batchSize, unsigned groupCount);
+
+        /**
+         * Включение сортировки вторичных лучей перед каждым отскоком (режим RT_WAVEFRONT)
+         * @param enabled Сортировать ли лучи (по октанту направления и коду Мортона начала)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetSecondaryRaySorting(bool enabled);
+
+        /**
+         * Включение совместного обхода структуры ускорения лучами подгруппы (GL_KHR_shader_subgroup_ballot/vote)
+         * @param enabled Обходить ли структуру всей подгруппой (без поддержки расширений драйвером всегда используется обход каждым потоком)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetSubgroupTraversal(bool enabled);
+
+        /**
+         * Выбор ядра проверки пересечений при обходе структуры ускорения
+         * @param kernel Ядро (IK_REFERENCE - исходные проверки, IK_PRECOMPUTED - с величинами, вычисленными для луча заранее)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetIntersectionKernel(IntersectionKernel kernel);
+
+        /**
+         * Включение теней (теневой луч к каждому источнику, обход завершается на первом пересечении до сферы источника)
+         * @param enabled Трассировать ли тени
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetShadows(bool enabled);
+
+        /**
+         * Установка способа получения теней
+         * Карты теней растеризуются только при двухуровневой структуре ускорения (иначе тени трассируются) и только для первых
+         * MAX_SHADOW_MAPS источников кадра, остальные источники затеняются теневыми лучами
+         * @param mode Способ получения теней
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetShadowMode(ShadowMode mode);
+
+        /**
+         * Установка порога веса луча для завершения путей русской рулеткой
+         * Луч с весом ниже порога продолжается с вероятностью вес/порог (вес выжившего луча становится равным порогу)
+         * @param threshold Порог веса (0 - пути не завершаются)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetRayWeightThreshold(float threshold);
+
+        /**
+         * Включение буфера видимости первичных лучей (меши растеризуются, обход структуры ускорения - только для вторичных лучей)
+         * Действует только при двухуровневой структуре ускорения, при AS_SCENE_LBVH первичные лучи трассируются
+         * @param enabled Растеризовать ли первичную видимость
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetPrimaryVisibility(bool enabled);
+
+        /**
+         * Установка способа получения отражений первичных лучей
+         * Отражения в экранном пространстве используют буфер видимости (только при двухуровневой структуре ускорения,
+         * иначе отраженные лучи трассируются) и изображение предыдущего кадра - в первом кадре после включения лучи трассируются
+         * @param mode Способ получения отражений
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetReflectionMode(ReflectionMode mode);
+
+        /**
+         * Установка параметров отражений в экранном пространстве
+         * @param maxSteps Предельное кол-во шагов по экрану (отрезок луча длиннее - проходится с шагом больше пикселя)
+         * @param thickness Толщина поверхностей буфера видимости (луч, прошедший за поверхностью глубже, не засчитывает пересечение)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetScreenSpaceReflectionParameters(unsigned maxSteps, float thickness);
+
+        /**
+         * Установка параметров зондов отражений
+         * @param roughnessThreshold Шероховатость, начиная с которой отражение поверхности берется из зонда
+         * @param bounceDepth Отскок, начиная с которого из зонда берется отражение любой поверхности (0 - с первичных лучей)
+         * @param facesPerFrame Кол-во граней кубических карт, отрисовываемых за кадр (0 - карты не обновляются)
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetReflectionProbeParameters(float roughnessThreshold, unsigned bounceDepth, unsigned facesPerFrame);
+
+        /**
+         * Установка разрешения вторичных лучей (только при трассировке фрагментным шейдером)
+         * Первичные лучи трассируются в полном разрешении, вторичные - в пониженном, после чего их цвет повышается
+         * до полного разрешения с учетом нормалей и расстояний первичных пересечений (требуется программа пост-процессинга)
+         * @param resolution Разрешение вторичных лучей
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetSecondaryRayResolution(SecondaryRayResolution resolution);
+
+        /**
+         * Получение статистики последнего отрисованного кадра
+         * @param statistics Указатель на структуру статистики
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl GetFrameStatistics(FrameStatistics* statistics);
+
+        /// С О Х Р А Н Я Е М А Я   С Ц Е Н А
+
+        /**
+         * Добавление меша на сохраняемую сцену
+         * @details Меш остается на сцене между кадрами (не требует вызова SetMesh) и занимает постоянный участок буфера
+         * треугольников. Повторно подготавливается только после изменения положения, ориентации, масштаба или материала
+         * @param mesh Хендл меша
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl AddMeshToScene(HMesh mesh);
+
+        /**
+         * Удаление меша с сохраняемой сцены (участок буфера треугольников освобождается для других мешей)
+         * @param mesh Хендл меша
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl RemoveMeshFromScene(HMesh mesh);
+
         /// Р Е Н Д Е Р И Н Г
 
         /**
@@ -70,6 +227,24 @@ namespace rtgl
          */
         RENDERER_LIB_API bool __cdecl SetLightSource(HLightSource lightSource);
 
+        /**
+         * Добавление аналитического примитива на сцену текущего кадра
+         * @details Примитив не разбивается на треугольники - луч пересекается с его канонической формой напрямую
+         * (для примитивов строится отдельная BVH на стороне CPU, используется при любой структуре ускорения)
+         * @param primitive Хендл примитива
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetPrimitive(HPrimitive primitive);
+
+        /**
+         * Добавление зонда отражений на сцену текущего кадра
+         * @details Кубическая карта зонда сохраняется между кадрами (до уничтожения зонда) и обновляется по несколько граней
+         * за кадр, отражения берутся только из зондов, все грани которых уже отрисованы
+         * @param reflectionProbe Хендл зонда
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetReflectionProbe(HReflectionProbe reflectionProbe);
+
         /**
          * Добавление меша в геометрический буфер (SSBO-буфер треугольников)
          * @param mesh Хендл меша
@@ -77,6 +252,16 @@ namespace rtgl
          */
         RENDERER_LIB_API bool __cdecl SetMesh(HMesh mesh);
 
+        /**
+         * Добавление набора мешей в геометрический буфер за один проход
+         * @details Матрицы и материалы всех мешей записываются в один буфер экземпляров, а треугольники готовятся одним вызовом
+         * вычислительного шейдера (только в режиме GP_COMPUTE_SHADER, в остальных режимах меши добавляются по одному)
+         * @param meshes Массив хендлов мешей
+         * @param count Кол-во мешей
+         * @return Состояние операции
+         */
+        RENDERER_LIB_API bool __cdecl SetMeshes(const HMesh* meshes, size_t count);
+
         /**
          * Отрисовка всей сцены (проход трассировки лучей)
          * @return Состояние операции
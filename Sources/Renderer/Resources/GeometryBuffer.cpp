@@ -199,4 +199,22 @@ namespace rtgl
     {
         return this->vaoId_;
     }
+
+    /**
+     * Получить ID OpenGL объекта VBO (Vertex Buffer Object)
+     * @return Дескриптор OpenGL объекта
+     */
+    GLuint GeometryBuffer::getVboId() const
+    {
+        return this->vboId_;
+    }
+
+    /**
+     * Получить ID OpenGL объекта EBO (Element Buffer Object)
+     * @return Дескриптор OpenGL объекта
+     */
+    GLuint GeometryBuffer::getEboId() const
+    {
+        return this->eboId_;
+    }
 }
\ No newline at end of file
@@ -91,5 +91,17 @@ namespace rtgl
          * @return Дескриптор OpenGL объекта
          */
         [[nodiscard]] GLuint getVaoId() const;
+
+        /**
+         * Получить ID OpenGL объекта VBO (Vertex Buffer Object)
+         * @return Дескриптор OpenGL объекта
+         */
+        [[nodiscard]] GLuint getVboId() const;
+
+        /**
+         * Получить ID OpenGL объекта EBO (Element Buffer Object)
+         * @return Дескриптор OpenGL объекта
+         */
+        [[nodiscard]] GLuint getEboId() const;
     };
 }
@@ -0,0 +1,132 @@
+/**
+ * Класс карты высот - сетка отсчетов высоты и пирамида минимумов/максимумов над ее ячейками
+ * Карта не разбивается на треугольники: шейдер обходит пирамиду иерархическим 2D DDA и проверяет
+ * пересечение с поверхностью только в ячейке нижнего уровня
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "Heightfield.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace rtgl
+{
+    /**
+     * Конструктор карты высот (строится пирамида минимумов/максимумов)
+     * @param heights Отсчеты высоты (width * depth значений, построчно по X)
+     * @param width Кол-во отсчетов по оси X (не менее 2)
+     * @param depth Кол-во отсчетов по оси Z (не менее 2)
+     */
+    Heightfield::Heightfield(std::vector<GLfloat> heights, GLuint width, GLuint depth):
+            width_(width),
+            depth_(depth),
+            minHeight_(0.0f),
+            maxHeight_(0.0f),
+            samples_(std::move(heights))
+    {
+        if(width_ < 2 || depth_ < 2) throw std::runtime_error("Heightfield must have at least 2x2 samples");
+        if(samples_.size() != static_cast<size_t>(width_) * depth_) throw std::runtime_error("Heightfield sample count doesn't match its size");
+
+        auto range = std::minmax_element(samples_.begin(), samples_.end());
+        minHeight_ = *range.first;
+        maxHeight_ = *range.second;
+
+        // Уровень пирамиды L покрывает узлом 2^L * 2^L ячеек, вершина - один узел над всей сеткой
+        // Уровень 0 (ячейка) не хранится - шейдер вычисляет его диапазон по 4 углам
+        const GLuint cellsX = width_ - 1;
+        const GLuint cellsZ = depth_ - 1;
+        GLuint top = 0;
+        while((1u << top) < std::max(cellsX, cellsZ)) top++;
+
+        // Предыдущий уровень (для первого - диапазоны ячеек)
+        GLuint previousWidth = cellsX;
+        GLuint previousDepth = cellsZ;
+        std::vector<GLfloat> previous(static_cast<size_t>(cellsX) * cellsZ * 2);
+        for(GLuint z = 0; z < cellsZ; z++){
+            for(GLuint x = 0; x < cellsX; x++){
+                const size_t i = static_cast<size_t>(z) * width_ + x;
+                const GLfloat h[4] = {samples_[i], samples_[i + 1], samples_[i + width_], samples_[i + width_ + 1]};
+                const size_t cell = (static_cast<size_t>(z) * cellsX + x) * 2;
+                previous[cell] = *std::min_element(h, h + 4);
+                previous[cell + 1] = *std::max_element(h, h + 4);
+            }
+        }
+
+        for(GLuint level = 1; level <= top; level++)
+        {
+            const GLuint levelWidth = (previousWidth + 1) / 2;
+            const GLuint levelDepth = (previousDepth + 1) / 2;
+            std::vector<GLfloat> current(static_cast<size_t>(levelWidth) * levelDepth * 2);
+
+            // Узел - объединение диапазонов существующих потомков (на краях сетки потомков может быть меньше 4)
+            for(GLuint z = 0; z < levelDepth; z++){
+                for(GLuint x = 0; x < levelWidth; x++){
+                    GLfloat nodeMin = previous[(static_cast<size_t>(z * 2) * previousWidth + x * 2) * 2];
+                    GLfloat nodeMax = previous[(static_cast<size_t>(z * 2) * previousWidth + x * 2) * 2 + 1];
+                    for(GLuint cz = z * 2; cz < std::min(z * 2 + 2, previousDepth); cz++){
+                        for(GLuint cx = x * 2; cx < std::min(x * 2 + 2, previousWidth); cx++){
+                            const size_t child = (static_cast<size_t>(cz) * previousWidth + cx) * 2;
+                            nodeMin = std::min(nodeMin, previous[child]);
+                            nodeMax = std::max(nodeMax, previous[child + 1]);
+                        }
+                    }
+                    const size_t node = (static_cast<size_t>(z) * levelWidth + x) * 2;
+                    current[node] = nodeMin;
+                    current[node + 1] = nodeMax;
+                }
+            }
+
+            samples_.insert(samples_.end(), current.begin(), current.end());
+            previous = std::move(current);
+            previousWidth = levelWidth;
+            previousDepth = levelDepth;
+        }
+    }
+
+    /**
+     * Кол-во отсчетов по оси X
+     * @return Кол-во отсчетов
+     */
+    GLuint Heightfield::getWidth() const
+    {
+        return width_;
+    }
+
+    /**
+     * Кол-во отсчетов по оси Z
+     * @return Кол-во отсчетов
+     */
+    GLuint Heightfield::getDepth() const
+    {
+        return depth_;
+    }
+
+    /**
+     * Минимальная высота карты
+     * @return Высота
+     */
+    GLfloat Heightfield::getMinHeight() const
+    {
+        return minHeight_;
+    }
+
+    /**
+     * Максимальная высота карты
+     * @return Высота
+     */
+    GLfloat Heightfield::getMaxHeight() const
+    {
+        return maxHeight_;
+    }
+
+    /**
+     * Отсчеты высоты и уровни пирамиды (в порядке размещения в буфере)
+     * @return Ссылка на массив значений
+     */
+    const std::vector<GLfloat> &Heightfield::getSamples() const
+    {
+        return samples_;
+    }
+}
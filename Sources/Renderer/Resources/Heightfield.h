@@ -0,0 +1,81 @@
+/**
+ * Класс карты высот - сетка отсчетов высоты и пирамида минимумов/максимумов над ее ячейками
+ * Карта не разбивается на треугольники: шейдер обходит пирамиду иерархическим 2D DDA и проверяет
+ * пересечение с поверхностью только в ячейке нижнего уровня
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+#include <vector>
+#include <GL/glew.h>
+
+namespace rtgl
+{
+    class Heightfield final
+    {
+    private:
+        /// Кол-во отсчетов по осям X и Z
+        GLuint width_;
+        GLuint depth_;
+        /// Минимальная и максимальная высота карты
+        GLfloat minHeight_;
+        GLfloat maxHeight_;
+        /// Отсчеты высоты (построчно по X), за ними - уровни пирамиды начиная с первого (пары минимум/максимум)
+        std::vector<GLfloat> samples_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        Heightfield(const Heightfield& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        Heightfield& operator=(const Heightfield& other) = delete;
+
+        /**
+         * Конструктор карты высот (строится пирамида минимумов/максимумов)
+         * @param heights Отсчеты высоты (width * depth значений, построчно по X)
+         * @param width Кол-во отсчетов по оси X (не менее 2)
+         * @param depth Кол-во отсчетов по оси Z (не менее 2)
+         */
+        Heightfield(std::vector<GLfloat> heights, GLuint width, GLuint depth);
+
+        /**
+         * Кол-во отсчетов по оси X
+         * @return Кол-во отсчетов
+         */
+        [[nodiscard]] GLuint getWidth() const;
+
+        /**
+         * Кол-во отсчетов по оси Z
+         * @return Кол-во отсчетов
+         */
+        [[nodiscard]] GLuint getDepth() const;
+
+        /**
+         * Минимальная высота карты
+         * @return Высота
+         */
+        [[nodiscard]] GLfloat getMinHeight() const;
+
+        /**
+         * Максимальная высота карты
+         * @return Высота
+         */
+        [[nodiscard]] GLfloat getMaxHeight() const;
+
+        /**
+         * Отсчеты высоты и уровни пирамиды (в порядке размещения в буфере)
+         * @return Ссылка на массив значений
+         */
+        [[nodiscard]] const std::vector<GLfloat>& getSamples() const;
+    };
+}
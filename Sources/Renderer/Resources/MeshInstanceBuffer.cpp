@@ -0,0 +1,94 @@
+/**
+ * Буфер экземпляров мешей для пакетной подготовки геометрии (один вызов вычислительного шейдера на все меши)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "MeshInstanceBuffer.h"
+
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param bufferBinding Индекс привязки буфера экземпляров
+     */
+    MeshInstanceBuffer::MeshInstanceBuffer(GLuint bufferBinding):
+            bufferId_(0),
+            capacity_(1)
+    {
+        // Буфер изначально содержит один элемент (чтобы привязка была корректной до первой записи)
+        glGenBuffers(1, &bufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferId_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Instance), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bufferBinding, bufferId_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    MeshInstanceBuffer::~MeshInstanceBuffer()
+    {
+        if(this->bufferId_) glDeleteBuffers(1, &bufferId_);
+    }
+
+    /**
+     * Запись экземпляров мешей в буфер
+     * @param meshes Массив мешей
+     * @param count Кол-во мешей
+     * @param blasPool Хранилище BLAS (источник треугольников геометрии, должно быть выгружено)
+     * @param groupSize Размер рабочей группы вычислительного шейдера
+     * @param firstMeshIndex Индекс первого меша (индексы последующих мешей идут подряд)
+     * @param meshIndices Индексы мешей (если заданы - используются вместо последовательных)
+     * @param outputOffsets Сдвиги записи треугольников мешей (если не заданы - запись по атомарному счетчику)
+     * @return Общее кол-во рабочих групп
+     */
+    GLuint MeshInstanceBuffer::update(const Mesh* const* meshes, size_t count, const BlasPool &blasPool, GLuint groupSize,
+                                      GLuint firstMeshIndex, const GLuint* meshIndices, const GLuint* outputOffsets)
+    {
+        instances_.resize(count);
+
+        GLuint groups = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            const Mesh* mesh = meshes[i];
+            if(mesh == nullptr) throw std::runtime_error("No mesh provided");
+
+            const BlasPool::Entry* blas = blasPool.find(mesh->geometry);
+            if(blas == nullptr) throw std::runtime_error("Mesh geometry has no acceleration structure");
+
+            const glm::mat4& model = mesh->getModelMatrix();
+
+            Instance& instance = instances_[i];
+            instance = {};
+            instance.model = model;
+            instance.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+            instance.albedo = mesh->material.albedo;
+            instance.metallic = mesh->material.metallic;
+            instance.roughness = mesh->material.roughness;
+            instance.primaryCoff = mesh->material.primaryToSecondary;
+            instance.reflectToRefract = mesh->material.reflectionToRefraction;
+            instance.refractionCoff = mesh->material.refractionCoff;
+            instance.firstGroup = groups;
+            instance.triangleOffset = blas->triangleOffset;
+            instance.triangleCount = static_cast<GLuint>(blas->positions.size());
+            instance.meshIndex = meshIndices != nullptr ? meshIndices[i] : firstMeshIndex + static_cast<GLuint>(i);
+            instance.outputOffset = outputOffsets != nullptr ? outputOffsets[i] : NO_OUTPUT_OFFSET;
+
+            // Каждая рабочая группа обрабатывает треугольники только одного меша
+            groups += (instance.triangleCount + groupSize - 1) / groupSize;
+        }
+
+        // Выгрузка (буфер пересоздается только при нехватке емкости)
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferId_);
+        if(count > capacity_){
+            capacity_ = count;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity_ * sizeof(Instance)), nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(count * sizeof(Instance)), instances_.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        return groups;
+    }
+}
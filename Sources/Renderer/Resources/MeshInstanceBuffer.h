@@ -0,0 +1,92 @@
+/**
+ * Буфер экземпляров мешей для пакетной подготовки геометрии (один вызов вычислительного шейдера на все меши)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Acceleration/BlasPool.h"
+#include "../Scene/Mesh.h"
+
+namespace rtgl
+{
+    class MeshInstanceBuffer final
+    {
+    public:
+        /// Экземпляр меша (соответствует структуре PrepareInstance в шейдере, выравнивание std430)
+        struct Instance
+        {
+            // Матрица модели
+            glm::mat4 model;
+            // Матрица преобразования нормалей (используется только 3x3 часть)
+            glm::mat4 normalMatrix;
+            // Материал
+            glm::vec3 albedo;
+            GLfloat metallic;
+            GLfloat roughness;
+            GLfloat primaryCoff;
+            GLfloat reflectToRefract;
+            GLfloat refractionCoff;
+            // Первая рабочая группа экземпляра (диапазон каждого экземпляра выровнен по размеру группы)
+            GLuint firstGroup;
+            // Сдвиг и кол-во треугольников геометрии в буфере треугольников BLAS
+            GLuint triangleOffset;
+            GLuint triangleCount;
+            // Индекс меша (в счетчиках и границах мешей)
+            GLuint meshIndex;
+            // Сдвиг записи треугольников в буфере треугольников (NO_OUTPUT_OFFSET - запись по атомарному счетчику)
+            GLuint outputOffset;
+            GLuint padding[3];
+        };
+
+        /// Значение сдвига записи, при котором треугольники записываются по общему атомарному счетчику
+        static const GLuint NO_OUTPUT_OFFSET = 0xFFFFFFFF;
+
+    private:
+        /// OpenGL дескриптор буфера экземпляров
+        GLuint bufferId_;
+        /// Текущая емкость буфера (в экземплярах)
+        size_t capacity_;
+        /// Данные экземпляров (хранятся между вызовами, чтобы не выделять память каждый кадр)
+        std::vector<Instance> instances_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        MeshInstanceBuffer(const MeshInstanceBuffer& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        MeshInstanceBuffer& operator=(const MeshInstanceBuffer& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param bufferBinding Индекс привязки буфера экземпляров
+         */
+        explicit MeshInstanceBuffer(GLuint bufferBinding);
+
+        /**
+         * Очистка ресурса
+         */
+        ~MeshInstanceBuffer();
+
+        /**
+         * Запись экземпляров мешей в буфер
+         * @param meshes Массив мешей
+         * @param count Кол-во мешей
+         * @param blasPool Хранилище BLAS (источник треугольников геометрии, должно быть выгружено)
+         * @param groupSize Размер рабочей группы вычислительного шейдера
+         * @param firstMeshIndex Индекс первого меша (индексы последующих мешей идут подряд)
+         * @param meshIndices Индексы мешей (если заданы - используются вместо последовательных)
+         * @param outputOffsets Сдвиги записи треугольников мешей (если не заданы - запись по атомарному счетчику)
+         * @return Общее кол-во рабочих групп
+         */
+        GLuint update(const Mesh* const* meshes, size_t count, const BlasPool& blasPool, GLuint groupSize,
+                GLuint firstMeshIndex, const GLuint* meshIndices = nullptr, const GLuint* outputOffsets = nullptr);
+    };
+}
@@ -0,0 +1,138 @@
+/**
+ * Хранилище кубических карт зондов отражений - карты всех зондов являются слоями одного массива кубических текстур
+ * (samplerCubeArray), каждый зонд занимает свой слой, пока не будет уничтожен
+ * Уровни детализации заполняются уменьшением нулевого уровня и используются как карта, предварительно отфильтрованная
+ * по шероховатости (чем выше шероховатость - тем более размытый уровень)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "ReflectionProbePool.h"
+
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param faceSize Размер грани кубической карты (в пикселях)
+     * @param capacity Кол-во зондов
+     * @param textureUnit Текстурный блок, к которому привязывается массив
+     */
+    ReflectionProbePool::ReflectionProbePool(GLuint faceSize, GLuint capacity, GLuint textureUnit):
+            textureId_(0),
+            frameBufferId_(0),
+            faceSize_(faceSize),
+            used_(capacity, false),
+            nextFace_(capacity, 0),
+            renderedFaces_(capacity, 0)
+    {
+        // Кол-во уровней детализации (до грани в один пиксель)
+        GLsizei levels = 1;
+        while((faceSize_ >> static_cast<GLuint>(levels)) > 0) levels++;
+
+        // Массив кубических текстур (слой - грань, 6 слоев на зонд), выборка между гранями без швов
+        glGenTextures(1, &textureId_);
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, textureId_);
+        glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, levels, GL_RGBA16F, static_cast<GLsizei>(faceSize_), static_cast<GLsizei>(faceSize_), static_cast<GLsizei>(capacity * 6));
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glActiveTexture(GL_TEXTURE0);
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        glGenFramebuffers(1, &frameBufferId_);
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    ReflectionProbePool::~ReflectionProbePool()
+    {
+        if(this->frameBufferId_) glDeleteFramebuffers(1, &frameBufferId_);
+        if(this->textureId_) glDeleteTextures(1, &textureId_);
+    }
+
+    /**
+     * Получение слота зонда (при первом обращении слот выделяется, содержимое карты отрисовывается заново)
+     * @param probe Зонд
+     * @return Индекс кубической карты в массиве
+     */
+    GLuint ReflectionProbePool::acquire(const void *probe)
+    {
+        auto it = slots_.find(probe);
+        if(it != slots_.end()) return it->second;
+
+        for(GLuint slot = 0; slot < used_.size(); slot++)
+        {
+            if(used_[slot]) continue;
+
+            used_[slot] = true;
+            nextFace_[slot] = 0;
+            renderedFaces_[slot] = 0;
+            slots_[probe] = slot;
+            return slot;
+        }
+
+        throw std::runtime_error("Not enough reflection probe slots");
+    }
+
+    /**
+     * Освобождение слота зонда
+     * @param probe Зонд
+     */
+    void ReflectionProbePool::release(const void *probe)
+    {
+        auto it = slots_.find(probe);
+        if(it == slots_.end()) return;
+
+        used_[it->second] = false;
+        slots_.erase(it);
+    }
+
+    /**
+     * Готова ли карта слота к выборке (все грани отрисованы хотя бы раз)
+     * @param slot Индекс кубической карты
+     * @return Да или нет
+     */
+    bool ReflectionProbePool::isComplete(GLuint slot) const
+    {
+        return renderedFaces_[slot] >= 6;
+    }
+
+    /**
+     * Привязка кадрового буфера к следующей грани слота (грани обновляются по кругу)
+     * @param slot Индекс кубической карты
+     * @return Индекс грани (в порядке GL_TEXTURE_CUBE_MAP_POSITIVE_X ... NEGATIVE_Z)
+     */
+    GLuint ReflectionProbePool::bindNextFace(GLuint slot)
+    {
+        const GLuint face = nextFace_[slot];
+        nextFace_[slot] = (face + 1) % 6;
+        if(renderedFaces_[slot] < 6) renderedFaces_[slot]++;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBufferId_);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureId_, 0, static_cast<GLint>(slot * 6 + face));
+        return face;
+    }
+
+    /**
+     * Заполнение уровней детализации всех карт по нулевому уровню
+     */
+    void ReflectionProbePool::updateLevels()
+    {
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, textureId_);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP_ARRAY);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+    }
+
+    /**
+     * Размер грани кубической карты
+     * @return Размер (в пикселях)
+     */
+    GLuint ReflectionProbePool::getFaceSize() const
+    {
+        return faceSize_;
+    }
+}
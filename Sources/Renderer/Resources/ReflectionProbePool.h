@@ -0,0 +1,100 @@
+/**
+ * Хранилище кубических карт зондов отражений - карты всех зондов являются слоями одного массива кубических текстур
+ * (samplerCubeArray), каждый зонд занимает свой слой, пока не будет уничтожен
+ * Уровни детализации заполняются уменьшением нулевого уровня и используются как карта, предварительно отфильтрованная
+ * по шероховатости (чем выше шероховатость - тем более размытый уровень)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <GL/glew.h>
+
+namespace rtgl
+{
+    class ReflectionProbePool final
+    {
+    private:
+        /// OpenGL дескриптор массива кубических текстур (формат RGBA16F)
+        GLuint textureId_;
+        /// OpenGL дескриптор кадрового буфера, в который отрисовывается грань
+        GLuint frameBufferId_;
+        /// Размер грани (в пикселях)
+        GLuint faceSize_;
+        /// Слот каждого зонда (зонд => индекс кубической карты в массиве)
+        std::unordered_map<const void*, GLuint> slots_;
+        /// Занят ли слот
+        std::vector<bool> used_;
+        /// Следующая отрисовываемая грань каждого слота
+        std::vector<GLuint> nextFace_;
+        /// Кол-во отрисованных граней каждого слота (карта готова к выборке, когда отрисованы все 6)
+        std::vector<GLuint> renderedFaces_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        ReflectionProbePool(const ReflectionProbePool& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        ReflectionProbePool& operator=(const ReflectionProbePool& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param faceSize Размер грани кубической карты (в пикселях)
+         * @param capacity Кол-во зондов
+         * @param textureUnit Текстурный блок, к которому привязывается массив
+         */
+        ReflectionProbePool(GLuint faceSize, GLuint capacity, GLuint textureUnit);
+
+        /**
+         * Очистка ресурса
+         */
+        ~ReflectionProbePool();
+
+        /**
+         * Получение слота зонда (при первом обращении слот выделяется, содержимое карты отрисовывается заново)
+         * @param probe Зонд
+         * @return Индекс кубической карты в массиве
+         */
+        GLuint acquire(const void* probe);
+
+        /**
+         * Освобождение слота зонда
+         * @param probe Зонд
+         */
+        void release(const void* probe);
+
+        /**
+         * Готова ли карта слота к выборке (все грани отрисованы хотя бы раз)
+         * @param slot Индекс кубической карты
+         * @return Да или нет
+         */
+        [[nodiscard]] bool isComplete(GLuint slot) const;
+
+        /**
+         * Привязка кадрового буфера к следующей грани слота (грани обновляются по кругу)
+         * @param slot Индекс кубической карты
+         * @return Индекс грани (в порядке GL_TEXTURE_CUBE_MAP_POSITIVE_X ... NEGATIVE_Z)
+         */
+        GLuint bindNextFace(GLuint slot);
+
+        /**
+         * Заполнение уровней детализации всех карт по нулевому уровню
+         */
+        void updateLevels();
+
+        /**
+         * Размер грани кубической карты
+         * @return Размер (в пикселях)
+         */
+        [[nodiscard]] GLuint getFaceSize() const;
+    };
+}
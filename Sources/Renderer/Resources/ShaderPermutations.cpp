@@ -0,0 +1,73 @@
+/**
+ * Набор специализаций шейдерной программы - один исходный код собирается с разными блоками #define
+ * Собранные программы кешируются по ключу специализации (каждая специализация собирается один раз)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "ShaderPermutations.h"
+
+#include <tuple>
+#include <utility>
+
+namespace rtgl
+{
+    /**
+     * Сравнение ключей (для упорядоченного хранения программ)
+     * @param other Другой ключ
+     * @return Меньше ли текущий ключ
+     */
+    bool ShaderPermutations::Key::operator<(const Key &other) const
+    {
+        return std::tie(rayDepth, lightTypes, refraction, shadows) <
+               std::tie(other.rayDepth, other.lightTypes, other.refraction, other.shadows);
+    }
+
+    /**
+     * Блок директив #define, соответствующий ключу
+     * @return Строка с директивами
+     */
+    std::string ShaderPermutations::Key::defines() const
+    {
+        return "#define RAY_DEPTH " + std::to_string(rayDepth) + "\n" +
+               "#define LIGHT_TYPES " + std::to_string(lightTypes) + "\n" +
+               "#define REFRACTION " + (refraction ? "1" : "0") + "\n" +
+               "#define SHADOWS " + (shadows ? "1" : "0") + "\n";
+    }
+
+    /**
+     * Конструктор набора
+     * @param shaderSources Ассоциативный массив (тип => исходный код шейдера), исходные коды копируются
+     * @param commonSources Общие исходные коды, вставляемые в шейдеры после блока определений (тип => исходный код)
+     */
+    ShaderPermutations::ShaderPermutations(std::unordered_map<GLuint, std::string> shaderSources,
+            std::unordered_map<GLuint, std::string> commonSources):
+            sources_(std::move(shaderSources)),
+            commonSources_(std::move(commonSources))
+    {}
+
+    /**
+     * Получить специализацию программы (собирается при первом обращении с данным ключом)
+     * @param key Ключ специализации
+     * @return Указатель на программу (действителен до уничтожения набора)
+     */
+    ShaderProgram *ShaderPermutations::get(const Key &key)
+    {
+        auto it = programs_.find(key);
+
+        // Программа собирается на месте (при ошибке сборки исключение выходит наружу, набор не меняется)
+        if(it == programs_.end()){
+            it = programs_.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(sources_, key.defines(), commonSources_)).first;
+        }
+
+        return &it->second;
+    }
+
+    /**
+     * Кол-во собранных специализаций
+     * @return Кол-во программ
+     */
+    size_t ShaderPermutations::getCount() const
+    {
+        return programs_.size();
+    }
+}
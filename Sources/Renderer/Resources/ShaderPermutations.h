@@ -0,0 +1,89 @@
+/**
+ * Набор специализаций шейдерной программы - один исходный код собирается с разными блоками #define
+ * Собранные программы кешируются по ключу специализации (каждая специализация собирается один раз)
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "ShaderProgram.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace rtgl
+{
+    class ShaderPermutations final
+    {
+    public:
+        /// Ключ специализации программы трассировки (значения параметров, известных до начала трассировки кадра)
+        struct Key
+        {
+            // Глубина трассировки (кол-во последовательных кастов луча)
+            GLuint rayDepth = 1;
+            // Маска используемых типов источников света (бит на значение LightSourceType)
+            GLuint lightTypes = 0;
+            // Есть ли на сцене преломляющие материалы
+            bool refraction = false;
+            // Проверяется ли видимость источников света теневыми лучами
+            bool shadows = false;
+
+            /**
+             * Сравнение ключей (для упорядоченного хранения программ)
+             * @param other Другой ключ
+             * @return Меньше ли текущий ключ
+             */
+            bool operator<(const Key& other) const;
+
+            /**
+             * Блок директив #define, соответствующий ключу
+             * @return Строка с директивами
+             */
+            [[nodiscard]] std::string defines() const;
+        };
+
+    private:
+        /// Исходные коды шейдеров программы (тип => исходный код)
+        std::unordered_map<GLuint, std::string> sources_;
+        /// Общие исходные коды, вставляемые в шейдеры после блока определений (тип => исходный код)
+        std::unordered_map<GLuint, std::string> commonSources_;
+        /// Собранные специализации программы
+        std::map<Key, ShaderProgram> programs_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        ShaderPermutations(const ShaderPermutations& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        ShaderPermutations& operator=(const ShaderPermutations& other) = delete;
+
+        /**
+         * Конструктор набора
+         * @param shaderSources Ассоциативный массив (тип => исходный код шейдера), исходные коды копируются
+         * @param commonSources Общие исходные коды, вставляемые в шейдеры после блока определений (тип => исходный код)
+         */
+        explicit ShaderPermutations(std::unordered_map<GLuint, std::string> shaderSources,
+                std::unordered_map<GLuint, std::string> commonSources = {});
+
+        /**
+         * Получить специализацию программы (собирается при первом обращении с данным ключом)
+         * @param key Ключ специализации
+         * @return Указатель на программу (действителен до уничтожения набора)
+         */
+        ShaderProgram* get(const Key& key);
+
+        /**
+         * Кол-во собранных специализаций
+         * @return Кол-во программ
+         */
+        [[nodiscard]] size_t getCount() const;
+    };
+}
@@ -14,15 +14,31 @@ namespace rtgl
      * Компиляция исходного кода шейдера
      * @param shaderSource Исходный код шейдера
      * @param type Тип шейдера
+     * @param defines Блок директив #define, вставляемый после директивы #version
+     * @param common Общий исходный код, вставляемый после блока определений
      * @return Идентификатор ресурса шейдера
      */
-    GLuint ShaderProgram::compileShader(const GLchar *shaderSource, GLuint type)
+    GLuint ShaderProgram::compileShader(const std::string& shaderSource, GLuint type, const std::string& defines, const std::string& common)
     {
         // Зарегистрировать шейдер нужного типа
         const GLuint id = glCreateShader(type);
 
+        // Директива #version должна быть первой - блок определений и общий код вставляются сразу за ней,
+        // после них нумерация строк восстанавливается (чтобы сообщения об ошибках указывали на строки исходного файла)
+        // Общий код нумеруется как отдельная строка-источник (номер 1), сам шейдер - как строка-источник 0
+        std::string version, body = shaderSource;
+        if((!defines.empty() || !common.empty()) && shaderSource.compare(0, 8, "#version") == 0){
+            const size_t lineEnd = shaderSource.find('\n');
+            version = shaderSource.substr(0, lineEnd == std::string::npos ? shaderSource.size() : lineEnd + 1);
+            body = shaderSource.substr(version.size());
+        }
+        std::string prefix = defines;
+        if(!common.empty()) prefix += "#line 1 1\n" + common + "\n";
+        if(!prefix.empty()) prefix += std::string("#line ") + (version.empty() ? "1" : "2") + " 0\n";
+
         // Связать исходный код и шейдер
-        glShaderSource(id, 1, &shaderSource, nullptr);
+        const GLchar* sources[3] = {version.c_str(), prefix.c_str(), body.c_str()};
+        glShaderSource(id, 3, sources, nullptr);
 
         // Компиляция шейдера
         glCompileShader(id);
@@ -60,12 +76,51 @@ namespace rtgl
         this->locations_.materialReflectToRefractRatio = glGetUniformLocation(id_, "_materialReflectToRefractRatio");
         this->locations_.materialRefractionCoff = glGetUniformLocation(id_, "_materialRefractionCoff");
         this->locations_.meshIndex = glGetUniformLocation(id_,"_meshIndex");
+        this->locations_.normalMatrix = glGetUniformLocation(id_,"_normalMatrix");
+        this->locations_.indexCount = glGetUniformLocation(id_,"_indexCount");
+        this->locations_.instanceCount = glGetUniformLocation(id_,"_instanceCount");
+
+        // Этап построения BVH
+        this->locations_.bvhBuildStage = glGetUniformLocation(id_, "_bvhBuildStage");
+        this->locations_.radixShift = glGetUniformLocation(id_, "_radixShift");
+        this->locations_.bvhHoleCount = glGetUniformLocation(id_, "_bvhHoleCount");
+        this->locations_.bvhGroupCount = glGetUniformLocation(id_, "_bvhGroupCount");
 
         // Этап трассировки
         this->locations_.aspectRatio = glGetUniformLocation(id_, "_aspectRatio");
         this->locations_.fov = glGetUniformLocation(id_, "_fov");
         this->locations_.camPosition = glGetUniformLocation(id_, "_camPosition");
         this->locations_.camModelMat = glGetUniformLocation(id_,"_camModelMat");
+        this->locations_.rayBounce = glGetUniformLocation(id_, "_rayBounce");
+        this->locations_.wavefrontStage = glGetUniformLocation(id_, "_wavefrontStage");
+        this->locations_.screenSize = glGetUniformLocation(id_, "_screenSize");
+        this->locations_.batchSize = glGetUniformLocation(id_, "_batchSize");
+        this->locations_.maxGroupCountX = glGetUniformLocation(id_, "_maxGroupCountX");
+        this->locations_.raySortInput = glGetUniformLocation(id_, "_raySortInput");
+        this->locations_.subgroupTraversal = glGetUniformLocation(id_, "_subgroupTraversal");
+        this->locations_.intersectionKernel = glGetUniformLocation(id_, "_intersectionKernel");
+        this->locations_.rayWeightThreshold = glGetUniformLocation(id_, "_rayWeightThreshold");
+        this->locations_.primaryVisibility = glGetUniformLocation(id_, "_primaryVisibility");
+        this->locations_.screenSpaceReflections = glGetUniformLocation(id_, "_screenSpaceReflections");
+        this->locations_.viewProjection = glGetUniformLocation(id_, "_viewProjection");
+        this->locations_.reflectionHistoryViewProjection = glGetUniformLocation(id_, "_reflectionHistoryViewProjection");
+        this->locations_.reflectionMaxSteps = glGetUniformLocation(id_, "_reflectionMaxSteps");
+        this->locations_.reflectionThickness = glGetUniformLocation(id_, "_reflectionThickness");
+        this->locations_.reflectionProbeCount = glGetUniformLocation(id_, "_reflectionProbeCount");
+        this->locations_.reflectionProbes = glGetUniformLocation(id_, "_reflectionProbes");
+        this->locations_.reflectionProbeLayers = glGetUniformLocation(id_, "_reflectionProbeLayers");
+        this->locations_.reflectionProbeRoughness = glGetUniformLocation(id_, "_reflectionProbeRoughness");
+        this->locations_.reflectionProbeBounceDepth = glGetUniformLocation(id_, "_reflectionProbeBounceDepth");
+        this->locations_.tracePass = glGetUniformLocation(id_, "_tracePass");
+        this->locations_.shadowMapCount = glGetUniformLocation(id_, "_shadowMapCount");
+        this->locations_.shadowMapTexelAngle = glGetUniformLocation(id_, "_shadowMapTexelAngle");
+
+        // Этап растеризации буфера видимости
+        this->locations_.visibilityInstance = glGetUniformLocation(id_, "_visibilityInstance");
+        this->locations_.visibilityTriangleOffset = glGetUniformLocation(id_, "_visibilityTriangleOffset");
+
+        // Этап растеризации карт теней
+        this->locations_.lightPosition = glGetUniformLocation(id_, "_lightPosition");
 
         // Этап пост-процессинга
         this->locations_.screenTexture = glGetUniformLocation(id_, "_screenTexture");
@@ -111,8 +166,11 @@ namespace rtgl
     /**
      * Конструктор ресурса
      * @param shaderSources Ассоциативный массив (тип => исходный код шейдера)
+     * @param defines Блок директив #define, вставляемый в каждый шейдер (специализация программы)
+     * @param commonSources Общие исходные коды, вставляемые в шейдеры после блока определений (тип => исходный код)
      */
-    ShaderProgram::ShaderProgram(const std::unordered_map<GLuint, std::string>& shaderSources)
+    ShaderProgram::ShaderProgram(const std::unordered_map<GLuint, std::string>& shaderSources, const std::string& defines,
+            const std::unordered_map<GLuint, std::string>& commonSources)
     {
         // Зарегистрировать шейдерную программу
         this->id_ = glCreateProgram();
@@ -126,8 +184,10 @@ namespace rtgl
             // Если код шейдера не пуст
             if (!shaderSource.second.empty())
             {
-                // Скомпилировать шейдер
-                GLuint shaderId = ShaderProgram::compileShader(shaderSource.second.c_str(), shaderSource.first);
+                // Скомпилировать шейдер (с общим кодом, если он задан для этого типа шейдера)
+                auto common = commonSources.find(shaderSource.first);
+                GLuint shaderId = ShaderProgram::compileShader(shaderSource.second, shaderSource.first, defines,
+                        common != commonSources.end() ? common->second : std::string());
                 // Добавить шейдер к программе
                 glAttachShader(this->id_, shaderId);
                 // Добавить в список ID'ов
@@ -160,6 +220,14 @@ namespace rtgl
         this->obtainLocations();
     }
 
+    /**
+     * Очистка ресурса
+     */
+    ShaderProgram::~ShaderProgram()
+    {
+        if (this->id_) glDeleteProgram(id_);
+    }
+
     /**
      * Получить дескриптор шейдерной программы
      * @return OpenGL дескриптор
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <string>
 #include <unordered_map>
 
 namespace rtgl
@@ -27,12 +28,51 @@ namespace rtgl
             GLuint materialRefractionCoff = 0;
 
             GLuint meshIndex = 0;
+            GLuint normalMatrix = 0;
+            GLuint indexCount = 0;
+            GLuint instanceCount = 0;
+
+            // Этап построения BVH
+            GLuint bvhBuildStage = 0;
+            GLuint radixShift = 0;
+            GLuint bvhHoleCount = 0;
+            GLuint bvhGroupCount = 0;
 
             // Этап трассировки
             GLuint aspectRatio = 0;
             GLuint fov = 0;
             GLuint camPosition = 0;
             GLuint camModelMat = 0;
+            GLuint rayBounce = 0;
+            GLuint wavefrontStage = 0;
+            GLuint screenSize = 0;
+            GLuint batchSize = 0;
+            GLuint maxGroupCountX = 0;
+            GLuint raySortInput = 0;
+            GLuint subgroupTraversal = 0;
+            GLuint intersectionKernel = 0;
+            GLuint rayWeightThreshold = 0;
+            GLuint primaryVisibility = 0;
+            GLuint screenSpaceReflections = 0;
+            GLuint viewProjection = 0;
+            GLuint reflectionHistoryViewProjection = 0;
+            GLuint reflectionMaxSteps = 0;
+            GLuint reflectionThickness = 0;
+            GLuint reflectionProbeCount = 0;
+            GLuint reflectionProbes = 0;
+            GLuint reflectionProbeLayers = 0;
+            GLuint reflectionProbeRoughness = 0;
+            GLuint reflectionProbeBounceDepth = 0;
+            GLuint tracePass = 0;
+            GLuint shadowMapCount = 0;
+            GLuint shadowMapTexelAngle = 0;
+
+            // Этап растеризации буфера видимости
+            GLuint visibilityInstance = 0;
+            GLuint visibilityTriangleOffset = 0;
+
+            // Этап растеризации карт теней
+            GLuint lightPosition = 0;
 
             // Этап пост-процессинга
             GLuint screenTexture;
@@ -48,9 +88,11 @@ namespace rtgl
          * Компиляция исходного кода шейдера
          * @param shaderSource Исходный код шейдера
          * @param type Тип шейдера
+         * @param defines Блок директив #define, вставляемый после директивы #version
+         * @param common Общий исходный код, вставляемый после блока определений
          * @return Идентификатор ресурса шейдера
          */
-        static GLuint compileShader(const GLchar* shaderSource, GLuint type);
+        static GLuint compileShader(const std::string& shaderSource, GLuint type, const std::string& defines, const std::string& common);
 
         /**
          * Получение локаций uniform-переменных
@@ -89,8 +131,16 @@ namespace rtgl
         /**
          * Конструктор ресурса
          * @param shaderSources Ассоциативный массив (тип => исходный код шейдера)
+         * @param defines Блок директив #define, вставляемый в каждый шейдер (специализация программы)
+         * @param commonSources Общие исходные коды, вставляемые в шейдеры после блока определений (тип => исходный код)
+         */
+        explicit ShaderProgram(const std::unordered_map<GLuint, std::string>& shaderSources, const std::string& defines = "",
+                const std::unordered_map<GLuint, std::string>& commonSources = {});
+
+        /**
+         * Очистка ресурса
          */
-        explicit ShaderProgram(const std::unordered_map<GLuint, std::string>& shaderSources);
+        ~ShaderProgram();
 
         /**
          * Получить дескриптор шейдерной программы
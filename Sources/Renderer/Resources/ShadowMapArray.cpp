@@ -0,0 +1,97 @@
+/**
+ * Массив кубических карт теней источников света - карта каждого источника является слоем одного массива кубических
+ * текстур (samplerCubeArray). Тексель хранит расстояние от источника до ближайшей поверхности мешей в его направлении
+ * Карты перерисовываются каждый кадр, слот карты - индекс источника света в кадре
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "ShadowMapArray.h"
+
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор ресурса
+     * @param faceSize Размер грани кубической карты (в пикселях)
+     * @param capacity Кол-во карт
+     * @param textureUnit Текстурный блок, к которому привязывается массив
+     */
+    ShadowMapArray::ShadowMapArray(GLuint faceSize, GLuint capacity, GLuint textureUnit):
+            textureId_(0),
+            depthBufferId_(0),
+            frameBufferId_(0),
+            faceSize_(faceSize),
+            capacity_(capacity)
+    {
+        // Массив кубических текстур (слой - грань, 6 слоев на карту), расстояния не интерполируются
+        glGenTextures(1, &textureId_);
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, textureId_);
+        glTexStorage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 1, GL_R32F, static_cast<GLsizei>(faceSize_), static_cast<GLsizei>(faceSize_), static_cast<GLsizei>(capacity_ * 6));
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glActiveTexture(GL_TEXTURE0);
+
+        // Буфер глубины грани
+        glGenRenderbuffers(1, &depthBufferId_);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBufferId_);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, static_cast<GLsizei>(faceSize_), static_cast<GLsizei>(faceSize_));
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &frameBufferId_);
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBufferId_);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBufferId_);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureId_, 0, 0);
+        const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if(status != GL_FRAMEBUFFER_COMPLETE){
+            glDeleteFramebuffers(1, &frameBufferId_);
+            glDeleteRenderbuffers(1, &depthBufferId_);
+            glDeleteTextures(1, &textureId_);
+            throw std::runtime_error("Can't create shadow map frame buffer");
+        }
+    }
+
+    /**
+     * Очистка ресурса
+     */
+    ShadowMapArray::~ShadowMapArray()
+    {
+        if(this->frameBufferId_) glDeleteFramebuffers(1, &frameBufferId_);
+        if(this->depthBufferId_) glDeleteRenderbuffers(1, &depthBufferId_);
+        if(this->textureId_) glDeleteTextures(1, &textureId_);
+    }
+
+    /**
+     * Привязка кадрового буфера к грани карты
+     * @param slot Индекс кубической карты
+     * @param face Индекс грани (в порядке GL_TEXTURE_CUBE_MAP_POSITIVE_X ... NEGATIVE_Z)
+     */
+    void ShadowMapArray::bindFace(GLuint slot, GLuint face)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBufferId_);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureId_, 0, static_cast<GLint>(slot * 6 + face));
+    }
+
+    /**
+     * Размер грани кубической карты
+     * @return Размер (в пикселях)
+     */
+    GLuint ShadowMapArray::getFaceSize() const
+    {
+        return faceSize_;
+    }
+
+    /**
+     * Кол-во карт
+     * @return Кол-во кубических карт в массиве
+     */
+    GLuint ShadowMapArray::getCapacity() const
+    {
+        return capacity_;
+    }
+}
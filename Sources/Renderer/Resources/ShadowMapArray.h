@@ -0,0 +1,74 @@
+/**
+ * Массив кубических карт теней источников света - карта каждого источника является слоем одного массива кубических
+ * текстур (samplerCubeArray). Тексель хранит расстояние от источника до ближайшей поверхности мешей в его направлении
+ * Карты перерисовываются каждый кадр, слот карты - индекс источника света в кадре
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+namespace rtgl
+{
+    class ShadowMapArray final
+    {
+    private:
+        /// OpenGL дескриптор массива кубических текстур (формат R32F)
+        GLuint textureId_;
+        /// OpenGL дескриптор буфера глубины грани (общий для всех граней)
+        GLuint depthBufferId_;
+        /// OpenGL дескриптор кадрового буфера, в который отрисовывается грань
+        GLuint frameBufferId_;
+        /// Размер грани (в пикселях)
+        GLuint faceSize_;
+        /// Кол-во карт
+        GLuint capacity_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        ShadowMapArray(const ShadowMapArray& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        ShadowMapArray& operator=(const ShadowMapArray& other) = delete;
+
+        /**
+         * Конструктор ресурса
+         * @param faceSize Размер грани кубической карты (в пикселях)
+         * @param capacity Кол-во карт
+         * @param textureUnit Текстурный блок, к которому привязывается массив
+         */
+        ShadowMapArray(GLuint faceSize, GLuint capacity, GLuint textureUnit);
+
+        /**
+         * Очистка ресурса
+         */
+        ~ShadowMapArray();
+
+        /**
+         * Привязка кадрового буфера к грани карты
+         * @param slot Индекс кубической карты
+         * @param face Индекс грани (в порядке GL_TEXTURE_CUBE_MAP_POSITIVE_X ... NEGATIVE_Z)
+         */
+        void bindFace(GLuint slot, GLuint face);
+
+        /**
+         * Размер грани кубической карты
+         * @return Размер (в пикселях)
+         */
+        [[nodiscard]] GLuint getFaceSize() const;
+
+        /**
+         * Кол-во карт
+         * @return Кол-во кубических карт в массиве
+         */
+        [[nodiscard]] GLuint getCapacity() const;
+    };
+}
@@ -0,0 +1,144 @@
+/**
+ * Класс разреженного октодерева вокселей - хранятся только узлы, содержащие заполненные воксели
+ * Октодерево не разбивается на кубы из треугольников: шейдер обходит его DDA без стека, пропуская
+ * пустые узлы целиком
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "VoxelOctree.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Код Мортона координат вокселя (бит x - младший в каждой тройке, как индекс октанта в шейдере)
+     * @param voxel Координаты вокселя
+     * @param levels Кол-во уровней
+     * @return Код Мортона
+     */
+    static GLuint VoxelMortonCode(const glm::uvec3& voxel, GLuint levels)
+    {
+        GLuint code = 0;
+        for(GLuint bit = 0; bit < levels; bit++){
+            code |= ((voxel.x >> bit) & 1u) << (bit * 3);
+            code |= ((voxel.y >> bit) & 1u) << (bit * 3 + 1);
+            code |= ((voxel.z >> bit) & 1u) << (bit * 3 + 2);
+        }
+        return code;
+    }
+
+    /**
+     * Конструктор октодерева (воксели сортируются по коду Мортона, узлы строятся по уровням)
+     * @param voxels Координаты заполненных вокселей (тройки x, y, z в диапазоне [0, 2^levels))
+     * @param levels Кол-во уровней (от 1 до MAX_LEVELS)
+     */
+    VoxelOctree::VoxelOctree(const std::vector<glm::uvec3> &voxels, GLuint levels):
+            levels_(levels),
+            voxelCount_(0),
+            boundsMin_(0.0f),
+            boundsMax_(0.0f)
+    {
+        if(levels_ < 1 || levels_ > MAX_LEVELS) throw std::runtime_error("Voxel octree level count must be in range [1, 10]");
+
+        const GLuint resolution = 1u << levels_;
+        glm::uvec3 voxelMin(resolution);
+        glm::uvec3 voxelMax(0u);
+
+        // Коды Мортона без повторов - воксели каждого узла образуют непрерывный диапазон
+        std::vector<GLuint> codes;
+        codes.reserve(voxels.size());
+        for(const glm::uvec3& voxel : voxels)
+        {
+            if(voxel.x >= resolution || voxel.y >= resolution || voxel.z >= resolution)
+                throw std::runtime_error("Voxel coordinates are out of octree grid");
+
+            codes.push_back(VoxelMortonCode(voxel, levels_));
+            voxelMin = glm::min(voxelMin, voxel);
+            voxelMax = glm::max(voxelMax, voxel);
+        }
+        std::sort(codes.begin(), codes.end());
+        codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+        voxelCount_ = codes.size();
+
+        // Границы в пространстве объекта (воксель - куб со стороной 2 / resolution)
+        if(!codes.empty()){
+            const GLfloat voxelSize = 2.0f / static_cast<GLfloat>(resolution);
+            boundsMin_ = glm::vec3(voxelMin) * voxelSize - 1.0f;
+            boundsMax_ = glm::vec3(voxelMax + 1u) * voxelSize - 1.0f;
+        }
+
+        // Диапазон кодов каждого узла и его глубина (узлы обрабатываются в порядке обхода в ширину,
+        // поэтому потомки каждого узла добавляются в конец массива подряд)
+        struct Range { size_t begin; size_t end; GLuint depth; };
+        std::vector<Range> ranges = {{0, codes.size(), 0}};
+        nodes_.push_back(0);
+
+        for(size_t i = 0; i < nodes_.size(); i++)
+        {
+            const Range range = ranges[i];
+            const GLuint shift = (levels_ - 1 - range.depth) * 3;
+            const bool last = range.depth + 1 == levels_;
+            const size_t firstChild = nodes_.size();
+
+            if(firstChild + 8 > (1u << 24)) throw std::runtime_error("Too many voxel octree nodes");
+
+            GLuint mask = 0;
+            for(size_t begin = range.begin; begin < range.end;)
+            {
+                // Диапазон вокселей одного октанта
+                const GLuint octant = (codes[begin] >> shift) & 7u;
+                size_t end = begin + 1;
+                while(end < range.end && ((codes[end] >> shift) & 7u) == octant) end++;
+
+                mask |= 1u << octant;
+                if(!last){
+                    ranges.push_back({begin, end, range.depth + 1});
+                    nodes_.push_back(0);
+                }
+                begin = end;
+            }
+
+            nodes_[i] = mask | (last ? 0u : static_cast<GLuint>(firstChild) << 8);
+        }
+    }
+
+    /**
+     * Кол-во вокселей по каждой оси сетки
+     * @return Кол-во вокселей
+     */
+    GLuint VoxelOctree::getResolution() const
+    {
+        return 1u << levels_;
+    }
+
+    /**
+     * Кол-во заполненных вокселей
+     * @return Кол-во вокселей
+     */
+    size_t VoxelOctree::getVoxelCount() const
+    {
+        return voxelCount_;
+    }
+
+    /**
+     * Границы заполненных вокселей в пространстве объекта
+     * @param min Минимальная точка
+     * @param max Максимальная точка
+     */
+    void VoxelOctree::getBounds(glm::vec3 &min, glm::vec3 &max) const
+    {
+        min = boundsMin_;
+        max = boundsMax_;
+    }
+
+    /**
+     * Узлы октодерева (в порядке размещения в буфере)
+     * @return Ссылка на массив узлов
+     */
+    const std::vector<GLuint> &VoxelOctree::getNodes() const
+    {
+        return nodes_;
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * Класс разреженного октодерева вокселей - хранятся только узлы, содержащие заполненные воксели
+ * Октодерево не разбивается на кубы из треугольников: шейдер обходит его DDA без стека, пропуская
+ * пустые узлы целиком
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "../Types.h"
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace rtgl
+{
+    class VoxelOctree final
+    {
+    public:
+        /// Предельное кол-во уровней (сторона сетки - 2^levels вокселей)
+        static constexpr GLuint MAX_LEVELS = 10;
+
+    private:
+        /// Кол-во уровней октодерева
+        GLuint levels_;
+        /// Кол-во заполненных вокселей (без повторов)
+        size_t voxelCount_;
+        /// Границы заполненных вокселей в пространстве объекта (сетка занимает куб [-1, 1])
+        glm::vec3 boundsMin_;
+        glm::vec3 boundsMax_;
+        /// Узлы в порядке обхода в ширину (младшие 8 бит - маска потомков, старшие 24 - индекс первого потомка)
+        /// Потомки узла лежат подряд, только существующие; у узлов последнего уровня маска - заполненность вокселей
+        std::vector<GLuint> nodes_;
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        VoxelOctree(const VoxelOctree& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        VoxelOctree& operator=(const VoxelOctree& other) = delete;
+
+        /**
+         * Конструктор октодерева (воксели сортируются по коду Мортона, узлы строятся по уровням)
+         * @param voxels Координаты заполненных вокселей (тройки x, y, z в диапазоне [0, 2^levels))
+         * @param levels Кол-во уровней (от 1 до MAX_LEVELS)
+         */
+        VoxelOctree(const std::vector<glm::uvec3>& voxels, GLuint levels);
+
+        /**
+         * Кол-во вокселей по каждой оси сетки
+         * @return Кол-во вокселей
+         */
+        [[nodiscard]] GLuint getResolution() const;
+
+        /**
+         * Кол-во заполненных вокселей
+         * @return Кол-во вокселей
+         */
+        [[nodiscard]] size_t getVoxelCount() const;
+
+        /**
+         * Границы заполненных вокселей в пространстве объекта
+         * @param min Минимальная точка
+         * @param max Максимальная точка
+         */
+        void getBounds(glm::vec3& min, glm::vec3& max) const;
+
+        /**
+         * Узлы октодерева (в порядке размещения в буфере)
+         * @return Ссылка на массив узлов
+         */
+        [[nodiscard]] const std::vector<GLuint>& getNodes() const;
+    };
+}
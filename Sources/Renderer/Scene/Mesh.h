@@ -31,6 +31,12 @@ namespace rtgl
         /// Дескриптор буфера геометрии
         GeometryBuffer* geometry;
 
+        /// Дескриптор упрощенной геометрии (обходится вторичными и теневыми лучами, nullptr - обходится основная)
+        GeometryBuffer* proxy = nullptr;
+
+        /// Расстояние от камеры, начиная с которого упрощенную геометрию обходят и первичные лучи (0 - только вторичные)
+        GLfloat proxyDistance = 0.0f;
+
         /// Параметры материала меша
         Material material;
 
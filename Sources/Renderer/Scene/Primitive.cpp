@@ -0,0 +1,52 @@
+/**
+ * Класс аналитического примитива (сфера, плоскость, диск, куб, цилиндр, карта высот, воксели)
+ * Пересечение с лучом вычисляется шейдером напрямую по канонической форме, без разбиения на треугольники
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "Primitive.h"
+
+#include <limits>
+
+namespace rtgl
+{
+    /**
+     * Получить мировые границы примитива (границы канонической формы, переведенные матрицей модели)
+     * @param min Минимальная точка
+     * @param max Максимальная точка
+     */
+    void Primitive::getWorldBounds(glm::vec3 &min, glm::vec3 &max) const
+    {
+        // Плоские примитивы лежат в плоскости XY пространства объекта, карта высот ограничена по Y своими высотами,
+        // октодерево - границами заполненных вокселей
+        const bool flat = type == PrimitiveType::PRIMITIVE_PLANE || type == PrimitiveType::PRIMITIVE_DISC;
+        glm::vec3 localMin = {-1.0f, -1.0f, flat ? 0.0f : -1.0f};
+        glm::vec3 localMax = {1.0f, 1.0f, flat ? 0.0f : 1.0f};
+        if(type == PrimitiveType::PRIMITIVE_HEIGHTFIELD && heightfield != nullptr){
+            localMin.y = heightfield->getMinHeight();
+            localMax.y = heightfield->getMaxHeight();
+        }
+        if(type == PrimitiveType::PRIMITIVE_VOXELS && voxels != nullptr){
+            voxels->getBounds(localMin, localMax);
+        }
+        const glm::mat4& model = this->getModelMatrix();
+
+        min = glm::vec3(std::numeric_limits<GLfloat>::max());
+        max = glm::vec3(-std::numeric_limits<GLfloat>::max());
+
+        for(int corner = 0; corner < 8; corner++)
+        {
+            const glm::vec3 local = {
+                    (corner & 1) ? localMax.x : localMin.x,
+                    (corner & 2) ? localMax.y : localMin.y,
+                    (corner & 4) ? localMax.z : localMin.z};
+            const glm::vec3 world = glm::vec3(model * glm::vec4(local, 1.0f));
+            min = glm::min(min, world);
+            max = glm::max(max, world);
+        }
+
+        // Небольшой запас (границы плоских примитивов иначе вырождаются по одной из осей)
+        min -= glm::vec3(1e-4f);
+        max += glm::vec3(1e-4f);
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * Класс аналитического примитива (сфера, плоскость, диск, куб, цилиндр, карта высот, воксели)
+ * Пересечение с лучом вычисляется шейдером напрямую по канонической форме, без разбиения на треугольники
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "SceneElement.h"
+#include "../Resources/Heightfield.h"
+#include "../Resources/VoxelOctree.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace rtgl
+{
+    class Primitive final : public SceneElement
+    {
+        /// Описание метариала (PBR, как у меша)
+        struct Material
+        {
+            glm::vec3 albedo = { 1.0f,1.0f,1.0f };
+            GLfloat metallic = 0.0f;
+            GLfloat roughness = 1.0f;
+            GLfloat primaryToSecondary = 1.0f;
+            GLfloat reflectionToRefraction = 1.0f;
+            GLfloat refractionCoff = 0.6f;
+        };
+
+    public:
+        /// Тип примитива (каноническая форма в пространстве объекта)
+        PrimitiveType type = PrimitiveType::PRIMITIVE_SPHERE;
+
+        /// Параметры материала примитива
+        Material material;
+
+        /// Карта высот (только для типа PRIMITIVE_HEIGHTFIELD)
+        const Heightfield* heightfield = nullptr;
+
+        /// Октодерево вокселей (только для типа PRIMITIVE_VOXELS)
+        const VoxelOctree* voxels = nullptr;
+
+        /**
+         * Получить мировые границы примитива (границы канонической формы, переведенные матрицей модели)
+         * @param min Минимальная точка
+         * @param max Максимальная точка
+         */
+        void getWorldBounds(glm::vec3& min, glm::vec3& max) const;
+    };
+}
@@ -0,0 +1,20 @@
+/**
+ * Класс зонда отражений - кубическая карта окружения, отрисовываемая трассировкой из точки зонда
+ * Отражения шероховатых поверхностей и глубоких отскоков в радиусе зонда берутся из его карты вместо трассировки
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "SceneElement.h"
+#include <GL/glew.h>
+
+namespace rtgl
+{
+    class ReflectionProbe final : public SceneElement
+    {
+    public:
+        /// Радиус влияния (точки дальше от зонда его карту не используют)
+        GLfloat radius = 10.0f;
+    };
+}
@@ -0,0 +1,219 @@
+/**
+ * Сохраняемая (retained) сцена - меши добавляются один раз и занимают постоянные участки буфера треугольников
+ * Повторно подготавливаются только меши, изменившиеся с момента предыдущей подготовки
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#include "RetainedScene.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace rtgl
+{
+    /**
+     * Конструктор сцены
+     * @param maxTriangles Предельная вместимость буфера треугольников (буфер увеличивается по мере заполнения)
+     * @param maxMeshes Предельное кол-во мешей
+     */
+    RetainedScene::RetainedScene(GLuint maxTriangles, GLuint maxMeshes):
+            triangleHighWater_(0),
+            meshHighWater_(0),
+            liveTriangles_(0),
+            maxTriangles_(maxTriangles),
+            maxMeshes_(maxMeshes)
+    {}
+
+    /**
+     * Выделение участка буфера треугольников (первый подходящий свободный участок, затем граница)
+     * @param count Кол-во треугольников
+     * @return Сдвиг участка
+     */
+    GLuint RetainedScene::allocateTriangles(GLuint count)
+    {
+        for(auto it = freeTriangles_.begin(); it != freeTriangles_.end(); ++it)
+        {
+            if(it->second < count) continue;
+
+            // Остаток участка остается свободным
+            const GLuint offset = it->first;
+            const GLuint rest = it->second - count;
+            freeTriangles_.erase(it);
+            if(rest > 0) freeTriangles_[offset + count] = rest;
+            return offset;
+        }
+
+        if(maxTriangles_ - triangleHighWater_ < count)
+            throw std::runtime_error("Not enough space in triangle buffer");
+
+        const GLuint offset = triangleHighWater_;
+        triangleHighWater_ += count;
+        return offset;
+    }
+
+    /**
+     * Освобождение участка буфера треугольников (с объединением соседних участков)
+     * @param offset Сдвиг участка
+     * @param count Кол-во треугольников
+     */
+    void RetainedScene::freeTriangles(GLuint offset, GLuint count)
+    {
+        if(count == 0) return;
+
+        // Объединение с последующим участком
+        auto next = freeTriangles_.find(offset + count);
+        if(next != freeTriangles_.end()){
+            count += next->second;
+            freeTriangles_.erase(next);
+        }
+
+        // Объединение с предыдущим участком
+        auto it = freeTriangles_.lower_bound(offset);
+        if(it != freeTriangles_.begin()){
+            auto prev = std::prev(it);
+            if(prev->first + prev->second == offset){
+                offset = prev->first;
+                count += prev->second;
+                freeTriangles_.erase(prev);
+            }
+        }
+
+        // Участок у границы не хранится - граница сдвигается
+        if(offset + count == triangleHighWater_) triangleHighWater_ = offset;
+        else freeTriangles_[offset] = count;
+    }
+
+    /**
+     * Добавлен ли меш на сцену
+     * @param mesh Меш
+     * @return Да или нет
+     */
+    bool RetainedScene::contains(const Mesh *mesh) const
+    {
+        return std::any_of(slots_.begin(), slots_.end(), [&](const Slot& slot){ return slot.mesh == mesh; });
+    }
+
+    /**
+     * Добавление меша (выделение слота и участка буфера треугольников)
+     * @param mesh Меш
+     * @return Слот меша
+     */
+    const RetainedScene::Slot& RetainedScene::add(Mesh *mesh)
+    {
+        if(mesh == nullptr || mesh->geometry == nullptr) throw std::runtime_error("No mesh provided");
+        if(contains(mesh)) throw std::runtime_error("Mesh is already in scene");
+        if(freeMeshIndices_.empty() && meshHighWater_ >= maxMeshes_) throw std::runtime_error("Too many meshes");
+
+        Slot slot;
+        slot.mesh = mesh;
+        slot.triangleCount = mesh->geometry->getIndexCount() / 3;
+        slot.firstTriangle = allocateTriangles(slot.triangleCount);
+
+        // Наименьший свободный индекс меша, иначе новый
+        if(!freeMeshIndices_.empty()){
+            auto it = std::min_element(freeMeshIndices_.begin(), freeMeshIndices_.end());
+            slot.meshIndex = *it;
+            freeMeshIndices_.erase(it);
+        }
+        else{
+            slot.meshIndex = meshHighWater_++;
+        }
+
+        liveTriangles_ += slot.triangleCount;
+        slots_.push_back(slot);
+        return slots_.back();
+    }
+
+    /**
+     * Удаление меша (освобождение слота и участка буфера треугольников)
+     * @param mesh Меш
+     * @return Освобожденный слот меша
+     */
+    RetainedScene::Slot RetainedScene::remove(const Mesh *mesh)
+    {
+        auto it = std::find_if(slots_.begin(), slots_.end(), [&](const Slot& slot){ return slot.mesh == mesh; });
+        if(it == slots_.end()) throw std::runtime_error("Mesh is not in scene");
+
+        const Slot slot = *it;
+        slots_.erase(it);
+
+        liveTriangles_ -= slot.triangleCount;
+        freeTriangles(slot.firstTriangle, slot.triangleCount);
+
+        // Освободившиеся индексы у границы не хранятся - граница сдвигается
+        freeMeshIndices_.push_back(slot.meshIndex);
+        for(auto top = std::find(freeMeshIndices_.begin(), freeMeshIndices_.end(), meshHighWater_ - 1);
+            top != freeMeshIndices_.end();
+            top = std::find(freeMeshIndices_.begin(), freeMeshIndices_.end(), meshHighWater_ - 1))
+        {
+            freeMeshIndices_.erase(top);
+            meshHighWater_--;
+        }
+
+        return slot;
+    }
+
+    /**
+     * Отметить все меши как требующие подготовки
+     */
+    void RetainedScene::invalidate()
+    {
+        for(Slot& slot : slots_) slot.prepared = false;
+    }
+
+    /**
+     * Получить слоты мешей, изменившихся с момента последней подготовки (слоты отмечаются как подготовленные)
+     * @param dirty Вектор для записи слотов
+     */
+    void RetainedScene::collectDirty(std::vector<const Slot *> &dirty)
+    {
+        dirty.clear();
+
+        for(Slot& slot : slots_)
+        {
+            const size_t version = slot.mesh->getVersion();
+            if(slot.prepared && slot.preparedVersion == version) continue;
+
+            slot.prepared = true;
+            slot.preparedVersion = version;
+            dirty.push_back(&slot);
+        }
+    }
+
+    /**
+     * Получить слоты всех мешей сцены
+     * @return Ссылка на вектор слотов
+     */
+    const std::vector<RetainedScene::Slot> &RetainedScene::getSlots() const
+    {
+        return slots_;
+    }
+
+    /**
+     * Граница занятой части буфера треугольников (треугольники остальных мешей записываются после нее)
+     * @return Кол-во треугольников
+     */
+    GLuint RetainedScene::getTriangleHighWater() const
+    {
+        return triangleHighWater_;
+    }
+
+    /**
+     * Кол-во незанятых треугольников ниже границы (пустоты, заполненные пустыми треугольниками)
+     * @return Кол-во треугольников
+     */
+    GLuint RetainedScene::getTriangleHoleCount() const
+    {
+        return triangleHighWater_ - liveTriangles_;
+    }
+
+    /**
+     * Граница занятых индексов мешей (индексы остальных мешей начинаются с нее)
+     * @return Кол-во индексов
+     */
+    GLuint RetainedScene::getMeshHighWater() const
+    {
+        return meshHighWater_;
+    }
+}
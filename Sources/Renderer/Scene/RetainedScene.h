@@ -0,0 +1,143 @@
+/**
+ * Сохраняемая (retained) сцена - меши добавляются один раз и занимают постоянные участки буфера треугольников
+ * Повторно подготавливаются только меши, изменившиеся с момента предыдущей подготовки
+ * Copyright (C) 2020 by Alex "DarkWolf" Nem - https://github.com/darkoffalex
+ */
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <map>
+#include <vector>
+
+namespace rtgl
+{
+    class RetainedScene final
+    {
+    public:
+        /// Слот меша сцены
+        struct Slot
+        {
+            // Меш
+            Mesh* mesh = nullptr;
+            // Индекс меша (в счетчиках и границах мешей)
+            GLuint meshIndex = 0;
+            // Участок буфера треугольников
+            GLuint firstTriangle = 0;
+            GLuint triangleCount = 0;
+            // Версия меша на момент последней подготовки
+            size_t preparedVersion = 0;
+            // Подготовлен ли меш хотя бы раз
+            bool prepared = false;
+        };
+
+    private:
+        /// Слоты мешей сцены
+        std::vector<Slot> slots_;
+        /// Свободные участки буфера треугольников (сдвиг -> размер), соседние участки объединяются
+        std::map<GLuint, GLuint> freeTriangles_;
+        /// Свободные индексы мешей (ниже границы занятых индексов)
+        std::vector<GLuint> freeMeshIndices_;
+        /// Граница занятой части буфера треугольников
+        GLuint triangleHighWater_;
+        /// Граница занятых индексов мешей
+        GLuint meshHighWater_;
+        /// Кол-во треугольников всех мешей сцены
+        GLuint liveTriangles_;
+        /// Предельная вместимость буфера треугольников и предельное кол-во мешей
+        GLuint maxTriangles_;
+        GLuint maxMeshes_;
+
+        /**
+         * Выделение участка буфера треугольников (первый подходящий свободный участок, затем граница)
+         * @param count Кол-во треугольников
+         * @return Сдвиг участка
+         */
+        GLuint allocateTriangles(GLuint count);
+
+        /**
+         * Освобождение участка буфера треугольников (с объединением соседних участков)
+         * @param offset Сдвиг участка
+         * @param count Кол-во треугольников
+         */
+        void freeTriangles(GLuint offset, GLuint count);
+
+    public:
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объект
+         */
+        RetainedScene(const RetainedScene& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объект
+         * @return Ссылка на текущий объект
+         */
+        RetainedScene& operator=(const RetainedScene& other) = delete;
+
+        /**
+         * Конструктор сцены
+         * @param maxTriangles Предельная вместимость буфера треугольников (буфер увеличивается по мере заполнения)
+         * @param maxMeshes Предельное кол-во мешей
+         */
+        RetainedScene(GLuint maxTriangles, GLuint maxMeshes);
+
+        /**
+         * Добавлен ли меш на сцену
+         * @param mesh Меш
+         * @return Да или нет
+         */
+        [[nodiscard]] bool contains(const Mesh* mesh) const;
+
+        /**
+         * Добавление меша (выделение слота и участка буфера треугольников)
+         * @param mesh Меш
+         * @return Слот меша
+         */
+        const Slot& add(Mesh* mesh);
+
+        /**
+         * Удаление меша (освобождение слота и участка буфера треугольников)
+         * @param mesh Меш
+         * @return Освобожденный слот меша
+         */
+        Slot remove(const Mesh* mesh);
+
+        /**
+         * Отметить все меши как требующие подготовки
+         */
+        void invalidate();
+
+        /**
+         * Получить слоты мешей, изменившихся с момента последней подготовки (слоты отмечаются как подготовленные)
+         * @param dirty Вектор для записи слотов
+         */
+        void collectDirty(std::vector<const Slot*>& dirty);
+
+        /**
+         * Получить слоты всех мешей сцены
+         * @return Ссылка на вектор слотов
+         */
+        [[nodiscard]] const std::vector<Slot>& getSlots() const;
+
+        /**
+         * Граница занятой части буфера треугольников (треугольники остальных мешей записываются после нее)
+         * @return Кол-во треугольников
+         */
+        [[nodiscard]] GLuint getTriangleHighWater() const;
+
+        /**
+         * Кол-во незанятых треугольников ниже границы (пустоты, заполненные пустыми треугольниками)
+         * @return Кол-во треугольников
+         */
+        [[nodiscard]] GLuint getTriangleHoleCount() const;
+
+        /**
+         * Граница занятых индексов мешей (индексы остальных мешей начинаются с нее)
+         * @return Кол-во индексов
+         */
+        [[nodiscard]] GLuint getMeshHighWater() const;
+    };
+}
@@ -112,6 +112,7 @@ namespace rtgl
                 // 1 - сдвигаем в противоположном направлении от начала координат
                 glm::translate(glm::mat4(1), -this->origin_);
 
+        this->markChanged();
     }
 
     /**
@@ -246,4 +247,21 @@ namespace rtgl
     {
         return origin_;
     }
+
+    /**
+     * Отметить объект как изменившийся (увеличение версии)
+     */
+    void SceneElement::markChanged()
+    {
+        this->version_++;
+    }
+
+    /**
+     * Получить версию объекта
+     * @return Номер версии
+     */
+    size_t SceneElement::getVersion() const
+    {
+        return version_;
+    }
 }
@@ -26,6 +26,8 @@ namespace rtgl
         glm::vec3 scale_;
         /// Начальная точка (локальный центр)
         glm::vec3 origin_;
+        /// Версия объекта (увеличивается при каждом изменении, используется для отслеживания изменившихся объектов)
+        size_t version_ = 0;
 
         /**
          * Построить матрицу смещения
@@ -151,6 +153,17 @@ namespace rtgl
          * @return Точка локального центра
          */
         [[nodiscard]] const glm::vec3& getOrigin() const;
+
+        /**
+         * Отметить объект как изменившийся (увеличение версии)
+         */
+        void markChanged();
+
+        /**
+         * Получить версию объекта
+         * @return Номер версии
+         */
+        [[nodiscard]] size_t getVersion() const;
     };
 }
 
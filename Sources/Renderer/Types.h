@@ -21,6 +21,10 @@ namespace rtgl
     typedef void* HSceneElement;
     typedef void* HMesh;
     typedef void* HLightSource;
+    typedef void* HPrimitive;
+    typedef void* HHeightfield;
+    typedef void* HVoxelOctree;
+    typedef void* HReflectionProbe;
 
     /// П Е Р Е Ч И С Л Я Е М Ы Е
 
@@ -42,11 +46,80 @@ namespace rtgl
      */
     enum LightSourceType { LIGHT_POINT, LIGHT_SPOT, LIGHT_DIRECTIONAL };
 
+    /**
+     * Типы аналитических примитивов (пересечение с лучом вычисляется напрямую, без разбиения на треугольники)
+     * Каноническая форма вписана в куб [-1, 1] пространства объекта: сфера радиуса 1, квадрат и диск в плоскости XY
+     * (нормаль +Z), куб, цилиндр радиуса 1 вдоль оси Y (с основаниями). Размеры задаются масштабом
+     * Карта высот занимает квадрат [-1, 1] плоскости XZ, высота по оси Y берется из отсчетов
+     * Сетка октодерева вокселей занимает куб [-1, 1]
+     */
+    enum PrimitiveType { PRIMITIVE_SPHERE, PRIMITIVE_PLANE, PRIMITIVE_DISC, PRIMITIVE_BOX, PRIMITIVE_CYLINDER, PRIMITIVE_HEIGHTFIELD, PRIMITIVE_VOXELS };
+
     /**
      * Этапы рендеринга сцены (проходы)
      * Рендеринг состоит из нескольких отдельных этапов, у каждого может быть своя шейдерная программа
      */
-    enum RenderingStage { RS_GEOMETRY_PREPARE, RS_RAY_TRACING, RS_POST_PROCESS, RS_NONE };
+    enum RenderingStage { RS_GEOMETRY_PREPARE, RS_BVH_BUILD, RS_RAY_TRACING, RS_POST_PROCESS, RS_NONE };
+
+    /**
+     * Типы структуры ускорения трассировки
+     * AS_SCENE_LBVH - треугольники мешей переводятся в мировое пространство каждый кадр, BVH строится на GPU
+     * AS_TWO_LEVEL - BLAS геометрии строится один раз (в пространстве объекта), каждый кадр строится только TLAS над мешами
+     */
+    enum AccelerationStructureType { AS_SCENE_LBVH, AS_TWO_LEVEL };
+
+    /**
+     * Способы подготовки геометрии (используется со структурой ускорения AS_SCENE_LBVH)
+     * GP_GEOMETRY_SHADER - вершинный и геометрический шейдеры записывают треугольники в буфер во время отрисовки меша
+     * GP_COMPUTE_SHADER - вычислительный шейдер читает VBO/EBO геометрии напрямую, растеризатор не используется
+     */
+    enum GeometryPrepareMode { GP_GEOMETRY_SHADER, GP_COMPUTE_SHADER };
+
+    /**
+     * Способы трассировки лучей
+     * RT_FRAGMENT_SHADER - каждый фрагмент экранного квадрата трассирует все лучи своего пикселя (megakernel)
+     * RT_WAVEFRONT - генерация, поиск пересечений и освещение выполняются отдельными вычислительными шейдерами,
+     * лучи каждого отскока передаются между ними через очереди (без лучей, завершившихся на предыдущем отскоке)
+     * RT_PERSISTENT_THREADS - фиксированное кол-во рабочих групп (по размеру устройства) получает порции пикселей
+     * из общего атомарного счетчика, пока пиксели кадра не закончатся (дорогие участки кадра не простаивают GPU)
+     */
+    enum RayTracingMode { RT_FRAGMENT_SHADER, RT_WAVEFRONT, RT_PERSISTENT_THREADS };
+
+    /**
+     * Ядра проверки пересечений при обходе структуры ускорения (выбираются для сравнения производительности)
+     * IK_REFERENCE - метод плит с делением на направление луча при каждой проверке, Моллер - Трумбор с делением до отбраковки
+     * IK_PRECOMPUTED - обратное направление луча вычисляется один раз перед обходом (проверка плит без делений),
+     * барицентрические координаты треугольника отбраковываются до деления на определитель
+     */
+    enum IntersectionKernel { IK_REFERENCE, IK_PRECOMPUTED };
+
+    /**
+     * Способы получения отражений первичных лучей
+     * RM_TRACED - отраженный луч всегда трассируется
+     * RM_SCREEN_SPACE - отраженный луч сначала проходится в экранном пространстве по буферу видимости текущего кадра,
+     * цвет найденной точки берется из изображения предыдущего кадра. Луч трассируется, только если он покинул экран
+     * или пересечение не найдено
+     */
+    enum ReflectionMode { RM_TRACED, RM_SCREEN_SPACE };
+
+    /**
+     * Разрешение вторичных лучей (отражения, преломления и последующие отскоки) при трассировке фрагментным шейдером
+     * SRR_FULL - все лучи трассируются в полном разрешении
+     * SRR_HALF, SRR_QUARTER - первичные лучи трассируются в полном разрешении, вторичные - в половинном (четвертном)
+     * по каждой оси. Цвет вторичных лучей повышается до полного разрешения совместным билатеральным фильтром
+     * по нормалям и расстояниям первичных пересечений (требуется программа пост-процессинга)
+     */
+    enum SecondaryRayResolution { SRR_FULL, SRR_HALF, SRR_QUARTER };
+
+    /**
+     * Способы получения теней
+     * SM_TRACED - к каждому источнику света из каждой точки выпускается теневой луч
+     * SM_HYBRID - для источников света растеризуются кубические карты теней (расстояния до ближайших мешей), по ним
+     * точка классифицируется как освещенная, полностью затененная или находящаяся в полутени. Теневые лучи выпускаются
+     * только в полутени (к точкам на диске источника радиуса radius). Используется со структурой ускорения AS_TWO_LEVEL,
+     * требуется программа карт теней
+     */
+    enum ShadowMode { SM_TRACED, SM_HYBRID };
 
     /// С Т Р У К Т У Р Ы
 
@@ -60,14 +133,104 @@ namespace rtgl
         const char* geometryPrepareVs = nullptr;
         const char* geometryPrepareGs = nullptr;
         const char* geometryPrepareFs = nullptr;
+        const char* geometryPrepareCs = nullptr;
+
+        // Этап построения BVH
+        const char* bvhBuildCs = nullptr;
 
         // Этап трасировки геометрии
         const char* rayTracingVs = nullptr;
         const char* rayTracingFs = nullptr;
+        const char* rayTracingCs = nullptr;
+        // Общая часть фрагментного и вычислительного шейдеров трассировки (вставляется в оба)
+        const char* rayTracingCommon = nullptr;
+
+        // Растеризация буфера видимости первичных лучей (не обязательна)
+        const char* visibilityVs = nullptr;
+        const char* visibilityGs = nullptr;
+        const char* visibilityFs = nullptr;
 
         // Этап пост-процессинга
         const char* postProcessVs = nullptr;
         const char* postProcessFs = nullptr;
+
+        // Растеризация карт теней источников света (не обязательна)
+        const char* shadowMapVs = nullptr;
+        const char* shadowMapFs = nullptr;
+    };
+
+    /**
+     * Начальная вместимость буферов сцены
+     * При превышении буферы увеличиваются автоматически (в пределах максимального размера буфера хранения)
+     */
+    struct SceneLimits
+    {
+        // Кол-во треугольников в буфере треугольников
+        unsigned triangles = 10000;
+        // Кол-во мешей
+        unsigned meshes = 10;
+        // Кол-во источников света
+        unsigned lights = 10;
+    };
+
+    /**
+     * Статистика кадра
+     * Время измеряется на GPU (timer query) и соответствует последнему завершенному кадру
+     */
+    struct FrameStatistics
+    {
+        // Время подготовки геометрии (мс)
+        float geometryPrepareTime = 0.0f;
+
+        // Время трассировки лучей - всех отскоков всех пикселей, включая сортировку вторичных лучей (мс)
+        float rayTracingTime = 0.0f;
+
+        // Время растеризации буфера видимости первичных лучей (мс, 0 если первичные лучи трассируются)
+        float primaryVisibilityTime = 0.0f;
+
+        // Кол-во треугольников в буфере треугольников (включая пустоты сохраняемой сцены), мешей, источников света
+        // и аналитических примитивов
+        unsigned triangleCount = 0;
+        unsigned meshCount = 0;
+        unsigned lightCount = 0;
+        unsigned primitiveCount = 0;
+
+        // Вместимость буферов по окончании кадра
+        unsigned triangleCapacity = 0;
+        unsigned meshCapacity = 0;
+        unsigned lightCapacity = 0;
+
+        // Кол-во увеличений буферов за кадр (превышение вместимости)
+        unsigned bufferGrowCount = 0;
+
+        // Кол-во отброшенных треугольников (превышен максимальный размер буфера хранения)
+        unsigned droppedTriangles = 0;
+
+        // Кол-во лучей, не выпущенных из-за завершения пути русской рулеткой (вес луча ниже порога)
+        unsigned terminatedRayCount = 0;
+
+        // Отражения в экранном пространстве (режим RM_SCREEN_SPACE) - кол-во отраженных лучей первичных пересечений,
+        // кол-во найденных в экранном пространстве (не трассировались) и их доля
+        unsigned reflectionRayCount = 0;
+        unsigned screenSpaceReflectionCount = 0;
+        float screenSpaceReflectionRatio = 0.0f;
+
+        // Кол-во граней кубических карт зондов отражений, отрисованных в текущем кадре
+        unsigned reflectionProbeFaceCount = 0;
+
+        // Кол-во теневых лучей, обошедших структуру ускорения мешей, и кол-во карт теней, отрисованных в текущем кадре
+        unsigned shadowRayCount = 0;
+        unsigned shadowMapCount = 0;
+
+        // Кол-во собранных специализаций программ трассировки (каждая собирается при первом использовании своих параметров)
+        unsigned shaderPermutationCount = 0;
+
+        // Вторичные лучи (режим RT_WAVEFRONT) - кол-во лучей всех отскоков после первичного,
+        // время их сортировки и трассировки (поиск пересечений и освещение, мс), скорость с учетом сортировки (млн. лучей/с)
+        unsigned secondaryRayCount = 0;
+        float secondaryRaySortTime = 0.0f;
+        float secondaryRayTraceTime = 0.0f;
+        float secondaryMraysPerSecond = 0.0f;
     };
 
     /**